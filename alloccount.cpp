@@ -0,0 +1,77 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include "alloccount.h"
+
+// glibc's own entry points, the executable's definitions below take the
+// place of malloc and friends for every library in the process
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t align, size_t size);
+}
+
+// initial exec TLS of the executable, reading it never allocates
+static __thread uint64_t allocs;
+
+uint64_t AllocCount::get()
+{
+	return allocs;
+}
+
+extern "C" void *malloc(size_t size)
+{
+	++allocs;
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+	++allocs;
+	return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size)
+{
+	++allocs;
+	return __libc_realloc(p, size);
+}
+
+extern "C" void *memalign(size_t align, size_t size)
+{
+	++allocs;
+	return __libc_memalign(align, size);
+}
+
+extern "C" void *aligned_alloc(size_t align, size_t size)
+{
+	++allocs;
+	return __libc_memalign(align, size);
+}
+
+extern "C" int posix_memalign(void **p, size_t align, size_t size)
+{
+	if((align < sizeof(void *)) || (align & (align - 1))){
+		return 22; // EINVAL
+	}
+
+	++allocs;
+	*p = __libc_memalign(align, size);
+	return *p ? 0 : 12; // ENOMEM
+}
@@ -0,0 +1,43 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ALLOCCOUNT_H_
+#define ALLOCCOUNT_H_
+
+#include <stdint.h>
+
+/**
+ * Heap allocation counter, built in with "qmake CONFIG+=alloc_count" on
+ * glibc systems.  malloc, calloc, realloc and the aligned allocators are
+ * replaced by wrappers that count calls per thread before handing over to
+ * glibc, which catches operator new and the Qt containers as well.  Without
+ * it every call returns 0.
+ */
+class AllocCount
+{
+public:
+#ifdef ALLOC_COUNT
+	static bool isEnabled() { return true; }
+	/** Allocations made so far by the calling thread */
+	static uint64_t get();
+#else
+	static bool isEnabled() { return false; }
+	static uint64_t get() { return 0; }
+#endif
+};
+
+#endif /* ALLOCCOUNT_H_ */
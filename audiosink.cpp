@@ -0,0 +1,100 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "audiosink.h"
+#include "metrics.h"
+
+AudioSink::AudioSink(QObject *parent) :
+	QIODevice(parent),
+	rate(8000),
+	channels(1),
+	target(0),
+	streaming(false),
+	dry(true),
+	underruns(0),
+	overruns(0)
+{
+}
+
+void AudioSink::set_format(int r, int c, int target_ms)
+{
+	rate = r;
+	channels = c;
+	target = rate * channels * target_ms / 1000;
+	// room for a whole YSF frame, 5 vocoder frames, on top of twice the target
+	ring.setCapacity(2 * target + rate * channels / 10);
+}
+
+void AudioSink::start()
+{
+	ring.clear();
+	dry.store(true, std::memory_order_relaxed);
+	if(!isOpen()){
+		open(QIODevice::ReadOnly | QIODevice::Unbuffered); // a read ahead buffer would add latency
+	}
+}
+
+void AudioSink::stop()
+{
+	close();
+	ring.clear();
+}
+
+int AudioSink::write_pcm(const short *pcm, int n)
+{
+	int dropped = n - ring.write(pcm, n);
+
+	if(dropped){
+		++overruns;
+		Metrics::inc(Metrics::AudioOverruns);
+	}
+
+	return dropped;
+}
+
+qint64 AudioSink::get_queued_us() const
+{
+	return (qint64)ring.getFill() * 1000000 / (rate * channels);
+}
+
+qint64 AudioSink::bytesAvailable() const
+{
+	return ring.getFill() * sizeof(short) + QIODevice::bytesAvailable();
+}
+
+qint64 AudioSink::readData(char *data, qint64 maxlen)
+{
+	int n = maxlen / sizeof(short);
+	int got = ring.read((short *)data, n);
+
+	if(got < n){
+		memset(data + got * sizeof(short), 0, (n - got) * sizeof(short));
+		if(!dry.load(std::memory_order_relaxed) && streaming.load(std::memory_order_relaxed)){
+			underruns.store(underruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			Metrics::inc(Metrics::AudioUnderruns);
+		}
+	}
+	dry.store(got < n, std::memory_order_relaxed);
+
+	return n * sizeof(short); // silence keeps the device running between streams
+}
+
+qint64 AudioSink::writeData(const char *, qint64)
+{
+	return -1; // fed through write_pcm()
+}
@@ -0,0 +1,75 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIOSINK_H
+#define AUDIOSINK_H
+
+#include <QIODevice>
+#include <atomic>
+#include "pcmring.h"
+
+/**
+ * Pull mode source for QAudioOutput.  The decoder writes PCM into a lock
+ * free ring and the audio backend reads it from its own thread, so a full
+ * device buffer can no longer truncate a write.  When the ring runs dry the
+ * device gets silence, which is counted as an underrun if a stream was
+ * still being heard.  Samples that do not fit in the ring are dropped and
+ * counted as an overrun.
+ */
+class AudioSink : public QIODevice
+{
+	Q_OBJECT
+
+public:
+	explicit AudioSink(QObject *parent = nullptr);
+
+	/** Size the ring for rate Hz and channels, keeping target_ms of audio queued ahead of the device */
+	void set_format(int rate, int channels, int target_ms);
+	/** Empty the ring and open for reading, call before QAudioOutput::start() */
+	void start();
+	void stop();
+
+	/** Producer side: queue n interleaved samples, returns the number dropped */
+	int write_pcm(const short *pcm, int n);
+	/** Producer side: tell whether a stream is being heard, for underrun accounting */
+	void set_streaming(bool s) { streaming.store(s, std::memory_order_relaxed); }
+	/** True while the ring holds less than the target */
+	bool wants_audio() const { return ring.getFill() < target; }
+	/** Queued audio not yet read by the device */
+	qint64 get_queued_us() const;
+	uint64_t get_underruns() const { return underruns.load(std::memory_order_relaxed); }
+	uint64_t get_overruns() const { return overruns; }
+
+	bool isSequential() const override { return true; }
+	qint64 bytesAvailable() const override;
+
+protected:
+	qint64 readData(char *data, qint64 maxlen) override;
+	qint64 writeData(const char *data, qint64 len) override;
+
+private:
+	PCMRing ring;
+	int rate;
+	int channels;
+	int target;                        //!< samples, all channels
+	std::atomic<bool> streaming;
+	std::atomic<bool> dry;             //!< the last read came up short
+	std::atomic<uint64_t> underruns;   //!< written by the audio thread only
+	uint64_t overruns;
+};
+
+#endif // AUDIOSINK_H
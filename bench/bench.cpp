@@ -0,0 +1,755 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Microbenchmarks of the codec kernels and packet parsing on fixed inputs.
+ *
+ * Command line and output follow Google Benchmark so results can be fed to
+ * its compare.py between builds:
+ *   --benchmark_filter=<regex>     only run matching benchmarks
+ *   --benchmark_min_time=<secs>    minimum measuring time per benchmark, 0.5 by default
+ *   --benchmark_format=console|json
+ *   --benchmark_out=<file>         also write JSON results to file
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "viterbi5.h"
+#include "fec.h"
+#include "cbptc19696.h"
+#include "crs129.h"
+#include "cgolay2087.h"
+#include "crc.h"
+#include "SHA256.h"
+#include "mbe.h"
+#include "mbelib_parms.h"
+#include "synth.h"
+#include "resampler.h"
+#include "mixer.h"
+#include "packets.h"
+#include "slowdata.h"
+#include "pn.h"
+#include "ysf.h"
+
+#ifndef BENCH_GIT_VERSION
+#define BENCH_GIT_VERSION ""
+#endif
+
+struct BenchResult
+{
+	std::string name;
+	uint64_t iterations;
+	double real_ns;              //!< per iteration
+	double cpu_ns;
+};
+
+static std::vector<BenchResult> results;
+static std::regex filter(".*");
+static double min_time = 0.5;
+static bool json = false;
+
+/** Keep the compiler from dropping work whose result is never read */
+static inline void do_not_optimize(const void *p)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "g"(p) : "memory");
+#else
+	static const void * volatile sink;
+	sink = p;
+#endif
+}
+
+/** Run fn(iterations) with a growing count until it takes min_time, as Google Benchmark does */
+template<typename F> static void bench(const char *name, F fn)
+{
+	if(!std::regex_search(name, filter)){
+		return;
+	}
+
+	uint64_t iters = 1;
+
+	for(;;){
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		clock_t c0 = clock();
+		fn(iters);
+		double real = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		double cpu = (double)(clock() - c0) / CLOCKS_PER_SEC;
+
+		if((real >= min_time) || (iters >= 1000000000)){
+			BenchResult r = {name, iters, real * 1e9 / iters, cpu * 1e9 / iters};
+			results.push_back(r);
+			if(!json){
+				fprintf(stdout, "%-40s %12.1f ns %12.1f ns %12llu\n", name, r.real_ns, r.cpu_ns, (unsigned long long)iters);
+				fflush(stdout);
+			}
+			return;
+		}
+
+		double mult = (real > min_time / 10) ? min_time * 1.4 / real : 10.0;
+		uint64_t next = (uint64_t)(iters * mult);
+		iters = (next > iters) ? next : iters + 1;
+	}
+}
+
+static uint32_t rng_state = 0x12345678;
+
+/** Fixed xorshift sequence so every build benchmarks the same inputs */
+static uint32_t rng()
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+/** The auto gain, gain ramp and S16 conversion passes that MBEDecoder::processAudio() made before absMax() and gainToS16() */
+static float gain_s16_scalar(float *buf, short *out, float gain, float gaindelta, bool stereo)
+{
+	float max = 0;
+
+	for(int n = 0; n < 160; n++){
+		float aout_abs = fabsf(buf[n]);
+
+		if(aout_abs > max){
+			max = aout_abs;
+		}
+	}
+	for(int n = 0; n < 160; n++){
+		buf[n] = (gain + (static_cast<float>(n) * gaindelta)) * buf[n];
+	}
+	for(int n = 0; n < 160; n++){
+		if(buf[n] > static_cast<float>(32760)){
+			buf[n] = static_cast<float>(32760);
+		}
+		else if(buf[n] < static_cast<float>(-32760)){
+			buf[n] = static_cast<float>(-32760);
+		}
+		*out++ = static_cast<short>(buf[n]);
+		if(stereo){
+			*out++ = static_cast<short>(buf[n]);
+		}
+	}
+
+	return max;
+}
+
+/** Resident set size in KiB from /proc/self/status, 0 where there is none */
+static long rss_kib()
+{
+	long kib = 0;
+	char line[256];
+	FILE *f = fopen("/proc/self/status", "r");
+
+	if(!f){
+		return 0;
+	}
+	while(fgets(line, sizeof(line), f)){
+		if(!strncmp(line, "VmRSS:", 6)){
+			kib = atol(line + 6);
+		}
+	}
+	fclose(f);
+
+	return kib;
+}
+
+static void write_json(FILE *f)
+{
+	char date[64];
+	char host[256] = "";
+	time_t t = time(nullptr);
+
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&t));
+#if defined(_WIN32)
+	const char *h = getenv("COMPUTERNAME");
+#else
+	const char *h = getenv("HOSTNAME");
+#endif
+	if(h){
+		snprintf(host, sizeof(host), "%s", h);
+	}
+
+	fprintf(f, "{\n  \"context\": {\n");
+	fprintf(f, "    \"date\": \"%s\",\n", date);
+	fprintf(f, "    \"host_name\": \"%s\",\n", host);
+	fprintf(f, "    \"executable\": \"bench\",\n");
+	fprintf(f, "    \"git_version\": \"%s\",\n", BENCH_GIT_VERSION);
+	fprintf(f, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+	fprintf(f, "    \"library_build_type\": \"release\"\n");
+#else
+	fprintf(f, "    \"library_build_type\": \"debug\"\n");
+#endif
+	fprintf(f, "  },\n  \"benchmarks\": [\n");
+
+	for(size_t i = 0; i < results.size(); ++i){
+		const BenchResult &r = results[i];
+		fprintf(f, "    {\n");
+		fprintf(f, "      \"name\": \"%s\",\n", r.name.c_str());
+		fprintf(f, "      \"run_name\": \"%s\",\n", r.name.c_str());
+		fprintf(f, "      \"run_type\": \"iteration\",\n");
+		fprintf(f, "      \"repetitions\": 1,\n");
+		fprintf(f, "      \"repetition_index\": 0,\n");
+		fprintf(f, "      \"threads\": 1,\n");
+		fprintf(f, "      \"iterations\": %llu,\n", (unsigned long long)r.iterations);
+		fprintf(f, "      \"real_time\": %.4f,\n", r.real_ns);
+		fprintf(f, "      \"cpu_time\": %.4f,\n", r.cpu_ns);
+		fprintf(f, "      \"time_unit\": \"ns\"\n");
+		fprintf(f, "    }%s\n", (i + 1 < results.size()) ? "," : "");
+	}
+
+	fprintf(f, "  ]\n}\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *out = nullptr;
+
+	for(int i = 1; i < argc; ++i){
+		const char *a = argv[i];
+		if(!strncmp(a, "--benchmark_filter=", 19)){
+			filter = std::regex(a + 19);
+		}
+		else if(!strncmp(a, "--benchmark_min_time=", 21)){
+			min_time = atof(a + 21);
+		}
+		else if(!strcmp(a, "--benchmark_format=json")){
+			json = true;
+		}
+		else if(!strcmp(a, "--benchmark_format=console")){
+			json = false;
+		}
+		else if(!strncmp(a, "--benchmark_out=", 16)){
+			out = a + 16;
+		}
+		else{
+			fprintf(stderr, "usage: %s [--benchmark_filter=<regex>] [--benchmark_min_time=<secs>] [--benchmark_format=console|json] [--benchmark_out=<file>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if(!json){
+		fprintf(stdout, "%-40s %15s %15s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+		fprintf(stdout, "-------------------------------------------------------------------------------------\n");
+	}
+
+	// YSF FICH and DCH: rate 1/2 K=5 symbols of random bits with a few symbol errors
+	Viterbi5 viterbi(2, Viterbi::Poly25y, true);
+	unsigned char bits[180], symbols[180], decoded[180];
+
+	for(int i = 0; i < 180; ++i){
+		bits[i] = (i < 176) ? rng() & 1 : 0;
+	}
+
+	viterbi.encodeToSymbols(symbols, bits, 180, 0);
+
+	for(int i = 0; i < 180; i += 23){
+		symbols[i] ^= 1;
+	}
+
+	bench("Viterbi5/decodeFromSymbols/100", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			viterbi.decodeFromSymbols(decoded, symbols, 100, 0);
+			do_not_optimize(decoded);
+		}
+	});
+	bench("Viterbi5/decodeFromSymbols/180", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			viterbi.decodeFromSymbols(decoded, symbols, 180, 0);
+			do_not_optimize(decoded);
+		}
+	});
+
+	// the 4 codewords of a FICH, one clean, the others with 1 to 3 bit errors
+	Golay_24_12 golay;
+	unsigned char golay_in[4][24], golay_work[4][24];
+
+	for(int c = 0; c < 4; ++c){
+		unsigned char data[12];
+		for(int i = 0; i < 12; ++i){
+			data[i] = rng() & 1;
+		}
+		golay.encode(data, golay_in[c]);
+		for(int e = 0; e < c; ++e){
+			golay_in[c][(7 * e + 3 * c) % 24] ^= 1;
+		}
+	}
+
+	bench("Golay_24_12/decode", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			memcpy(golay_work, golay_in, sizeof(golay_work)); // decode corrects in place
+			for(int c = 0; c < 4; ++c){
+				golay.decode(golay_work[c]);
+			}
+			do_not_optimize(golay_work);
+		}
+	});
+
+	// DMR voice LC header for 3100000 -> TG 91, as built by AppendVoiceLCToBuffer
+	unsigned char lc[12] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x5b, 0x2f, 0x4d, 0x60, 0, 0, 0};
+	unsigned char parity[4];
+	unsigned char payload[33];
+	unsigned char lc_out[12];
+	CBPTC19696 bptc;
+
+	CRS129::encode(lc, 9, parity);
+	lc[9] = parity[2] ^ 0x96;
+	lc[10] = parity[1] ^ 0x96;
+	lc[11] = parity[0] ^ 0x96;
+	memset(payload, 0, sizeof(payload));
+	bptc.encode(lc, payload);
+
+	bench("CBPTC19696/decode", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			bptc.decode(payload, lc_out);
+			do_not_optimize(lc_out);
+		}
+	});
+	bench("CBPTC19696/encode", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			bptc.encode(lc, payload);
+			do_not_optimize(payload);
+		}
+	});
+	bench("CRS129/encode", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			CRS129::encode(lc, 9, parity);
+			do_not_optimize(parity);
+		}
+	});
+
+	// slot type of a voice LC header on colour code 1
+	unsigned char slottype[3] = {0x11, 0, 0};
+	unsigned char slotdata = 0;
+
+	bench("CGolay2087/encode", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			CGolay2087::encode(slottype);
+			do_not_optimize(slottype);
+		}
+	});
+
+	bench("CGolay2087/decode", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			slotdata = CGolay2087::decode(slottype);
+			do_not_optimize(&slotdata);
+		}
+	});
+
+	// YSF FICH CRC over 4 bytes, and over a 41 byte block for the per byte cost
+	CRC crc(CRC::PolyCCITT16, 16, 0x0, 0xffff);
+	unsigned char block[41];
+	unsigned long crcval = 0;
+
+	for(int i = 0; i < 41; ++i){
+		block[i] = rng() & 0xff;
+	}
+
+	bench("CRC/crctablefast/4", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			crcval = crc.crctablefast(block, 4);
+			do_not_optimize(&crcval);
+		}
+	});
+	bench("CRC/crctablefast/41", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			crcval = crc.crctablefast(block, 41);
+			do_not_optimize(&crcval);
+		}
+	});
+
+	// session setup: the FEC, CRC and whitening state a YSF connection constructs
+	MBEDecoder ysf_mbe;
+
+	bench("Golay_24_12/construct", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			Golay_24_12 g;
+			do_not_optimize(&g);
+		}
+	});
+	bench("CRC/construct", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			CRC c(CRC::PolyCCITT16, 16, 0x0, 0xffff);
+			do_not_optimize(&c);
+		}
+	});
+	bench("PN_9_5/construct", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			PN_9_5 pn(0x1c9);
+			do_not_optimize(&pn);
+		}
+	});
+	bench("DSDYSF/construct", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			DSDYSF ysf(&ysf_mbe);
+			do_not_optimize(&ysf);
+		}
+	});
+
+	// D-STAR radio header with a valid FCS
+	DStarCRC dstarcrc;
+	unsigned char header[41];
+	bool crcok = false;
+
+	memcpy(header, "\x00\x00\x00" "REF001 C" "REF001 G" "CQCQCQ  " "N0CALL  " "TEST" "\x00\x00", 41);
+	dstarcrc.append_crc(header, 41);
+
+	bench("DStarCRC/check_crc/41", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			crcok = dstarcrc.check_crc(header, 41);
+			do_not_optimize(&crcok);
+		}
+	});
+
+	// Homebrew login: 4 byte salt followed by the password
+	CSHA256 sha256;
+	unsigned char login[12] = {0x1a, 0x2b, 0x3c, 0x4d, 'p', 'a', 's', 's', 'w', '0', 'r', 'd'};
+	unsigned char digest[32];
+
+	bench("CSHA256/buffer/12", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			sha256.buffer(login, sizeof(login), digest);
+			do_not_optimize(digest);
+		}
+	});
+
+	// AMBE silence as sent on D-STAR and DMR
+	static const unsigned char dstar_silence[9] = {0x9e, 0x8d, 0x32, 0x88, 0x26, 0x1a, 0x3f, 0x61, 0xe8};
+	static const unsigned char dmr_silence[9] = {0xb9, 0xe8, 0x81, 0x52, 0x61, 0x73, 0x00, 0x2a, 0x6b};
+	char ambe_fr[4][24];
+
+	memset(ambe_fr, 0, sizeof(ambe_fr));
+
+	bench("MBEDecoder/unpack_dstar", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			MBEDecoder::unpack_dstar(dstar_silence, ambe_fr);
+			do_not_optimize(ambe_fr);
+		}
+	});
+	bench("MBEDecoder/unpack_dmr", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			MBEDecoder::unpack_dmr(dmr_silence, ambe_fr);
+			do_not_optimize(ambe_fr);
+		}
+	});
+
+	// auto gain peak, gain ramp and S16 conversion of one synthesized frame, against the scalar passes they replaced
+	float gain_in[160], gain_tmp[160];
+	short gain_out[320];
+	float gain_peak;
+
+	for(int i = 0; i < 160; ++i){
+		gain_in[i] = (float)((int)(rng() % 4001) - 2000) * 0.5f;
+	}
+
+	for(int stereo = 0; stereo < 2; ++stereo){
+		bench(stereo ? "MBEDecoder/gainToS16/stereo" : "MBEDecoder/gainToS16/mono", [&](uint64_t n){
+			for(uint64_t i = 0; i < n; ++i){
+				gain_peak = MBEDecoder::absMax(gain_in);
+				MBEDecoder::gainToS16(gain_in, gain_out, 160, 12.0f, 0.01f, stereo);
+				do_not_optimize(&gain_peak);
+				do_not_optimize(gain_out);
+			}
+		});
+		bench(stereo ? "MBEDecoder/gainToS16/scalar_stereo" : "MBEDecoder/gainToS16/scalar_mono", [&](uint64_t n){
+			for(uint64_t i = 0; i < n; ++i){
+				memcpy(gain_tmp, gain_in, sizeof(gain_tmp)); // the old passes worked in place
+				gain_peak = gain_s16_scalar(gain_tmp, gain_out, 12.0f, 0.01f, stereo);
+				do_not_optimize(&gain_peak);
+				do_not_optimize(gain_out);
+			}
+		});
+	}
+
+	// a whole frame to 8 kHz S16 through mbelib, and a silence frame that skips it
+	static const unsigned char dstar_voice[9] = {0x4e, 0x2b, 0x91, 0x07, 0xd3, 0x6c, 0xa5, 0x18, 0x7f};
+	short speech[160];
+	MBEDecoder mbe;
+
+	mbe.setAudioBuffer(speech, 160);
+
+	bench("MBEDecoder/process_dstar/voice", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			mbe.resetAudio();
+			mbe.process_dstar(dstar_voice);
+			do_not_optimize(speech);
+		}
+	});
+	bench("MBEDecoder/process_dstar/silence", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			mbe.resetAudio();
+			mbe.process_dstar(dstar_silence);
+			do_not_optimize(speech);
+		}
+	});
+
+	// speech synthesis alone from fixed parameters: 100 Hz pitch, voiced up to 2 kHz
+	mbe_parms synth_cur, synth_prev;
+	float synth_out[MBESynth::N];
+	MBESynth synth_float(MBESynth::Float), synth_fixed(MBESynth::Fixed);
+
+	memset(&synth_cur, 0, sizeof(synth_cur));
+	synth_cur.w0 = 2.0f * 3.14159265f / 80.0f;
+	synth_cur.L = 37;
+	for(int l = 1; l <= synth_cur.L; ++l){
+		synth_cur.Vl[l] = (l <= 20) ? 1 : 0;
+		synth_cur.Ml[l] = 2000.0f / l;
+		synth_cur.PHIl[l] = synth_cur.PSIl[l] = (float)(rng() & 0xffff) / 10430.0f;
+	}
+	synth_prev = synth_cur;
+	synth_prev.w0 *= 1.05f;
+
+	bench("MBESynth/mbelib", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			mbe_parms cur = synth_cur, prev = synth_prev;
+			mbe_synthesizeSpeechf(synth_out, &cur, &prev, 3);
+			do_not_optimize(synth_out);
+		}
+	});
+	bench("MBESynth/float", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			mbe_parms cur = synth_cur, prev = synth_prev;
+			synth_float.synthesize(synth_out, &cur, &prev, 3);
+			do_not_optimize(synth_out);
+		}
+	});
+	bench("MBESynth/fixed", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			mbe_parms cur = synth_cur, prev = synth_prev;
+			synth_fixed.synthesize(synth_out, &cur, &prev, 3);
+			do_not_optimize(synth_out);
+		}
+	});
+
+	// one 20 ms tick of 64 D-STAR streams, a frame at a time and as one batch; 20 ms / 64 / time is the streams a core can carry
+	// every stream plays through a second of error free voice frames with random parameters, none an erasure, silence or tone
+	static unsigned char tick_frames[50][9];
+	static short tick_audio[2][64][160];
+	static MBEDecoder tick_decoders[2][64];
+	MBEDecoder::Job tick_jobs[64];
+	uint32_t tick = 0;
+
+	for(int f = 0; f < 50; ++f){
+		char ambe_d[49], ambe_fr[4][24];
+
+		for(int i = 0; i < 49; ++i){
+			ambe_d[i] = rng() & 1;
+		}
+		ambe_d[0] = 0; // MSB of the pitch index
+		MBEDecoder::encodeAmbe(ambe_d, ambe_fr);
+		MBEDecoder::pack_dstar(ambe_fr, tick_frames[f]);
+	}
+	for(int s = 0; s < 64; ++s){
+		for(int k = 0; k < 2; ++k){
+			tick_decoders[k][s].setAudioBuffer(tick_audio[k][s], 160);
+		}
+		tick_jobs[s].decoder = &tick_decoders[1][s];
+		tick_jobs[s].format = MBEDecoder::DStar;
+	}
+
+	bench("MBEDecoder/process_dstar/64", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i, ++tick){
+			for(int s = 0; s < 64; ++s){
+				tick_decoders[0][s].resetAudio();
+				tick_decoders[0][s].process_dstar(tick_frames[(s + tick) % 50]);
+			}
+			do_not_optimize(tick_audio[0]);
+		}
+	});
+	bench("MBEDecoder/processBatch/64", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i, ++tick){
+			for(int s = 0; s < 64; ++s){
+				tick_jobs[s].frame = tick_frames[(s + tick) % 50];
+			}
+			MBEDecoder::processBatch(tick_jobs, 64);
+			do_not_optimize(tick_audio[1]);
+		}
+	});
+
+	// one 20 ms vocoder frame to 48 kHz, at the nominal ratio and trimmed to follow a sound card clock
+	float pcm_in[160], pcm_out[1024];
+	int resampled = 0;
+	Resampler fixed(48000), adaptive(48000, 8000, true);
+
+	for(int i = 0; i < 160; ++i){
+		pcm_in[i] = (float)((int)(rng() & 0xffff) - 32768) / 32768.0f;
+	}
+	adaptive.setTrim(-37.5);
+
+	bench("Resampler/process/48000", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			resampled += fixed.process(pcm_in, 160, pcm_out);
+			do_not_optimize(pcm_out);
+		}
+	});
+	bench("Resampler/process/48000/adaptive", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			resampled += adaptive.process(pcm_in, 160, pcm_out);
+			do_not_optimize(pcm_out);
+		}
+	});
+
+	do_not_optimize(&resampled);
+
+	// one 20 ms tick of 64 streams spread over both channels, then the S16 output
+	static short frames[64][Mixer::FrameSamples];
+	short mixed[2 * Mixer::FrameSamples];
+	Mixer mixer;
+
+	for(int s = 0; s < 64; ++s){
+		for(int i = 0; i < Mixer::FrameSamples; ++i){
+			frames[s][i] = (short)(rng() & 0xffff) >> 3;
+		}
+	}
+	mixer.setStereo(true);
+
+	bench("Mixer/stereo/64", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			mixer.clear();
+			for(int s = 0; s < 64; ++s){
+				mixer.add(frames[s], Mixer::FrameSamples, 0.25f, 1 + s % 3);
+			}
+			Mixer::toS16(mixer.getChannel(0), mixer.getChannel(1), Mixer::FrameSamples, mixed);
+			do_not_optimize(mixed);
+		}
+	});
+
+	// received datagrams: a REF header and voice frame, a DCS frame and a DMRD voice burst
+	char ref_header[58], ref_voice[29], dcs_voice[100], dmrd[55];
+	unsigned char dmr_ambe[27];
+	uint32_t parsed = 0;
+
+	memset(ref_header, 0, sizeof(ref_header));
+	memcpy(ref_header, "\x3a\x80" "DSVT", 6);
+	memcpy(ref_header + REFLayout::RadioHeader, header, 41);
+	memcpy(ref_voice, "\x1d\x80" "DSVT", 6);
+	memset(ref_voice + 6, 0x11, sizeof(ref_voice) - 6);
+	memcpy(dcs_voice, "0001", 4);
+	memset(dcs_voice + 4, 0x22, sizeof(dcs_voice) - 4);
+	memcpy(dmrd, "DMRD", 4);
+	for(int i = 4; i < 55; ++i){
+		dmrd[i] = rng() & 0xff;
+	}
+	dmrd[15] = 0x01;
+
+	bench("DStarHeaderView/REF", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			if(REFLayout::isHeader(ref_header, sizeof(ref_header))){
+				DStarHeaderView<REFLayout> h(ref_header);
+				parsed += h.getStreamID() + h.getRptr1()[7] + h.getRptr2()[7] + h.getMycall()[0];
+			}
+			do_not_optimize(&parsed);
+		}
+	});
+	bench("DStarVoiceView/REF", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			if(REFLayout::isVoice(ref_voice, sizeof(ref_voice))){
+				DStarVoiceView<REFLayout> v(ref_voice);
+				parsed += v.getStreamID() + v.getSeq() + v.getAMBE()[0] + v.getSlowData()[0];
+			}
+			do_not_optimize(&parsed);
+		}
+	});
+	bench("DStarVoiceView/DCS", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			if(DCSLayout::isVoice(dcs_voice, sizeof(dcs_voice))){
+				DStarVoiceView<DCSLayout> v(dcs_voice);
+				parsed += v.getStreamID() + v.getSeq() + v.getAMBE()[0] + v.getSlowData()[0];
+			}
+			do_not_optimize(&parsed);
+		}
+	});
+	bench("DMRDView/voice", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			if(DMRDView::isDMRD(dmrd, sizeof(dmrd))){
+				DMRDView v(dmrd);
+				v.getAMBE(dmr_ambe);
+				parsed += v.getStreamID() + v.getSrcID() + v.getDstID() + v.getSlot() + dmr_ambe[13];
+			}
+			do_not_optimize(&parsed);
+			do_not_optimize(dmr_ambe);
+		}
+	});
+
+	// one superframe of slow data: sync, 4 text blocks, then GPS blocks, scrambled as sent
+	unsigned char superframe[21][3];
+	const char *sf_text = "\x40" "DUDE-" "\x41" "STAR " "\x42" "RX te" "\x43" "st   "
+						  "\x35" "$GPGG" "\x35" "A,123" "\x35" "519,4" "\x35" "807.0" "\x35" "38,N\r" "\x66" "fffff";
+	SlowData slowdata;
+	int sdres = 0;
+
+	superframe[0][0] = 0x55;
+	superframe[0][1] = 0x2d;
+	superframe[0][2] = 0x16;
+	for(int i = 0; i < 60; ++i){
+		static const unsigned char scrambler[3] = {0x70, 0x4f, 0x93};
+		superframe[1 + i / 3][i % 3] = sf_text[i] ^ scrambler[i % 3];
+	}
+
+	bench("SlowData/process/21", [&](uint64_t n){
+		for(uint64_t i = 0; i < n; ++i){
+			for(int f = 0; f < 21; ++f){
+				sdres |= slowdata.process(f, superframe[f]);
+			}
+			do_not_optimize(&sdres);
+		}
+	});
+
+	// resident memory of 100 and then 500 D-STAR decoders at 48 kHz after a second of voice each, sharing one output buffer as DudeStarRX does
+	static short rss_audio[2 * MBEDecoder::MaxFrameSamples];
+	std::vector<MBEDecoder *> rss_decoders;
+	const long rss_base = rss_kib();
+
+	for(int n = 100; !json && rss_base && std::regex_search("MBEDecoder/rss", filter) && (n <= 500); n += 400){
+		for(int s = rss_decoders.size(); s < n; ++s){
+			rss_decoders.push_back(new MBEDecoder());
+			rss_decoders[s]->setOutputRate(48000);
+			rss_decoders[s]->setAudioBuffer(rss_audio, MBEDecoder::MaxFrameSamples);
+			for(int f = 0; f < 50; ++f){
+				rss_decoders[s]->resetAudio();
+				rss_decoders[s]->process_dstar(tick_frames[(s + f) % 50]);
+			}
+		}
+		const long kib = rss_kib() - rss_base;
+		fprintf(stdout, "MBEDecoder/rss/%-25d %12ld KiB %11.1f KiB/decoder\n", n, kib, (double)kib / n);
+	}
+	for(size_t s = 0; s < rss_decoders.size(); ++s){
+		delete rss_decoders[s];
+	}
+
+	if(json){
+		write_json(stdout);
+	}
+	if(out){
+		FILE *f = fopen(out, "w");
+		if(!f){
+			fprintf(stderr, "cannot write %s\n", out);
+			return 1;
+		}
+		write_json(f);
+		fclose(f);
+	}
+
+	return 0;
+}
@@ -0,0 +1,46 @@
+#-------------------------------------------------
+#
+# Codec kernel microbenchmarks, built separately from the GUI:
+#   cd bench && qmake && make
+#   ./bench --benchmark_format=json --benchmark_out=bench.json
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = bench
+TEMPLATE = app
+
+CONFIG += console c++14 release
+CONFIG -= app_bundle qt
+
+# Recorded in the JSON context so results can be matched to a build
+DEFINES += BENCH_GIT_VERSION=\\\"$$system(git -C $$PWD describe --always --dirty)\\\"
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+        bench.cpp \
+        ../SHA256.cpp \
+        ../cbptc19696.cpp \
+        ../cgolay2087.cpp \
+        ../chamming.cpp \
+        ../crc.cpp \
+        ../crs129.cpp \
+        ../fec.cpp \
+        ../mbe.cpp \
+        ../mbefec.cpp \
+        ../metrics.cpp \
+        ../mixer.cpp \
+        ../pn.cpp \
+        ../resampler.cpp \
+        ../slowdata.cpp \
+        ../synth.cpp \
+        ../viterbi.cpp \
+        ../viterbi5.cpp \
+        ../ysf.cpp
+
+# Location for libmbe.a on Windows
+win32:LIBS += -LC:\Qt\5.13.1\mingw73_32_static\lib
+
+LIBS += -lmbe
@@ -0,0 +1,350 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <chrono>
+#include "capture.h"
+
+static const char capture_magic[8] = {'D','S','R','X','C','A','P','1'};
+
+static const uint32_t PCAP_MAGIC_US = 0xa1b2c3d4;
+static const uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+
+static const uint32_t LINKTYPE_NULL = 0;
+static const uint32_t LINKTYPE_ETHERNET = 1;
+static const uint32_t LINKTYPE_RAW_OLD = 12;
+static const uint32_t LINKTYPE_RAW_OBSD = 14;
+static const uint32_t LINKTYPE_RAW = 101;
+static const uint32_t LINKTYPE_LINUX_SLL = 113;
+static const uint32_t LINKTYPE_IPV4 = 228;
+static const uint32_t LINKTYPE_IPV6 = 229;
+static const uint32_t LINKTYPE_LINUX_SLL2 = 276;
+
+static uint16_t get16be(const unsigned char *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static uint32_t get32le(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put16le(unsigned char *p, uint16_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+}
+
+CaptureWriter::CaptureWriter() :
+	m_file(nullptr)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+	close();
+}
+
+bool CaptureWriter::open(const char *path)
+{
+	close();
+	m_file = fopen(path, "wb");
+
+	if(!m_file){
+		return false;
+	}
+	if(fwrite(capture_magic, 1, sizeof(capture_magic), m_file) != sizeof(capture_magic)){
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void CaptureWriter::close()
+{
+	if(m_file){
+		fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+void CaptureWriter::write(uint16_t srcPort, const unsigned char *data, int length)
+{
+	uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	write(now, srcPort, data, length);
+}
+
+void CaptureWriter::write(uint64_t timestamp, uint16_t srcPort, const unsigned char *data, int length)
+{
+	unsigned char hdr[12];
+
+	if(!m_file || (length < 0) || (length > 0xffff)){
+		return;
+	}
+	for(int i = 0; i < 8; ++i){
+		hdr[i] = (timestamp >> (8 * i)) & 0xff;
+	}
+
+	put16le(hdr + 8, srcPort);
+	put16le(hdr + 10, length);
+	fwrite(hdr, 1, sizeof(hdr), m_file);
+	fwrite(data, 1, length, m_file);
+	fflush(m_file);
+}
+
+CaptureReader::CaptureReader() :
+	m_file(nullptr),
+	m_format(None),
+	m_swapped(false),
+	m_nanosecond(false),
+	m_linkType(0),
+	m_portFilter(-1),
+	m_skipped(0)
+{
+	m_buf = new unsigned char[MaxRecord];
+}
+
+CaptureReader::~CaptureReader()
+{
+	close();
+	delete[] m_buf;
+}
+
+bool CaptureReader::open(const char *path)
+{
+	unsigned char hdr[24];
+
+	close();
+	m_file = fopen(path, "rb");
+
+	if(!m_file){
+		return false;
+	}
+	if(fread(hdr, 1, 8, m_file) != 8){
+		close();
+		return false;
+	}
+	if(memcmp(hdr, capture_magic, sizeof(capture_magic)) == 0){
+		m_format = Native;
+		return true;
+	}
+
+	uint32_t magic = get32le(hdr);
+	uint32_t swapped = __builtin_bswap32(magic);
+
+	if((magic == PCAP_MAGIC_US) || (magic == PCAP_MAGIC_NS)){
+		m_swapped = false;
+		m_nanosecond = (magic == PCAP_MAGIC_NS);
+	}
+	else if((swapped == PCAP_MAGIC_US) || (swapped == PCAP_MAGIC_NS)){
+		m_swapped = true;
+		m_nanosecond = (swapped == PCAP_MAGIC_NS);
+	}
+	else{
+		close();
+		return false;
+	}
+	if(fread(hdr + 8, 1, 16, m_file) != 16){
+		close();
+		return false;
+	}
+
+	m_linkType = pcap32(hdr + 20) & 0x0fffffff; // upper bits carry the FCS length
+	m_format = Pcap;
+	return true;
+}
+
+void CaptureReader::close()
+{
+	if(m_file){
+		fclose(m_file);
+		m_file = nullptr;
+	}
+
+	m_format = None;
+	m_skipped = 0;
+}
+
+uint32_t CaptureReader::pcap32(const unsigned char *p) const
+{
+	uint32_t v = get32le(p);
+	return m_swapped ? __builtin_bswap32(v) : v;
+}
+
+bool CaptureReader::next(CaptureRecord &rec)
+{
+	for(;;){
+		bool ok = (m_format == Native) ? nextNative(rec) : (m_format == Pcap) ? nextPcap(rec) : false;
+
+		if(!ok){
+			return false;
+		}
+		if((m_portFilter < 0) || (rec.srcPort == m_portFilter)){
+			return true;
+		}
+
+		++m_skipped;
+	}
+}
+
+bool CaptureReader::nextNative(CaptureRecord &rec)
+{
+	unsigned char hdr[12];
+
+	if(fread(hdr, 1, sizeof(hdr), m_file) != sizeof(hdr)){
+		return false;
+	}
+
+	rec.timestamp = get32le(hdr) | ((uint64_t)get32le(hdr + 4) << 32);
+	rec.srcPort = hdr[8] | (hdr[9] << 8);
+	rec.length = hdr[10] | (hdr[11] << 8);
+	rec.data = m_buf;
+	return fread(m_buf, 1, rec.length, m_file) == (size_t)rec.length;
+}
+
+bool CaptureReader::nextPcap(CaptureRecord &rec)
+{
+	unsigned char hdr[16];
+
+	for(;;){
+		if(fread(hdr, 1, sizeof(hdr), m_file) != sizeof(hdr)){
+			return false;
+		}
+
+		uint32_t sec = pcap32(hdr);
+		uint32_t frac = pcap32(hdr + 4);
+		uint32_t caplen = pcap32(hdr + 8);
+
+		if(caplen > (uint32_t)MaxRecord){
+			return false; // corrupt or truncated file
+		}
+		if(fread(m_buf, 1, caplen, m_file) != caplen){
+			return false;
+		}
+
+		rec.timestamp = (uint64_t)sec * 1000000 + (m_nanosecond ? frac / 1000 : frac);
+
+		if(decodeLink(m_buf, caplen, rec)){
+			return true;
+		}
+
+		++m_skipped;
+	}
+}
+
+bool CaptureReader::decodeLink(const unsigned char *p, int len, CaptureRecord &rec)
+{
+	uint16_t ethertype;
+
+	switch(m_linkType){
+	case LINKTYPE_NULL:
+		return (len > 4) && decodeIP(p + 4, len - 4, rec);
+	case LINKTYPE_ETHERNET:
+		if(len < 14){
+			return false;
+		}
+		ethertype = get16be(p + 12);
+		p += 14;
+		len -= 14;
+		while(((ethertype == 0x8100) || (ethertype == 0x88a8)) && (len >= 4)){ // VLAN tags
+			ethertype = get16be(p + 2);
+			p += 4;
+			len -= 4;
+		}
+		break;
+	case LINKTYPE_LINUX_SLL:
+		if(len < 16){
+			return false;
+		}
+		ethertype = get16be(p + 14);
+		p += 16;
+		len -= 16;
+		break;
+	case LINKTYPE_LINUX_SLL2:
+		if(len < 20){
+			return false;
+		}
+		ethertype = get16be(p);
+		p += 20;
+		len -= 20;
+		break;
+	case LINKTYPE_RAW_OLD:
+	case LINKTYPE_RAW_OBSD:
+	case LINKTYPE_RAW:
+	case LINKTYPE_IPV4:
+	case LINKTYPE_IPV6:
+		return decodeIP(p, len, rec);
+	default:
+		return false;
+	}
+
+	if((ethertype != 0x0800) && (ethertype != 0x86dd)){
+		return false;
+	}
+
+	return decodeIP(p, len, rec);
+}
+
+bool CaptureReader::decodeIP(const unsigned char *p, int len, CaptureRecord &rec)
+{
+	int hdrlen;
+	int iplen;
+
+	if(len < 1){
+		return false;
+	}
+	if((p[0] >> 4) == 4){
+		hdrlen = (p[0] & 0x0f) * 4;
+		if((len < 20) || (hdrlen < 20) || (p[9] != 17)){
+			return false;
+		}
+		if((p[6] & 0x3f) || p[7]){ // more fragments or fragment offset
+			return false;
+		}
+		iplen = get16be(p + 2);
+	}
+	else if((p[0] >> 4) == 6){
+		hdrlen = 40;
+		if((len < 40) || (p[6] != 17)){ // UDP directly after the fixed header only
+			return false;
+		}
+		iplen = 40 + get16be(p + 4);
+	}
+	else{
+		return false;
+	}
+	if(iplen < len){
+		len = iplen; // drop Ethernet padding
+	}
+	if(len < hdrlen + 8){
+		return false;
+	}
+
+	const unsigned char *udp = p + hdrlen;
+	int udplen = get16be(udp + 4);
+
+	if((udplen < 8) || (udplen > len - hdrlen)){
+		return false; // truncated by the snap length
+	}
+
+	rec.srcPort = get16be(udp);
+	rec.data = udp + 8;
+	rec.length = udplen - 8;
+	return true;
+}
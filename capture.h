@@ -0,0 +1,102 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Received datagram capture files, used to replay a reflector session
+ * without a network.
+ *
+ * The native format is an 8 byte "DSRXCAP1" magic followed by records of
+ * a 64 bit timestamp in microseconds, the 16 bit UDP source port and the
+ * 16 bit payload length, all little endian, then the payload itself.
+ *
+ * The reader also takes libpcap files (either byte order, micro or nano
+ * second timestamps) on Ethernet, Linux cooked, raw IP and BSD loopback
+ * links, and returns the payload of every unfragmented IPv4/IPv6 UDP packet.
+ */
+struct CaptureRecord
+{
+	uint64_t timestamp;          //!< microseconds
+	uint16_t srcPort;
+	const unsigned char *data;   //!< valid until the next call to CaptureReader::next()
+	int length;
+};
+
+class CaptureWriter
+{
+public:
+	CaptureWriter();
+	~CaptureWriter();
+
+	bool open(const char *path);
+	void close();
+	bool isOpen() const { return m_file != nullptr; }
+
+	/** Append one datagram stamped with the current wall clock time */
+	void write(uint16_t srcPort, const unsigned char *data, int length);
+	void write(uint64_t timestamp, uint16_t srcPort, const unsigned char *data, int length);
+
+private:
+	FILE *m_file;
+};
+
+class CaptureReader
+{
+public:
+	enum Format { None, Native, Pcap };
+
+	CaptureReader();
+	~CaptureReader();
+
+	bool open(const char *path);
+	void close();
+	Format getFormat() const { return m_format; }
+
+	/** Only return datagrams sent from this UDP port, -1 for all of them */
+	void setPortFilter(int port) { m_portFilter = port; }
+
+	/** Next matching datagram, false at the end of the file */
+	bool next(CaptureRecord &rec);
+
+	/** Records that were not UDP, were fragmented or did not match the port filter */
+	uint64_t getSkipped() const { return m_skipped; }
+
+private:
+	bool nextNative(CaptureRecord &rec);
+	bool nextPcap(CaptureRecord &rec);
+	bool decodeLink(const unsigned char *p, int len, CaptureRecord &rec);
+	bool decodeIP(const unsigned char *p, int len, CaptureRecord &rec);
+	uint32_t pcap32(const unsigned char *p) const;
+
+	static const int MaxRecord = 262144;
+
+	FILE *m_file;
+	Format m_format;
+	bool m_swapped;              //!< pcap written on a host of the other byte order
+	bool m_nanosecond;
+	uint32_t m_linkType;
+	int m_portFilter;
+	uint64_t m_skipped;
+	unsigned char *m_buf;
+};
+
+#endif /* CAPTURE_H_ */
@@ -16,42 +16,22 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.          //
 ///////////////////////////////////////////////////////////////////////////////////
 
+#include <string.h>
 #include "crc.h"
 
 const unsigned long CRC::PolyCCITT16 = 0x1021;
 const unsigned long CRC::PolyDStar16 = 0x8408;
 
-CRC::CRC(unsigned long polynomial,
-            int order,
-            unsigned long crcinit,
-            unsigned long crcxor,
-            int direct,
-            int refin,
-            int refout) :
-        m_order(order),
-        m_poly(polynomial),
-        m_direct(direct),
-        m_crcinit(crcinit),
-        m_crcxor(crcxor),
-        m_refin(refin),
-        m_refout(refout)
+struct CRCTable
 {
-    m_crcmask = ((((unsigned long) 1 << (m_order - 1)) - 1) << 1) | 1;
-    m_crchighbit = (unsigned long) 1 << (m_order - 1);
+    unsigned long tab[256];
+};
 
-    generate_crc_table();
-    init();
-}
-
-CRC::~CRC()
-{
-}
-
-unsigned long CRC::reflect(unsigned long crc, int bitnum)
+static constexpr unsigned long reflectBits(unsigned long crc, int bitnum)
 {
     // reflects the lower 'bitnum' bits of 'crc'
 
-    unsigned long i, j = 1, crcout = 0;
+    unsigned long i = 0, j = 1, crcout = 0;
 
     for (i = (unsigned long) 1 << (bitnum - 1); i; i >>= 1)
     {
@@ -62,36 +42,86 @@ unsigned long CRC::reflect(unsigned long crc, int bitnum)
     return (crcout);
 }
 
-void CRC::generate_crc_table()
+static constexpr CRCTable generateCRCTable(unsigned long poly, int order, int refin)
 {
     // make CRC lookup table used by table algorithms
 
-    int i, j;
-    unsigned long bit, crc;
+    CRCTable t{};
+    unsigned long crcmask = ((((unsigned long) 1 << (order - 1)) - 1) << 1) | 1;
+    unsigned long crchighbit = (unsigned long) 1 << (order - 1);
 
-    for (i = 0; i < 256; i++)
+    for (int i = 0; i < 256; i++)
     {
-        crc = (unsigned long) i;
+        unsigned long crc = (unsigned long) i;
 
-        if (m_refin)
-            crc = reflect(crc, 8);
+        if (refin)
+            crc = reflectBits(crc, 8);
 
-        crc <<= m_order - 8;
+        crc <<= order - 8;
 
-        for (j = 0; j < 8; j++)
+        for (int j = 0; j < 8; j++)
         {
-            bit = crc & m_crchighbit;
+            unsigned long bit = crc & crchighbit;
             crc <<= 1;
 
             if (bit)
-                crc ^= m_poly;
+                crc ^= poly;
         }
 
-        if (m_refin)
-            crc = reflect(crc, m_order);
-        crc &= m_crcmask;
-        m_crctab[i] = crc;
+        if (refin)
+            crc = reflectBits(crc, order);
+        crc &= crcmask;
+        t.tab[i] = crc;
+    }
+
+    return t;
+}
+
+// YSF FICH and DCH
+static constexpr CRCTable ccitt16Table = generateCRCTable(CRC::PolyCCITT16, 16, 0);
+
+CRC::CRC(unsigned long polynomial,
+            int order,
+            unsigned long crcinit,
+            unsigned long crcxor,
+            int direct,
+            int refin,
+            int refout) :
+        m_order(order),
+        m_poly(polynomial),
+        m_direct(direct),
+        m_crcinit(crcinit),
+        m_crcxor(crcxor),
+        m_refin(refin),
+        m_refout(refout),
+        m_crctab(nullptr),
+        m_own_crctab(nullptr)
+{
+    m_crcmask = ((((unsigned long) 1 << (m_order - 1)) - 1) << 1) | 1;
+    m_crchighbit = (unsigned long) 1 << (m_order - 1);
+
+    if ((polynomial == PolyCCITT16) && (order == 16) && !refin)
+    {
+        m_crctab = ccitt16Table.tab;
     }
+    else
+    {
+        m_own_crctab = new unsigned long[256];
+        memcpy(m_own_crctab, generateCRCTable(polynomial, order, refin).tab, sizeof(CRCTable::tab));
+        m_crctab = m_own_crctab;
+    }
+
+    init();
+}
+
+CRC::~CRC()
+{
+    delete[] m_own_crctab;
+}
+
+unsigned long CRC::reflect(unsigned long crc, int bitnum)
+{
+    return reflectBits(crc, bitnum);
 }
 
 void CRC::init()
@@ -283,37 +313,57 @@ unsigned long CRC::crcbitbybitfast(unsigned char* p, unsigned long len)
 
 // ====================================================================
 
+/* Byte-wise table for the reflected X-modem polynomial (0x8408), equivalent
+ * to feeding each data bit LSB first through the original bit-serial FCS.
+ */
+const unsigned short DStarCRC::m_crcTable[256] = {
+	0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+	0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+	0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+	0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+	0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+	0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+	0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+	0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+	0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+	0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+	0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+	0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+	0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+	0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+	0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+	0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+	0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+	0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+	0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+	0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+	0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+	0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+	0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+	0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+	0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+	0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+	0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+	0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+	0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+	0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+	0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+	0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+};
+
 DStarCRC::DStarCRC() : crc(0)
 {}
 
 DStarCRC::~DStarCRC()
 {}
 
-void DStarCRC::fcsbit(unsigned char tbyte)
-{
-	  crc ^= tbyte;
-
-	  if (crc & 1)
-	  {
-		    crc = (crc >> 1) ^ 0x8408;  // X-modem CRC poly
-	  }
-	  else
-	  {
-		    crc = crc >> 1;
-	  }
-}
-
-
 void DStarCRC::compute_crc(unsigned char *array, int size_buffer)
 {
 	crc = 0xffff;
 
 	for (int n = 0; n < (size_buffer - 2); n++)
 	{
-		for (int m = 0; m < 8; m++)
-		{    //each bit must be calculated separatly
-			fcsbit(bitRead(array[n], m));
-		}
+		crc = (crc >> 8) ^ m_crcTable[(crc ^ array[n]) & 0xff];
 	}
 
 	crc ^= 0xffff;
@@ -352,3 +402,10 @@ bool DStarCRC::check_crc(unsigned char *array, int size_buffer, unsigned int crc
         return false;
     }
 }
+
+void DStarCRC::append_crc(unsigned char *array, int size_buffer)
+{
+	compute_crc(array, size_buffer);
+	array[size_buffer - 2] = crc & 0xff;
+	array[size_buffer - 1] = (crc >> 8) & 0xff;
+}
@@ -32,6 +32,9 @@ public:
 
     ~CRC();
 
+    CRC(const CRC&) = delete;
+    CRC& operator=(const CRC&) = delete;
+
     int getOrder() const
     {
         return m_order;
@@ -90,7 +93,6 @@ public:
 
 private:
     unsigned long reflect(unsigned long crc, int bitnum);
-    void generate_crc_table();
     void init();
 
     unsigned int  m_order;   //!< CRC order (# bits) or polynomial order
@@ -105,7 +107,8 @@ private:
     unsigned long m_crchighbit;
     unsigned long m_crcinit_direct;
     unsigned long m_crcinit_nondirect;
-    unsigned long m_crctab[256];
+    const unsigned long *m_crctab;  //!< lookup table shared by all instances with the same polynomial, order and refin
+    unsigned long *m_own_crctab;    //!< generated when no shared table matches
 };
 
 /* D-Star specific CRC16 calculation. It is so weird that I just copied it from:
@@ -120,13 +123,13 @@ public:
 
 	bool check_crc(unsigned char *array, int size_buffer);
 	bool check_crc(unsigned char *array, int size_buffer, unsigned int crcVlaue);
+	void append_crc(unsigned char *array, int size_buffer); //!< store the CRC of the first size_buffer - 2 bytes in the last two
 
 private:
-	unsigned char bitRead(unsigned char value, unsigned int bit) { return (((value) >> (bit)) & 0x01); }
-	void fcsbit(unsigned char tbyte);
 	void compute_crc(unsigned char *array, int size_buffer);
 
 	unsigned int crc;
+	static const unsigned short m_crcTable[256]; //!< byte-wise lookup table for the D-Star FCS
 };
 
 #endif /* CRC_H_ */
@@ -0,0 +1,77 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "drift.h"
+
+constexpr double DriftEstimator::Smoothing;
+constexpr double DriftEstimator::Settle;
+constexpr double DriftEstimator::Kp;
+constexpr double DriftEstimator::Ki;
+constexpr double DriftEstimator::MaxTrim;
+
+static double clamp(double v, double m)
+{
+	return (v > m) ? m : (v < -m) ? -m : v;
+}
+
+DriftEstimator::DriftEstimator()
+{
+	reset();
+}
+
+void DriftEstimator::reset()
+{
+	m_integral = 0.0;
+	m_trim = 0.0;
+	restart();
+}
+
+void DriftEstimator::restart()
+{
+	m_level = 0.0;
+	m_ref = 0.0;
+	m_age = 0.0;
+	m_hasLevel = false;
+	m_hasRef = false;
+	m_trim = m_integral; // hold the last estimate until the new reference is known
+}
+
+double DriftEstimator::update(double levelUs, double dt)
+{
+	if(!m_hasLevel){
+		m_level = levelUs;
+		m_hasLevel = true;
+	}
+	else{
+		m_level += (levelUs - m_level) * dt / (Smoothing + dt);
+	}
+	m_age += dt;
+
+	if(!m_hasRef){
+		if(m_age < Settle){
+			return m_trim;
+		}
+		m_ref = m_level;
+		m_hasRef = true;
+	}
+
+	double e = m_level - m_ref;
+	m_integral = clamp(m_integral + Ki * e * dt, MaxTrim);
+	m_trim = clamp(Kp * e + m_integral, MaxTrim);
+
+	return m_trim;
+}
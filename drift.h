@@ -0,0 +1,70 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef DRIFT_H_
+#define DRIFT_H_
+
+/**
+ * Clock drift estimator for the playout buffer.
+ *
+ * Reflectors send a frame every 20 ms of their own clock and the sound card
+ * plays at its own rate, so over a long stream the audio buffered between
+ * them creeps up or drains by the difference, typically tens of ppm.  The
+ * buffered level is low pass filtered to ride out network jitter, compared
+ * with the level the stream settled at, and a PI controller turns the error
+ * into a playback trim in ppm for the adaptive resamplers.  Its integral is
+ * the drift estimate, which is kept from one stream to the next since it is
+ * a property of the two clocks.  The gains below are critically damped
+ * with a 40 s time constant, so a change in drift settles within a few
+ * minutes while network jitter barely moves the trim.
+ */
+class DriftEstimator
+{
+public:
+	DriftEstimator();
+
+	/** Forget the drift estimate as well, on a new connection */
+	void reset();
+	/** A new stream: take a new reference level, keep the drift estimate */
+	void restart();
+	/** Buffered audio in us after dt seconds of playback, returns the trim to apply */
+	double update(double levelUs, double dt);
+
+	/** Trim in ppm, positive to consume faster */
+	double getTrim() const { return m_trim; }
+	/** Estimated sender clock minus sound card clock, ppm */
+	double getDrift() const { return m_integral; }
+	/** Filtered level minus the reference, us */
+	double getError() const { return m_hasRef ? m_level - m_ref : 0.0; }
+
+	static constexpr double Smoothing = 2.0;   //!< s, time constant of the level filter
+	static constexpr double Settle = 1.0;      //!< s of a stream before its level is the reference
+	static constexpr double Kp = 0.05;         //!< ppm per us of error
+	static constexpr double Ki = Kp * Kp / 4;  //!< ppm per us.s, critical damping
+	static constexpr double MaxTrim = 1000.0;  //!< ppm
+
+private:
+	double m_level;
+	double m_ref;
+	double m_age;                              //!< s since restart()
+	bool m_hasLevel;
+	bool m_hasRef;
+	double m_integral;
+	double m_trim;
+};
+
+#endif /* DRIFT_H_ */
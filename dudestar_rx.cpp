@@ -21,9 +21,16 @@
 #include "crs129.h"
 #include "cbptc19696.h"
 #include "cgolay2087.h"
+#include "metrics.h"
+#include "packets.h"
+#include "alloccount.h"
 #include <iostream>
+#include <algorithm>
+#include <math.h>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QElapsedTimer>
+#include <QThread>
 
 #define LOBYTE(w)				((uint8_t)(uint16_t)(w & 0x00FF))
 #define HIBYTE(w)				((uint8_t)((((uint16_t)(w)) >> 8) & 0xFF))
@@ -32,13 +39,82 @@
 #define DEBUG
 //define DEBUG_YSF
 
-DudeStarRX::DudeStarRX(QWidget *parent) :
+static Metrics::Protocol protocol_id(const QString &mode)
+{
+	const char *names[Metrics::NbProtocols] = { "REF", "XRF", "DCS", "XLX", "YSF", "DMR" };
+
+	for(int i = 0; i < Metrics::NbProtocols; ++i){
+		if(mode == names[i]){
+			return (Metrics::Protocol)i;
+		}
+	}
+
+	return Metrics::NbProtocols;
+}
+
+DudeStarRX::DudeStarRX(QWidget *parent, bool headless) :
 	QMainWindow(parent),
-	ui(new Ui::DudeStarRX)
+	ui(new Ui::DudeStarRX),
+	headless(headless)
 {
 	ping_cnt = 0;
+	hdr_crc_errs = 0;
+	decoded_frames = 0;
+	audio_samples = 0;
+	audioq_frames = 0;
+	ysfq_frames = 0;
+	voice_packets = 0;
+	voice_allocs = 0;
+	shown_stream = -1;
+	shown_active = 0;
+	ysf_gateway.clear();
+	ysf_src.clear();
+	ysf_dst.clear();
+	ysf_shown_type = -1;
+	ysf_shown_path = -1;
+	proto = Metrics::NbProtocols;
+	rx_buf.reserve(MaxDatagram);
+	has_connected = false;
+	mbe = nullptr;
+	ysf = nullptr;
+	streams = nullptr;
+	stream_mix = false;
+	skip_repeats = false;
+	synth_mode = MBESynth::Mbelib;
+	synth_checked = false;
+	slow_data = nullptr;
+	ref_rptr = 0;
+	ref_rptr_mask = 0;
+	memset(ref_prio, -1, sizeof(ref_prio));
+	audio = nullptr;
+	sink = nullptr;
+	audio_latency_ms = 120;
+	output_latency = 0;
+	drift_comp = true;
+	drift_stream = -1;
+	drift_max_err = 0;
+	replay_card = false;
+	replay_skew = 0;
+	audio_rate = 8000;
+	audio_stereo = false;
 	ui->setupUi(this);
 	init_gui();
+	connect_status = DISCONNECTED;
+	audiotimer = new QTimer();
+	ping_timer = new QTimer();
+	ysftimer = new QTimer();
+	latency_timer = new QTimer();
+	connect(audiotimer, SIGNAL(timeout()), this, SLOT(process_audio()));
+	connect(ysftimer, SIGNAL(timeout()), this, SLOT(process_ysf_data()));
+	connect(ping_timer, SIGNAL(timeout()), this, SLOT(process_ping()));
+	connect(latency_timer, SIGNAL(timeout()), this, SLOT(log_latency()));
+	audiotimer->start(19);
+	ysftimer->start(90);
+
+	if(headless){
+		return; // replay or simulator client, no sound card and no settings
+	}
+
 	config_path = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
 #ifdef Q_OS_UNIX
 	config_path += "/dudestar_rx";
@@ -69,29 +145,44 @@ DudeStarRX::DudeStarRX(QWidget *parent) :
 		}
 
 		if (!info.isFormatSupported(format)) {
-			qWarning() << "Raw audio format not supported by backend, trying nearest format.";
-			format = info.nearestFormat(format);
-			qWarning() << "Format now set to " << format.sampleRate() << ":" << format.sampleSize();
+			qWarning() << "Raw audio format not supported by backend, trying resampled formats.";
+			const int rates[] = {48000, 16000, 44100, 32000, 24000, 22050};
+			bool found = false;
+			for(int c = 1; (c <= 2) && !found; ++c){
+				for(int i = 0; (i < 6) && !found; ++i){
+					format.setSampleRate(rates[i]);
+					format.setChannelCount(c);
+					found = info.isFormatSupported(format);
+				}
+			}
+			if(!found){
+				format.setSampleRate(8000);
+				format.setChannelCount(1);
+				format = info.nearestFormat(format);
+			}
+			qWarning() << "Format now set to " << format.sampleRate() << ":" << format.sampleSize() << ":" << format.channelCount();
 		}
 	}
+	audio_rate = format.sampleRate();
+	audio_stereo = (format.channelCount() == 2);
 	audio = new QAudioOutput(format, this);
-	audiotimer = new QTimer();
-	ping_timer = new QTimer();
-	ysftimer = new QTimer();
+	sink = new AudioSink(this);
 	connect(audio, SIGNAL(stateChanged(QAudio::State)), this, SLOT(handleStateChanged(QAudio::State)));
-
-	connect_status = DISCONNECTED;
-
-	connect(audiotimer, SIGNAL(timeout()), this, SLOT(process_audio()));
-	connect(ysftimer, SIGNAL(timeout()), this, SLOT(process_ysf_data()));
-	connect(ping_timer, SIGNAL(timeout()), this, SLOT(process_ping()));
-	audiotimer->start(19);
-	ysftimer->start(90);
 	process_settings();
 }
 
 DudeStarRX::~DudeStarRX()
 {
+	ysfq.clear();
+	update_queue_gauges();
+	if(headless){
+		delete[] slow_data;
+		delete streams;
+		delete ysf;
+		delete mbe;
+		delete ui;
+		return;
+	}
 	QFile f(config_path + "/settings.conf");
 	f.open(QIODevice::WriteOnly);
 	QTextStream stream(&f);
@@ -144,6 +235,7 @@ void DudeStarRX::init_gui()
 	ui->modeCombo->addItem("DMR");
 	connect(ui->modeCombo, SIGNAL(currentTextChanged(const QString &)), this, SLOT(process_mode_change(const QString &)));
 	connect(ui->hostCombo, SIGNAL(currentTextChanged(const QString &)), this, SLOT(process_host_change(const QString &)));
+	connect(ui->comboMod, SIGNAL(currentTextChanged(const QString &)), this, SLOT(process_module_change(const QString &)));
 
 	for(char m = 0x41; m < 0x5b; ++m){
 		ui->comboMod->addItem(QString(m));
@@ -241,6 +333,59 @@ void DudeStarRX::process_host_change(const QString &h)
 	}
 }
 
+void DudeStarRX::process_module_change(const QString &m)
+{
+	if(m.isEmpty() || (protocol != "REF")){
+		return;
+	}
+	module = m.toStdString()[0];
+	init_ref_match();
+}
+
+void DudeStarRX::init_ref_match()
+{
+	QByteArray h = hostname.simplified().leftJustified(7, ' ', true).toLocal8Bit();
+	const unsigned char mask[8] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00};
+	int p = 0;
+
+	h.append('\0');
+	memcpy(&ref_rptr, h.constData(), 8);
+	memcpy(&ref_rptr_mask, mask, 8);
+	ref_rptr &= ref_rptr_mask;
+	memset(ref_prio, -1, sizeof(ref_prio));
+
+	// the connected module first, then the extra ones in the order given
+	if((module >= 'A') && (module <= 'Z')){
+		ref_prio[module - 'A'] = p++;
+	}
+	for(int i = 0; i < ref_modules.size(); ++i){
+		char m = ref_modules.at(i).toLatin1();
+		if(m == '*'){
+			for(int j = 0; j < 26; ++j){
+				if(ref_prio[j] < 0){
+					ref_prio[j] = p;
+				}
+			}
+		}
+		else if((m >= 'A') && (m <= 'Z') && (ref_prio[m - 'A'] < 0)){
+			ref_prio[m - 'A'] = p++;
+		}
+	}
+}
+
+int DudeStarRX::ref_priority(const char *rptr) const
+{
+	uint64_t r;
+	unsigned char m = rptr[7] - 'A';
+
+	memcpy(&r, rptr, 8);
+	if(((r & ref_rptr_mask) != ref_rptr) || (m >= 26)){
+		return -1;
+	}
+
+	return ref_prio[m];
+}
+
 void DudeStarRX::process_mode_change(const QString &m)
 {
 	if(m == "REF"){
@@ -657,6 +802,27 @@ void DudeStarRX::disconnect_from_host()
 	udp->disconnect();
 	udp->close();
 	delete udp;
+	Metrics::add(Metrics::FramesDropped, ysfq.size());
+	ysfq.clear();
+	ysf_gateway.clear();
+	ysf_src.clear();
+	ysf_dst.clear();
+	ysf_shown_type = -1;
+	ysf_shown_path = -1;
+	shown_stream = -1;
+	if(streams){
+		streams->clear();
+	}
+	delete streams;
+	delete[] slow_data;
+	streams = nullptr;
+	slow_data = nullptr;
+	update_queue_gauges();
+	latency.clear();
+	delete ysf;
+	delete mbe;
+	ysf = nullptr;
+	mbe = nullptr;
 }
 
 void DudeStarRX::process_connect()
@@ -675,30 +841,52 @@ void DudeStarRX::process_connect()
 		if((protocol == "DCS") || (protocol == "XRF")){
 			ui->comboMod->setEnabled(true);
 		}
+		audio->stop();
+		sink->stop();
 		disconnect_from_host();
 		status_txt->setText("Not connected");
 	}
 	else{
-		hostname = ui->hostCombo->currentText().simplified();
 		QStringList sl = ui->hostCombo->currentData().toString().simplified().split(':');
-		connect_status = CONNECTING;
+		QString m = ui->modeCombo->currentText();
 		status_txt->setText("Connecting...");
 		ui->connectButton->setEnabled(false);
 		ui->connectButton->setText("Connecting");
-		host = sl.at(0).simplified();
-		port = sl.at(1).toInt();
-		callsign = ui->callsignEdit->text();
-		module = ui->comboMod->currentText().toStdString()[0];
-		protocol = ui->modeCombo->currentText();
-		if(protocol == "DMR"){
-			dmrid = dmrids.key(callsign);
-			dmr_password = sl.at(2).simplified();
-		}
-		QHostInfo::lookupHost(host, this, SLOT(hostname_lookup(QHostInfo)));
-		audiodev = audio->start();
+		connect_to_host(m, ui->hostCombo->currentText().simplified(), sl.at(0).simplified(), sl.at(1).toInt(), ui->callsignEdit->text(),
+						ui->comboMod->currentText().toStdString()[0], (m == "DMR") ? dmrids.key(ui->callsignEdit->text()) : 0,
+						(m == "DMR") ? sl.at(2).simplified() : QString());
+		// half the target in the device buffer, the decoder keeps the other half in the ring
+		audio->setBufferSize(audio_rate * (audio_stereo ? 2 : 1) * sizeof(short) * audio_latency_ms / 2000);
+		sink->set_format(audio_rate, audio_stereo ? 2 : 1, audio_latency_ms / 2);
+		sink->start();
+		audio->start(sink);
 	}
 }
 
+void DudeStarRX::connect_to_host(const QString &mode, const QString &name, const QString &h, int p, const QString &cs, char mod, uint32_t id, const QString &password)
+{
+	hostname = name;
+	host = h;
+	port = p;
+	callsign = cs;
+	module = mod;
+	ui->comboMod->setCurrentText(QString(mod));
+	protocol = mode;
+	proto = protocol_id(mode);
+	init_ref_match();
+	dmrid = id;
+	dmr_password = password;
+	connect_status = CONNECTING;
+	hdr_crc_errs = 0;
+	latency.reset();
+	drift.reset();
+	drift_stream = -1;
+	if(has_connected){
+		Metrics::inc(Metrics::Reconnects);
+	}
+	QHostInfo::lookupHost(host, this, SLOT(hostname_lookup(QHostInfo)));
+}
+
 void DudeStarRX::hostname_lookup(QHostInfo i)
 {
 	QByteArray d;
@@ -760,31 +948,166 @@ void DudeStarRX::hostname_lookup(QHostInfo i)
 	}
 }
 
+void DudeStarRX::init_decoder(MBEDecoder *decoder)
+{
+	if(!decoder->setOutputRate(audio_rate, drift_comp && sink)){
+		qWarning() << "Output rate " << audio_rate << " not supported by the decoder, using 8000";
+	}
+	decoder->setStereo(audio_stereo);
+	decoder->setAudioBuffer(audio_buf, AUDIO_BUF_FRAMES * MBEDecoder::MaxFrameSamples);
+	decoder->setSynthesis(synth_mode, synth_checked ? &synth_check : nullptr);
+}
+
+void DudeStarRX::init_streams(VoiceStreams::Vocoder v)
+{
+	streams = new VoiceStreams(v);
+	if(v == VoiceStreams::DStar){
+		slow_data = new SlowData[VoiceStreams::MaxStreams];
+	}
+	streams->setFormat(audio_rate, audio_stereo, drift_comp && sink);
+	streams->setOutput(stream_mix ? VoiceStreams::Mix : VoiceStreams::Priority);
+	streams->setSkipRepeats(skip_repeats);
+	streams->setSynthesis(synth_mode, synth_checked ? &synth_check : nullptr);
+	streams->setLatencyTracker(&latency);
+	init_routes();
+}
+
+void DudeStarRX::set_stream_routes(const QString &r)
+{
+	stream_routes = r.toUpper();
+	if(stream_routes.isEmpty() || audio_stereo){
+		return;
+	}
+	if(!audio){
+		// headless replay, its simulated sound card can always take stereo
+		audio_stereo = true;
+		return;
+	}
+
+	// routing needs a left and right channel, reopen the output in stereo when the card has it
+	QAudioFormat format = audio->format();
+	format.setChannelCount(2);
+	if(!QAudioDeviceInfo::defaultOutputDevice().isFormatSupported(format)){
+		qWarning() << "Stereo output not supported, stream routes only mute";
+		return;
+	}
+	delete audio;
+	audio = new QAudioOutput(format, this);
+	audio_stereo = true;
+	connect(audio, SIGNAL(stateChanged(QAudio::State)), this, SLOT(handleStateChanged(QAudio::State)));
+}
+
+void DudeStarRX::init_routes()
+{
+	// slot=channel[:gain dB], the slot being a DMR timeslot or a D-STAR module letter
+	QStringList routes = QString(stream_routes).replace(',', ' ').split(' ', QString::SkipEmptyParts);
+	const char *names[] = { "MUTE", "LEFT", "RIGHT", "BOTH" };
+
+	for(int i = 0; i < routes.size(); ++i){
+		QStringList r = routes.at(i).split('=');
+		QStringList c = (r.size() == 2) ? r.at(1).split(':') : QStringList();
+		int route = -1;
+
+		for(int j = 0; (j < 4) && !c.isEmpty(); ++j){
+			if(c.at(0) == names[j]){
+				route = j;
+			}
+		}
+		if((r.at(0).size() != 1) || (route < 0)){
+			qWarning() << "Bad stream route " << routes.at(i);
+			continue;
+		}
+
+		QChar slot = r.at(0).at(0);
+		float gain = (c.size() > 1) ? powf(10.0f, c.at(1).toFloat() / 20.0f) : 1.0f;
+		streams->setRoute(slot.isDigit() ? slot.digitValue() : slot.toLatin1(), route, gain);
+	}
+}
+
 void DudeStarRX::process_audio()
 {
 	int nbAudioSamples = 0;
-	short *audioSamples;
-	unsigned char d[9];
 
-	if(audioq.size() < 9){
+	if(!streams){
 		return;
 	}
-	if(!mbe){
-		return;
+	if(sink){
+		sink->set_streaming(streams->getActive() > 0);
 	}
+	if(!streams->getActive()){
+		drift_stream = -1; // the next stream takes a new reference
+	}
+	// the sound card sets the pace: decode until the ring holds the target,
+	// without one a frame per tick as the timer is close to the frame rate
+	do{
+		if(sink && !sink->wants_audio()){
+			break;
+		}
+		nbAudioSamples = streams->process(audio_buf);
+		if(!nbAudioSamples){
+			break;
+		}
+		++decoded_frames;
+		audio_samples += nbAudioSamples;
+		write_audio(audio_buf, nbAudioSamples);
+		track_drift(nbAudioSamples);
+		latency.sinkWritten();
+		update_queue_gauges();
+		emit frame_decoded();
+	} while(sink);
+}
 
-	for(int i = 0; i < 9; ++i){
-		d[i] = audioq.dequeue();
+void DudeStarRX::write_audio(const short *pcm, int n)
+{
+	if(sink){
+		sink->write_pcm(pcm, n * (audio_stereo ? 2 : 1));
 	}
-	if(protocol == "DMR"){
-		mbe->process_dmr(d);
+}
+
+qint64 DudeStarRX::buffered_us() const
+{
+	qint64 us = sink ? sink->get_queued_us() : 0;
+
+	if(streams && (streams->getSelected() >= 0)){
+		us += streams->getStream(streams->getSelected()).queue.size() * 20000;
 	}
-	else{
-		mbe->process_dstar(d);
+	if(ysf){
+		us += ysfq.size() * 100000;
 	}
-	audioSamples = mbe->getAudio(nbAudioSamples);
-	audiodev->write((const char *) audioSamples, sizeof(short) * nbAudioSamples);
-	mbe->resetAudio();
+
+	return us;
+}
+
+void DudeStarRX::track_drift(int nbSamples)
+{
+	if(!sink){
+		return; // nothing to follow without a sound card
+	}
+	int s = streams ? streams->getSelected() : 0;
+	if(s != drift_stream){
+		drift.restart(); // a new stream settles at its own level
+		drift_stream = s;
+	}
+
+	double t = drift.update(buffered_us(), nbSamples / (double)audio_rate);
+	drift_max_err = std::max(drift_max_err, fabs(drift.getError()));
+	if(drift_comp){
+		if(streams){
+			streams->setTrim(t);
+		}
+		if(mbe){
+			mbe->setTrim(t);
+		}
+	}
+}
+
+qint64 DudeStarRX::output_latency_us() const
+{
+	if(!sink || !audio || (audio->state() == QAudio::StoppedState)){
+		return 0;
+	}
+	qint64 device = audio->bufferSize() - audio->bytesFree();
+	return sink->get_queued_us() + device * 1000000 / (audio_rate * (audio_stereo ? 2 : 1) * (qint64)sizeof(short));
 }
 
 void DudeStarRX::AppendVoiceLCToBuffer(QByteArray& buffer, uint32_t uiSrcId, uint32_t uiDstId) const
@@ -840,91 +1163,388 @@ void DudeStarRX::AppendVoiceLCToBuffer(QByteArray& buffer, uint32_t uiSrcId, uin
 void DudeStarRX::tx_dmr_header()
 {
 	QByteArray out;
-	dmr_destid = ui->dmrtgEdit->text().toInt();
-
-	out.append("DMRD", 4);
-	out.append('\0');
-	out[5] = (dmrid >> 16) & 0xff;
-	out[6] = (dmrid >> 8) & 0xff;
-	out[7] = (dmrid >> 0) & 0xff;
-	out[8] = (dmr_destid >> 16) & 0xff;
-	out[9] = (dmr_destid >> 8) & 0xff;
-	out[10] = (dmr_destid >> 0) & 0xff;
-	out[11] = (dmrid >> 24) & 0xff;
-	out[12] = (dmrid >> 16) & 0xff;
-	out[13] = (dmrid >> 8) & 0xff;
-	out[14] = (dmrid >> 0) & 0xff;
-	out[15] = 0xa1;
-	out[16] = 0x0e;
-	out[17] = 0x00;
-	out[18] = 0x00;
-	out[19] = 0x00;
-	AppendVoiceLCToBuffer(out, dmrid, dmr_destid);
-	out.append(2, 0);
-
-	udp->writeDatagram(out, address, port);
+	// a comma or space separated list, in priority order
+	QStringList tgs = ui->dmrtgEdit->text().replace(',', ' ').split(' ', QString::SkipEmptyParts);
 
-	fprintf(stderr, "SEND: ");
-	for(int i = 0; i < out.size(); ++i){
-		fprintf(stderr, "%02x ", (unsigned char)out.data()[i]);
+	dmr_talkgroups.clear();
+	for(int i = 0; i < tgs.size(); ++i){
+		dmr_talkgroups.append(tgs.at(i).toUInt());
 	}
-	fprintf(stderr, "\n");
-	fflush(stderr);
+	if(dmr_talkgroups.isEmpty()){
+		dmr_talkgroups.append(0);
+	}
+	dmr_destid = dmr_talkgroups.first();
 
+	for(int i = 0; i < dmr_talkgroups.size(); ++i){
+		uint32_t tg = dmr_talkgroups.at(i);
+		out.clear();
+		out.append("DMRD", 4);
+		out.append('\0');
+		out[5] = (dmrid >> 16) & 0xff;
+		out[6] = (dmrid >> 8) & 0xff;
+		out[7] = (dmrid >> 0) & 0xff;
+		out[8] = (tg >> 16) & 0xff;
+		out[9] = (tg >> 8) & 0xff;
+		out[10] = (tg >> 0) & 0xff;
+		out[11] = (dmrid >> 24) & 0xff;
+		out[12] = (dmrid >> 16) & 0xff;
+		out[13] = (dmrid >> 8) & 0xff;
+		out[14] = (dmrid >> 0) & 0xff;
+		out[15] = 0xa1;
+		out[16] = 0x0e;
+		out[17] = i & 0xff; // one stream per talkgroup
+		out[18] = 0x00;
+		out[19] = 0x00;
+		AppendVoiceLCToBuffer(out, dmrid, tg);
+		out.append(2, 0);
+
+		send_datagram(out);
+#ifdef DEBUG
+		fprintf(stderr, "SEND: ");
+		for(int j = 0; j < out.size(); ++j){
+			fprintf(stderr, "%02x ", (unsigned char)out.data()[j]);
+		}
+		fprintf(stderr, "\n");
+		fflush(stderr);
+#endif
+	}
+}
+
+int DudeStarRX::dmr_priority(uint32_t tg) const
+{
+	int i = dmr_talkgroups.indexOf(tg);
+	return (i < 0) ? dmr_talkgroups.size() : i;
 }
 
 void DudeStarRX::process_ysf_data()
 {
 	int nbAudioSamples = 0;
 	short *audioSamples;
-	unsigned char d[115];
-	if(ysfq.size() < 115){
+	const unsigned char *d;
+	if(!ysf){
+		return;
+	}
+	if(sink){
+		sink->set_streaming(!ysfq.isEmpty());
+	}
+	if(ysfq.isEmpty()){
 		//std::cerr << "process_ysf_data() no data" << std::endl;
+		if(sink && !sink->get_queued_us()){
+			drift_stream = -1; // the over ended, the next one takes a new reference
+		}
 		return;
 	}
-	for(int i = 0; i < 115; ++i){
-		d[i] = ysfq.dequeue();
+	if(sink && !sink->wants_audio()){
+		return; // the sound card is behind, keep the frame queued
 	}
+	d = ysfq.pop();
+	latency.decodeStart();
 	DSDYSF::FICH f = ysf->process_ysf(d);
 	//std::cerr << "process_ysf_data() f: " << f << std::endl;
 	audioSamples = ysf->getAudio(nbAudioSamples);
-	if(f.getDataType() == 0){
-		ui->rptr2->setText("V/D mode 1");
-	}
-	else if(f.getDataType() == 1){
-		ui->rptr2->setText("Data Full Rate");
-	}
-	else if(f.getDataType() == 2){
-		ui->rptr2->setText("V/D mode 2");
+	latency.decodeEnd();
+	++decoded_frames;
+	audio_samples += nbAudioSamples;
+	if((int)f.getDataType() != ysf_shown_type){
+		ysf_shown_type = f.getDataType();
+		if(f.getDataType() == 0){
+			ui->rptr2->setText("V/D mode 1");
+		}
+		else if(f.getDataType() == 1){
+			ui->rptr2->setText("Data Full Rate");
+		}
+		else if(f.getDataType() == 2){
+			ui->rptr2->setText("V/D mode 2");
+		}
+		else if(f.getDataType() == 3){
+			ui->rptr2->setText("Voice Full Rate");
+		}
 	}
-	else if(f.getDataType() == 3){
-		ui->rptr2->setText("Voice Full Rate");
+	if((int)f.isInternetPath() != ysf_shown_path){
+		ysf_shown_path = f.isInternetPath();
+		ui->streamid->setText(f.isInternetPath() ? "Internet" : "Local");
 	}
-	ui->streamid->setText(f.isInternetPath() ? "Internet" : "Local");
 	ui->usertxt->setText(QString::number(f.getFrameNumber()) + "/" + QString::number(f.getFrameTotal()));
-	audiodev->write((const char *) audioSamples, sizeof(short) * nbAudioSamples);
+	write_audio(audioSamples, nbAudioSamples);
+	track_drift(nbAudioSamples);
+	latency.sinkWritten();
+	update_queue_gauges();
 	ysf->resetAudio();
+	emit frame_decoded();
 }
 
 void DudeStarRX::readyRead()
 {
-	if(protocol == "REF"){
-		readyReadREF();
+	quint16 senderPort;
+
+	while(udp->hasPendingDatagrams()){
+		// rx_buf keeps its capacity, so this only reallocates for an oversized datagram
+		rx_buf.resize(udp->pendingDatagramSize());
+		udp->readDatagram(rx_buf.data(), rx_buf.size(), nullptr, &senderPort);
+		latency.received();
+		if(capture.isOpen()){
+			capture.write(senderPort, (const unsigned char *)rx_buf.constData(), rx_buf.size());
+		}
+		process_datagram(rx_buf);
 	}
-	else if (protocol == "XLX"){
-		readyReadXLX();
+}
+
+template<class L> static Metrics::Packet dstar_packet_type(const char *d, int len)
+{
+	if(L::isVoice(d, len)){
+		return DStarVoiceView<L>(d).isLast() ? Metrics::End : Metrics::Voice;
 	}
-	else if (protocol == "XRF"){
-		readyReadXRF();
+	if(L::isHeader(d, len)){
+		return Metrics::Header;
 	}
-	else if (protocol == "DCS"){
-		readyReadDCS();
+	if(L::isEnd(d, len)){
+		return Metrics::End;
 	}
-	else if (protocol == "YSF"){
-		readyReadYSF();
+
+	return Metrics::Control;
+}
+
+static Metrics::Packet packet_type(Metrics::Protocol p, const QByteArray &buf)
+{
+	const char *d = buf.constData();
+	int len = buf.size();
+
+	switch(p){
+	case Metrics::REF:
+		return (len == 3) ? Metrics::Ping : dstar_packet_type<REFLayout>(d, len);
+	case Metrics::XRF:
+		return (len == 9) ? Metrics::Ping : dstar_packet_type<XRFLayout>(d, len);
+	case Metrics::DCS:
+		return (len == 22) ? Metrics::Ping : dstar_packet_type<DCSLayout>(d, len);
+	case Metrics::XLX:
+	case Metrics::DMR:
+		if((len == 11) && !memcmp(d, "MSTPONG", 7)){
+			return Metrics::Ping;
+		}
+		if(DMRDView::isDMRD(d, len)){
+			DMRDView v(d);
+			if(v.isDataSync()){ // voice LC header or terminator
+				return v.isTerminator() ? Metrics::End : Metrics::Header;
+			}
+			return Metrics::Voice;
+		}
+		break;
+	case Metrics::YSF:
+		if(len == 14){
+			return Metrics::Ping;
+		}
+		if(YSFDView::isYSFD(d, len)){
+			return Metrics::Voice;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return Metrics::Control;
+}
+
+void DudeStarRX::process_datagram(const QByteArray &buf)
+{
+	bool was_connected = (connect_status == CONNECTED_RW) || (connect_status == CONNECTED_RO);
+	Metrics::Packet t = (proto != Metrics::NbProtocols) ? packet_type(proto, buf) : Metrics::Control;
+	uint64_t allocs = AllocCount::get();
+
+	switch(proto){
+	case Metrics::REF:
+		readyReadREF(buf);
+		break;
+	case Metrics::XLX:
+		readyReadXLX(buf);
+		break;
+	case Metrics::XRF:
+		readyReadXRF(buf);
+		break;
+	case Metrics::DCS:
+		readyReadDCS(buf);
+		break;
+	case Metrics::YSF:
+		readyReadYSF(buf);
+		break;
+	case Metrics::DMR:
+		readyReadDMR(buf);
+		break;
+	default:
+		break;
+	}
+	if(t == Metrics::Voice){
+		++voice_packets;
+		voice_allocs += AllocCount::get() - allocs;
+	}
+	if(proto != Metrics::NbProtocols){
+		Metrics::packet(proto, t);
+	}
+	Metrics::add(Metrics::BytesReceived, buf.size());
+	update_queue_gauges();
+	if(!was_connected && ((connect_status == CONNECTED_RW) || (connect_status == CONNECTED_RO))){
+		has_connected = true;
+		Metrics::inc(Metrics::Connects);
+		emit connected();
+	}
+}
+
+void DudeStarRX::update_queue_gauges()
+{
+	int a = streams ? streams->getQueued() : 0;
+	int y = ysfq.size();
+	qint64 o = output_latency_us();
+
+	Metrics::addGauge(Metrics::AudioQueueFrames, a - audioq_frames);
+	Metrics::addGauge(Metrics::YSFQueueFrames, y - ysfq_frames);
+	Metrics::addGauge(Metrics::AudioOutputLatency, o - output_latency);
+	audioq_frames = a;
+	ysfq_frames = y;
+	output_latency = o;
+}
+
+void DudeStarRX::send_datagram(const QByteArray &out)
+{
+	if(udp){ // there is no socket while replaying a capture
+		udp->writeDatagram(out, address, port);
+		Metrics::inc(Metrics::PacketsSent);
+		Metrics::add(Metrics::BytesSent, out.size());
+	}
+}
+
+bool DudeStarRX::set_capture_file(const QString &path)
+{
+	return capture.open(path.toLocal8Bit().constData());
+}
+
+int DudeStarRX::replay(const QString &path, const QString &mode, const QString &reflector, char mod, int port, bool realtime)
+{
+	CaptureReader reader;
+	CaptureRecord rec;
+	QElapsedTimer timer;
+	uint64_t packets = 0;
+	uint64_t first = 0;
+	int64_t card_samples = 0;
+	short card[1024];
+
+	if((mode != "REF") && (mode != "XRF") && (mode != "DCS") && (mode != "XLX") && (mode != "YSF") && (mode != "DMR")){
+		fprintf(stderr, "Unknown replay mode %s\n", mode.toLocal8Bit().constData());
+		return 1;
+	}
+	if(!reader.open(path.toLocal8Bit().constData())){
+		fprintf(stderr, "Cannot open capture file %s\n", path.toLocal8Bit().constData());
+		return 1;
+	}
+	reader.setPortFilter(port);
+
+	// pick up the stream as if the handshake had just completed
+	protocol = mode;
+	proto = protocol_id(mode);
+	hostname = reflector;
+	module = mod;
+	ui->comboMod->setCurrentText(QString(mod));
+	init_ref_match();
+	connect_status = CONNECTED_RW;
+	if(replay_card){
+		sink = new AudioSink(this);
+		sink->set_format(audio_rate, audio_stereo ? 2 : 1, audio_latency_ms / 2);
+		sink->start();
+	}
+	if(protocol == "DMR"){
+		init_streams(VoiceStreams::DMR);
+	}
+	else if((protocol == "REF") || (protocol == "XRF") || (protocol == "DCS")){
+		init_streams(VoiceStreams::DStar);
+	}
+	else{
+		mbe = new MBEDecoder();
+		init_decoder(mbe);
+	}
+	if(protocol == "YSF"){
+		ysf = new DSDYSF(mbe);
+	}
+	timer.start();
+
+	while(reader.next(rec)){
+		if(!packets){
+			first = rec.timestamp;
+		}
+		if(sink){
+			// the simulated sound card plays up to the capture time of this datagram on its skewed clock
+			const int ch = audio_stereo ? 2 : 1;
+			int64_t due = (int64_t)((rec.timestamp - first) * 1e-6 * audio_rate * (1.0 + replay_skew * 1e-6)) * ch;
+			while(card_samples < due){
+				int n = (int)std::min<int64_t>(due - card_samples, sizeof(card) / sizeof(short));
+				sink->read((char *)card, n * sizeof(short));
+				card_samples += n;
+			}
+		}
+		if(realtime){
+			int64_t wait = (int64_t)(rec.timestamp - first) - timer.nsecsElapsed() / 1000;
+			if(wait > 0){
+				QThread::usleep(wait);
+			}
+		}
+		latency.received();
+		rx_buf.resize(rec.length);
+		memcpy(rx_buf.data(), rec.data, rec.length);
+		process_datagram(rx_buf);
+		++packets;
+
+		while(streams && streams->getQueued() && (!sink || sink->wants_audio())){
+			process_audio();
+		}
+		while(ysf && !ysfq.isEmpty() && (!sink || sink->wants_audio())){
+			process_ysf_data();
+		}
 	}
-	else if (protocol == "DMR"){
-		readyReadDMR();
+
+	double secs = timer.nsecsElapsed() / 1e9;
+	printf("Replayed %s in %s mode, %.3f s\n", path.toLocal8Bit().constData(), mode.toLocal8Bit().constData(), secs);
+	printf("packets:       %llu (%llu skipped), %.0f/s\n", (unsigned long long)packets, (unsigned long long)reader.getSkipped(), packets / secs);
+	printf("frames:        %llu, %.0f/s, %llu without synthesis\n", (unsigned long long)decoded_frames, decoded_frames / secs,
+		(unsigned long long)Metrics::get(Metrics::VocoderFramesSkipped));
+	printf("audio samples: %llu at %d Hz, %.1fx realtime\n", (unsigned long long)audio_samples, audio_rate, (audio_samples / (double)audio_rate) / secs);
+	printf("header CRC errors: %u\n", hdr_crc_errs);
+	if(AllocCount::isEnabled()){
+		printf("heap allocs:   %llu in %llu voice packets\n", (unsigned long long)voice_allocs, (unsigned long long)voice_packets);
+	}
+	if(sink){
+		if(drift_comp){
+			printf("drift:         card skew %+.0f ppm, estimate %+.1f ppm", replay_skew, drift.getDrift());
+		}
+		else{
+			printf("drift:         card skew %+.0f ppm, not compensated", replay_skew);
+		}
+		printf(", playout buffer error %+.1f ms at the end, %.1f ms at most\n", drift.getError() / 1000.0, drift_max_err / 1000.0);
+		printf("audio sink:    %llu underruns, %llu overruns\n", (unsigned long long)sink->get_underruns(), (unsigned long long)sink->get_overruns());
+	}
+	if(latency.isEnabled()){
+		printf("%s\n", latency.summary().c_str());
+	}
+	if(synth_checked){
+		printf("synthesis:     %s against mbelib over %llu frames, SNR %.1f dB, worst frame %.1f dB, %s (%.0f dB needed)\n",
+			   MBESynth::modeName(synth_mode), (unsigned long long)synth_check.getFrames(), synth_check.getSNR(),
+			   synth_check.getWorstSNR(), synth_check.passed() ? "passed" : "FAILED", SynthCheck::MinSNR);
+		return synth_check.passed() ? 0 : 1;
+	}
+	return 0;
+}
+
+void DudeStarRX::set_latency_log(int secs)
+{
+	latency.setEnabled(true);
+	if(secs > 0){
+		latency_timer->start(secs * 1000);
+	}
+}
+
+void DudeStarRX::log_latency()
+{
+	fprintf(stderr, "%s %s output %lld us drift %+.1f ppm\n", hostname.toLocal8Bit().constData(), latency.summary().c_str(),
+			(long long)output_latency_us(), drift.getDrift());
+	if(sink){
+		fprintf(stderr, "%s audio underruns %llu overruns %llu\n", hostname.toLocal8Bit().constData(),
+				(unsigned long long)sink->get_underruns(), (unsigned long long)sink->get_overruns());
 	}
 }
 
@@ -957,18 +1577,14 @@ void DudeStarRX::process_ping()
 		out[9] = (dmrid >> 8) & 0xff;
 		out[10] = (dmrid >> 0) & 0xff;
 	}
-	udp->writeDatagram(out, address, port);
+	send_datagram(out);
+	Metrics::inc(Metrics::PingsSent);
 }
 
-void DudeStarRX::readyReadYSF()
+void DudeStarRX::readyReadYSF(const QByteArray &buf)
 {
-	QByteArray buf;
 	QByteArray out;
-	QHostAddress sender;
-	quint16 senderPort;
-	char ysftag[11], ysfsrc[11], ysfdst[11];
-	buf.resize(udp->pendingDatagramSize());
-	udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
+
 #ifdef DEBUG_YSF
 	fprintf(stderr, "RECV: ");
 	for(int i = 0; i < buf.size(); ++i){
@@ -979,7 +1595,9 @@ void DudeStarRX::readyReadYSF()
 #endif
 	if(buf.size() == 14){
 		if(connect_status == CONNECTING){
-			ysf = new DSDYSF();
+			mbe = new MBEDecoder();
+			init_decoder(mbe);
+			ysf = new DSDYSF(mbe);
 			ui->connectButton->setText("Disconnect");
 			ui->connectButton->setEnabled(true);
 			ui->modeCombo->setEnabled(false);
@@ -991,31 +1609,32 @@ void DudeStarRX::readyReadYSF()
 		}
 		status_txt->setText(" Host: " + host + ":" + QString::number(port) + " Ping: " + QString::number(ping_cnt++));
 	}
-	if((buf.size() == 155) && (::memcmp(buf.data(), "YSFD", 4U) == 0)){
-		memcpy(ysftag, buf.data() + 4, 10);ysftag[10] = '\0';
-		memcpy(ysfsrc, buf.data() + 14, 10);ysfsrc[10] = '\0';
-		memcpy(ysfdst, buf.data() + 24, 10);ysfdst[10] = '\0';
-		ui->mycall->setText(QString(ysftag));
-		ui->urcall->setText(QString(ysfsrc));
-		ui->rptr1->setText(QString(ysfdst));
-		for(int i = 0; i < 115; ++i){
-			ysfq.enqueue(buf.data()[40+i]);
+	if(YSFDView::isYSFD(buf.constData(), buf.size())){
+		YSFDView v(buf.constData());
+
+		if(ysf_gateway.update(v.getGateway())){
+			ui->mycall->setText(QString::fromLatin1(ysf_gateway.c));
 		}
+		if(ysf_src.update(v.getSource())){
+			ui->urcall->setText(QString::fromLatin1(ysf_src.c));
+		}
+		if(ysf_dst.update(v.getDest())){
+			ui->rptr1->setText(QString::fromLatin1(ysf_dst.c));
+		}
+		if(!ysfq.push(v.getFrame())){
+			Metrics::inc(Metrics::FramesDropped);
+			latency.discarded(0);
+		}
+		latency.enqueued();
 	}
 }
 
-void DudeStarRX::readyReadDMR()
+void DudeStarRX::readyReadDMR(const QByteArray &buf)
 {
-	QByteArray buf;
 	QByteArray in;
 	QByteArray out;
-	QHostAddress sender;
-	quint16 senderPort;
-	CSHA256 sha256;
 	char buffer[400U];
 
-	buf.resize(udp->pendingDatagramSize());
-	udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
 #ifdef DEBUG
 	fprintf(stderr, "RECV: ");
 	for(int i = 0; i < buf.size(); ++i){
@@ -1026,7 +1645,8 @@ void DudeStarRX::readyReadDMR()
 #endif
 	if((buf.size() == 10) && (::memcmp(buf.data(), "RPTACK", 6U) == 0)){
 		switch(connect_status){
-		case CONNECTING:
+		case CONNECTING:{
+			CSHA256 sha256;
 			connect_status = DMR_AUTH;
 			in[0] = buf[6];
 			in[1] = buf[7];
@@ -1047,6 +1667,7 @@ void DudeStarRX::readyReadDMR()
 
 			sha256.buffer((unsigned char *)in.data(), (unsigned int)(dmr_password.size() + sizeof(uint32_t)), (unsigned char *)out.data() + 8U);
 			break;
+		}
 		case DMR_AUTH:
 			out.clear();
 			buffer[0] = 'R';
@@ -1070,7 +1691,7 @@ void DudeStarRX::readyReadDMR()
 			break;
 		case DMR_CONF:
 			connect_status = CONNECTED_RW;
-			mbe = new MBEDecoder();
+			init_streams(VoiceStreams::DMR);
 			dmr_header_timer = new QTimer();
 			connect(dmr_header_timer, SIGNAL(timeout()), this, SLOT(tx_dmr_header()));
 			ui->connectButton->setText("Disconnect");
@@ -1087,35 +1708,44 @@ void DudeStarRX::readyReadDMR()
 		default:
 			break;
 		}
-		udp->writeDatagram(out, address, port);
+		send_datagram(out);
 	}
 	if((buf.size() == 11) && (::memcmp(buf.data(), "MSTPONG", 7U) == 0)){
 		status_txt->setText(" Host: " + host + ":" + QString::number(port) + " Ping: " + QString::number(ping_cnt++));
 	}
-	if((buf.size() == 55) && (::memcmp(buf.data(), "DMRD", 4U) == 0) && ((uint8_t)buf.data()[15] <= 0x90)){
-		uint8_t dmrframe[33];
-		uint8_t dmr3ambe[27];
-		uint8_t dmrsync[7];
-		// get the 33 bytes ambe
-		memcpy(dmrframe, &(buf.data()[20]), 33);
-		// extract the 3 ambe frames
-		memcpy(dmr3ambe, dmrframe, 14);
-		dmr3ambe[13] &= 0xF0;
-		dmr3ambe[13] |= (dmrframe[19] & 0x0F);
-		memcpy(&dmr3ambe[14], &dmrframe[20], 13);
-		// extract sync
-		dmrsync[0] = dmrframe[13] & 0x0F;
-		::memcpy(&dmrsync[1], &dmrframe[14], 5);
-		dmrsync[6] = dmrframe[19] & 0xF0;
-		for(int i = 0; i < 27; ++i){
-			audioq.enqueue(dmr3ambe[i]);
-		}
-		uint32_t id = (uint32_t)((buf.data()[5] << 16) | ((buf.data()[6] << 8) & 0xff00) | ((buf.data()[7]) & 0xff));
-		ui->mycall->setText(dmrids[id]);
-		ui->urcall->setText(QString::number(id));
-		ui->rptr1->setText(QString::number((uint32_t)((buf.data()[8] << 16) | ((buf.data()[9] << 8) & 0xff00) | ((buf.data()[10]) & 0xff))));
-		ui->rptr2->setText(QString::number((uint32_t)((buf.data()[11] << 24) | ((buf.data()[12] << 16) & 0xff0000) | ((buf.data()[13] << 8) & 0xff00) | ((buf.data()[14]) & 0xff))));
-		ui->streamid->setText(QString::number(buf.data()[4] & 0xff, 16));
+	if(DMRDView::isDMRD(buf.constData(), buf.size()) && streams){
+		DMRDView v(buf.constData());
+		int s;
+		bool opened;
+
+		if(v.isTerminator()){
+			s = streams->find(v.getStreamID(), v.getSlot());
+			if(s >= 0){
+				streams->end(s);
+			}
+			return;
+		}
+
+		s = streams->open(v.getStreamID(), v.getSlot(), v.getSrcID(), v.getDstID(), dmr_priority(v.getDstID()), &opened);
+
+		if(s < 0){
+			return; // every stream slot is taken
+		}
+		if(!v.isDataSync()){
+			unsigned char ambe[27];
+			v.getAMBE(ambe);
+			for(int i = 0; i < 3; ++i){
+				streams->push(s, &ambe[9 * i]);
+			}
+		}
+		if(!show_stream(s, opened)){
+			return;
+		}
+		ui->mycall->setText(dmrids.value(v.getSrcID()));
+		ui->urcall->setText(QString::number(v.getSrcID()));
+		ui->rptr1->setText(QString::number(v.getDstID()));
+		ui->rptr2->setText(QString::number(v.getRepeaterID()));
+		ui->streamid->setText(QString::number(v.getStreamID(), 16) + ((streams->getActive() > 1) ? " +" + QString::number(streams->getActive() - 1) : QString()));
 	}
 
 	fprintf(stderr, "SEND: ");
@@ -1126,14 +1756,117 @@ void DudeStarRX::readyReadDMR()
 	fflush(stderr);
 }
 
-void DudeStarRX::readyReadXLX()
+bool DudeStarRX::show_stream(int s, bool opened)
+{
+	if((streams->getSelected() >= 0) && (streams->getSelected() != s)){
+		return false; // the display follows the stream being heard
+	}
+	if(!opened && (s == shown_stream) && (streams->getActive() == shown_active)){
+		return false; // already on display, headers repeat and DCS sends one with every frame
+	}
+	shown_stream = s;
+	shown_active = streams->getActive();
+	return true;
+}
+
+void DudeStarRX::show_slow_data(int s, int r)
+{
+	const SlowData &sd = slow_data[s];
+
+	if(r & SlowData::Text){
+		ui->usertxt->setText(QString::fromLatin1(sd.getText()));
+	}
+	if(r & (SlowData::GPS | SlowData::DPRS)){
+		ui->usertxt->setToolTip(QString::fromLatin1(sd.getLine()));
+#ifdef DEBUG
+		fprintf(stderr, "%s: %s\n", (r & SlowData::DPRS) ? "DPRS" : "GPS", sd.getLine());
+#endif
+	}
+}
+
+template<class L> void DudeStarRX::process_dstar(const QByteArray &buf)
+{
+	const char *d = buf.constData();
+	const int len = buf.size();
+	int s = -1;
+
+	if(!streams){
+		return;
+	}
+	if(L::isHeader(d, len)){
+		DStarHeaderView<L> h(d);
+		int p = 0;
+		char m = module;
+
+		if(L::HeaderCRC && !dstarcrc.check_crc((unsigned char *)h.getRadioHeader(), h.RadioHeaderSize)){
+			++hdr_crc_errs;
+			Metrics::inc(Metrics::CRCFailedDStarHeader);
+#ifdef DEBUG
+			fprintf(stderr, "Header CRC error, %u headers dropped\n", hdr_crc_errs);
+#endif
+			return;
+		}
+		if(L::MatchModule){
+			int p1 = ref_priority(h.getRptr1());
+			int p2 = ref_priority(h.getRptr2());
+			if((p1 < 0) && (p2 < 0)){
+				return; // a module that is not monitored
+			}
+			bool first = (p2 < 0) || ((p1 >= 0) && (p1 <= p2));
+			p = first ? p1 : p2;
+			m = first ? h.getRptr1()[7] : h.getRptr2()[7];
+		}
+		bool opened;
+		s = streams->open(h.getStreamID(), m, 0, 0, p, &opened);
+		if(s < 0){
+			return;
+		}
+		if(opened){
+			slow_data[s].reset();
+		}
+		if(show_stream(s, opened)){
+			ui->mycall->setText(QString::fromLatin1(h.getMycall(), h.CallsignSize));
+			ui->urcall->setText(QString::fromLatin1(h.getUrcall(), h.CallsignSize));
+			ui->rptr1->setText(QString::fromLatin1(h.getRptr1(), h.CallsignSize));
+			ui->rptr2->setText(QString::fromLatin1(h.getRptr2(), h.CallsignSize));
+			ui->streamid->setText(QString::number(h.getStreamID(), 16) + ((streams->getActive() > 1) ? " +" + QString::number(streams->getActive() - 1) : QString()));
+		}
+	}
+	if(L::isVoice(d, len)){
+		DStarVoiceView<L> v(d);
+
+		if((s < 0) && ((s = streams->find(v.getStreamID())) < 0)){
+			return;
+		}
+		streams->push(s, v.getAMBE());
+		if(v.isLast()){
+			streams->end(s);
+		}
+		int r = slow_data[s].process(v.getSeq(), v.getSlowData());
+		if(r && ((streams->getSelected() < 0) || (streams->getSelected() == s))){
+			show_slow_data(s, r);
+		}
+	}
+	if(L::isEnd(d, len)){
+		DStarVoiceView<L> v(d);
+
+		if((s = streams->find(v.getStreamID())) < 0){
+			return;
+		}
+		streams->end(s);
+		if((streams->getSelected() < 0) || (streams->getSelected() == s)){
+			ui->streamid->setText("Stream complete");
+			shown_stream = -1;
+			ui->usertxt->clear();
+			ui->usertxt->setToolTip(QString());
+		}
+	}
+}
+
+void DudeStarRX::readyReadXLX(const QByteArray &buf)
 {
-	QByteArray buf;
 	QByteArray out;
-	QHostAddress sender;
-	quint16 senderPort;
-	buf.resize(udp->pendingDatagramSize());
-	udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
+
 #ifdef DEBUG
 	fprintf(stderr, "RECV: ");
 	for(int i = 0; i < buf.size(); ++i){
@@ -1153,7 +1886,7 @@ void DudeStarRX::readyReadXLX()
 		out[5] = (dmrid >> 16) & 0xff;
 		out[6] = (dmrid >> 8) & 0xff;
 		out[7] = (dmrid >> 0) & 0xff;
-		udp->writeDatagram(out, address, port);
+		send_datagram(out);
 	}
 	else if(buf.size() == 6){
 		ping_timer->start(5000);
@@ -1168,19 +1901,10 @@ void DudeStarRX::readyReadXLX()
 */
 }
 
-void DudeStarRX::readyReadXRF()
+void DudeStarRX::readyReadXRF(const QByteArray &buf)
 {
-	QByteArray buf;
 	QByteArray out;
-	QHostAddress sender;
-	quint16 senderPort;
-	static bool sd_sync = 0;
-	static int sd_seq = 0;
-	char mycall[9], urcall[9], rptr1[9], rptr2[9];
-	static unsigned short streamid = 0, s = 0;
 
-	buf.resize(udp->pendingDatagramSize());
-	udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
 #ifdef DEBUG
 	fprintf(stderr, "RECV: ");
 	for(int i = 0; i < buf.size(); ++i){
@@ -1189,8 +1913,8 @@ void DudeStarRX::readyReadXRF()
 	fprintf(stderr, "\n");
 	fflush(stderr);
 #endif
-	if ((buf.size() == 14) && (!memcmp(buf.data()+10, "ACK", 3))){
-		mbe = new MBEDecoder();
+	if ((connect_status == CONNECTING) && (buf.size() == 14) && (!memcmp(buf.data()+10, "ACK", 3))){
+		init_streams(VoiceStreams::DStar);
 		ui->connectButton->setText("Disconnect");
 		ui->connectButton->setEnabled(true);
 		ui->modeCombo->setEnabled(false);
@@ -1205,96 +1929,16 @@ void DudeStarRX::readyReadXRF()
 		out.append(callsign);
 		out.append(8 - callsign.size(), ' ');
 		out[8] = 0;
-		udp->writeDatagram(out, address, port);
-	}
-	if((buf.size() == 56) && (!memcmp(buf.data(), "DSVT", 4))) {
-		streamid = (buf.data()[12] << 8) | (buf.data()[13] & 0xff);
-		memcpy(rptr2, buf.data() + 18, 8); rptr1[8] = '\0';
-		memcpy(rptr1, buf.data() + 26, 8); rptr2[8] = '\0';
-		memcpy(urcall, buf.data() + 34, 8); urcall[8] = '\0';
-		memcpy(mycall, buf.data() + 42, 8); mycall[8] = '\0';
-		ui->mycall->setText(QString(mycall));
-		ui->urcall->setText(QString(urcall));
-		ui->rptr1->setText(QString(rptr1));
-		ui->rptr2->setText(QString(rptr2));
-		ui->streamid->setText(QString::number(streamid, 16));	
-	}
-	if((buf.size() == 27) && (!memcmp(buf.data(), "DSVT", 4))) {
-		s = (buf.data()[12] << 8) | (buf.data()[13] & 0xff);
-		if(s != streamid){
-			return;
-		}
-		if((buf.data()[14] == 0) && (buf.data()[24] == 0x55) && (buf.data()[25] == 0x2d) && (buf.data()[26] == 0x16)){
-			sd_sync = 1;
-			sd_seq = 1;
-		}
-		if(sd_sync && (sd_seq == 1) && (buf.data()[14] == 1) && (buf.data()[24] == 0x30)){
-			user_data[0] = buf.data()[25] ^ 0x4f;
-			user_data[1] = buf.data()[26] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 2) && (buf.data()[14] == 2)){
-			user_data[2] = buf.data()[24] ^ 0x70;
-			user_data[3] = buf.data()[25] ^ 0x4f;
-			user_data[4] = buf.data()[26] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 3) && (buf.data()[14] == 3) && (buf.data()[24] == 0x31)){
-			user_data[5] = buf.data()[25] ^ 0x4f;
-			user_data[6] = buf.data()[26] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 4) && (buf.data()[14] == 4)){
-			user_data[7] = buf.data()[24] ^ 0x70;
-			user_data[8] = buf.data()[25] ^ 0x4f;
-			user_data[9] = buf.data()[26] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 5) && (buf.data()[14] == 5) && (buf.data()[24] == 0x32)){
-			user_data[10] = buf.data()[25] ^ 0x4f;
-			user_data[11] = buf.data()[26] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 6) && (buf.data()[14] == 6)){
-			user_data[12] = buf.data()[24] ^ 0x70;
-			user_data[13] = buf.data()[25] ^ 0x4f;
-			user_data[14] = buf.data()[26] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 7) && (buf.data()[14] == 7) && (buf.data()[24] == 0x33)){
-			user_data[15] = buf.data()[25] ^ 0x4f;
-			user_data[16] = buf.data()[26] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 8) && (buf.data()[14] == 8)){
-			user_data[17] = buf.data()[24] ^ 0x70;
-			user_data[18] = buf.data()[25] ^ 0x4f;
-			user_data[19] = buf.data()[26] ^ 0x93;
-			user_data[20] = '\0';
-			sd_sync = 0;
-			sd_seq = 0;
-			ui->usertxt->setText(QString::fromUtf8(user_data.data()));
-		}
-
-		for(int i = 0; i < 9; ++i){
-			audioq.enqueue(buf.data()[15+i]);
-		}
+		send_datagram(out);
+		Metrics::inc(Metrics::PingsSent);
 	}
+	process_dstar<XRFLayout>(buf);
 }
 
-void DudeStarRX::readyReadDCS()
+void DudeStarRX::readyReadDCS(const QByteArray &buf)
 {
-	QByteArray buf;
 	QByteArray out;
-	QHostAddress sender;
-	quint16 senderPort;
-	static bool sd_sync = 0;
-	static int sd_seq = 0;
-	char mycall[9], urcall[9], rptr1[9], rptr2[9];
-	static unsigned short streamid = 0;
 
-	buf.resize(udp->pendingDatagramSize());
-	udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
 #ifdef DEBUG
 	fprintf(stderr, "RECV: ");
 	for(int i = 0; i < buf.size(); ++i){
@@ -1303,8 +1947,8 @@ void DudeStarRX::readyReadDCS()
 	fprintf(stderr, "\n");
 	fflush(stderr);
 #endif
-	if ((buf.size() == 14) && (!memcmp(buf.data()+10, "ACK", 3))){
-		mbe = new MBEDecoder();
+	if ((connect_status == CONNECTING) && (buf.size() == 14) && (!memcmp(buf.data()+10, "ACK", 3))){
+		init_streams(VoiceStreams::DStar);
 		ui->connectButton->setText("Disconnect");
 		ui->connectButton->setEnabled(true);
 		ui->modeCombo->setEnabled(false);
@@ -1326,91 +1970,15 @@ void DudeStarRX::readyReadDCS()
 		out[19] = 0x00;
 		out[20] = 0x20;
 		out[21] = 0x20;
-		udp->writeDatagram(out, address, port);
-	}
-	if((buf.size() >= 100) && (!memcmp(buf.data(), "0001", 4))) {
-		streamid = (buf.data()[43] << 8) | (buf.data()[44] & 0xff);
-		memcpy(rptr2, buf.data() + 7, 8); rptr1[8] = '\0';
-		memcpy(rptr1, buf.data() + 15, 8); rptr2[8] = '\0';
-		memcpy(urcall, buf.data() + 23, 8); urcall[8] = '\0';
-		memcpy(mycall, buf.data() + 31, 8); mycall[8] = '\0';
-		ui->mycall->setText(QString(mycall));
-		ui->urcall->setText(QString(urcall));
-		ui->rptr1->setText(QString(rptr1));
-		ui->rptr2->setText(QString(rptr2));
-		ui->streamid->setText(QString::number(streamid, 16));
-
-		if((buf.data()[45] == 0) && (buf.data()[55] == 0x55) && (buf.data()[56] == 0x2d) && (buf.data()[57] == 0x16)){
-			sd_sync = 1;
-			sd_seq = 1;
-		}
-		if(sd_sync && (sd_seq == 1) && (buf.data()[45] == 1) && (buf.data()[55] == 0x30)){
-			user_data[0] = buf.data()[56] ^ 0x4f;
-			user_data[1] = buf.data()[57] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 2) && (buf.data()[45] == 2)){
-			user_data[2] = buf.data()[55] ^ 0x70;
-			user_data[3] = buf.data()[56] ^ 0x4f;
-			user_data[4] = buf.data()[57] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 3) && (buf.data()[45] == 3) && (buf.data()[55] == 0x31)){
-			user_data[5] = buf.data()[56] ^ 0x4f;
-			user_data[6] = buf.data()[57] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 4) && (buf.data()[45] == 4)){
-			user_data[7] = buf.data()[55] ^ 0x70;
-			user_data[8] = buf.data()[56] ^ 0x4f;
-			user_data[9] = buf.data()[57] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 5) && (buf.data()[45] == 5) && (buf.data()[55] == 0x32)){
-			user_data[10] = buf.data()[56] ^ 0x4f;
-			user_data[11] = buf.data()[57] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 6) && (buf.data()[45] == 6)){
-			user_data[12] = buf.data()[55] ^ 0x70;
-			user_data[13] = buf.data()[56] ^ 0x4f;
-			user_data[14] = buf.data()[57] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 7) && (buf.data()[45] == 7) && (buf.data()[55] == 0x33)){
-			user_data[15] = buf.data()[56] ^ 0x4f;
-			user_data[16] = buf.data()[57] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 8) && (buf.data()[45] == 8)){
-			user_data[17] = buf.data()[55] ^ 0x70;
-			user_data[18] = buf.data()[56] ^ 0x4f;
-			user_data[19] = buf.data()[57] ^ 0x93;
-			user_data[20] = '\0';
-			sd_sync = 0;
-			sd_seq = 0;
-			ui->usertxt->setText(QString::fromUtf8(user_data.data()));
-		}
-
-		for(int i = 0; i < 9; ++i){
-			audioq.enqueue(buf.data()[46+i]);
-		}
+		send_datagram(out);
+		Metrics::inc(Metrics::PingsSent);
 	}
+	process_dstar<DCSLayout>(buf);
 }
 
-void DudeStarRX::readyReadREF()
+void DudeStarRX::readyReadREF(const QByteArray &buf)
 {
-	QByteArray buf;
 	QByteArray out;
-	QHostAddress sender;
-	quint16 senderPort;
-	static bool sd_sync = 0;
-	static int sd_seq = 0;
-	char mycall[9], urcall[9], rptr1[9], rptr2[9];
-	static unsigned short streamid = 0, s = 0;
-
-	buf.resize(udp->pendingDatagramSize());
-	udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
 
 #ifdef DEBUG
     fprintf(stderr, "RECV: ");
@@ -1437,7 +2005,7 @@ void DudeStarRX::readyReadREF()
 		out[18] = 0x00;
 		out[19] = 0x00;
 		out.append("HS000000", 8);
-		udp->writeDatagram(out, address, port);
+		send_datagram(out);
 	}
 	if(buf.size() == 3){ //2 way keep alive ping
 		QString s;
@@ -1452,11 +2020,12 @@ void DudeStarRX::readyReadREF()
 		out[1] = 0x60;
 		out[2] = 0x00;
 		out.resize(3);
-		udp->writeDatagram(out, address, port);
+		send_datagram(out);
+		Metrics::inc(Metrics::PingsSent);
 	}
 	if((connect_status == CONNECTING) && (buf.size() == 0x08)){
 		if((buf.data()[4] == 0x4f) && (buf.data()[5] == 0x4b) && (buf.data()[6] == 0x52)){ // OKRW/OKRO response
-			mbe = new MBEDecoder();
+			init_streams(VoiceStreams::DStar);
 			ui->connectButton->setText("Disconnect");
 			ui->connectButton->setEnabled(true);
 			ui->modeCombo->setEnabled(false);
@@ -1488,99 +2057,7 @@ void DudeStarRX::readyReadREF()
         std::cerr << "Module:streamid == " << (char)buf.data()[0x1b] << ":" << std::hex << (short)((buf.data()[14] << 8) | (buf.data()[15] & 0xff)) << std::endl;
     }
 #endif
-	if((buf.size() == 0x3a) && (!memcmp(buf.data()+1, header, 5)) ){
-		memcpy(rptr2, buf.data() + 20, 8); rptr1[8] = '\0';
-		memcpy(rptr1, buf.data() + 28, 8); rptr2[8] = '\0';
-		memcpy(urcall, buf.data() + 36, 8); urcall[8] = '\0';
-		memcpy(mycall, buf.data() + 44, 8); mycall[8] = '\0';
-		module = ui->comboMod->currentText().toStdString()[0];
-		QString h = hostname + " " + module;
-		if( (QString(rptr2).simplified() == h.simplified()) || (QString(rptr1).simplified() == h.simplified()) ){
-			streamid = (buf.data()[14] << 8) | (buf.data()[15] & 0xff);
-			ui->mycall->setText(QString(mycall));
-			ui->urcall->setText(QString(urcall));
-			ui->rptr1->setText(QString(rptr1));
-			ui->rptr2->setText(QString(rptr2));
-			ui->streamid->setText(QString::number(streamid, 16));
-		}
-		else{
-			streamid = 0;
-		}
-	}
-	if((buf.size() == 0x1d) && (!memcmp(buf.data()+1, header, 5)) ){ //29
-		//for(int i = 0; i < buf.size(); ++i){
-		//	fprintf(stderr, "%02x ", (unsigned char)buf.data()[i]);
-		//}
-		//fprintf(stderr, "\n");
-		//fflush(stderr);
-		s = (buf.data()[14] << 8) | (buf.data()[15] & 0xff);
-		if(s != streamid){
-			return;
-		}
-		if((buf.data()[16] == 0) && (buf.data()[26] == 0x55) && (buf.data()[27] == 0x2d) && (buf.data()[28] == 0x16)){
-			sd_sync = 1;
-			sd_seq = 1;
-		}
-		if(sd_sync && (sd_seq == 1) && (buf.data()[16] == 1) && (buf.data()[26] == 0x30)){
-			user_data[0] = buf.data()[27] ^ 0x4f;
-			user_data[1] = buf.data()[28] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 2) && (buf.data()[16] == 2)){
-			user_data[2] = buf.data()[26] ^ 0x70;
-			user_data[3] = buf.data()[27] ^ 0x4f;
-			user_data[4] = buf.data()[28] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 3) && (buf.data()[16] == 3) && (buf.data()[26] == 0x31)){
-			user_data[5] = buf.data()[27] ^ 0x4f;
-			user_data[6] = buf.data()[28] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 4) && (buf.data()[16] == 4)){
-			user_data[7] = buf.data()[26] ^ 0x70;
-			user_data[8] = buf.data()[27] ^ 0x4f;
-			user_data[9] = buf.data()[28] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 5) && (buf.data()[16] == 5) && (buf.data()[26] == 0x32)){
-			user_data[10] = buf.data()[27] ^ 0x4f;
-			user_data[11] = buf.data()[28] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 6) && (buf.data()[16] == 6)){
-			user_data[12] = buf.data()[26] ^ 0x70;
-			user_data[13] = buf.data()[27] ^ 0x4f;
-			user_data[14] = buf.data()[28] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 7) && (buf.data()[16] == 7) && (buf.data()[26] == 0x33)){
-			user_data[15] = buf.data()[27] ^ 0x4f;
-			user_data[16] = buf.data()[28] ^ 0x93;
-			++sd_seq;
-		}
-		if(sd_sync && (sd_seq == 8) && (buf.data()[16] == 8)){
-			user_data[17] = buf.data()[26] ^ 0x70;
-			user_data[18] = buf.data()[27] ^ 0x4f;
-			user_data[19] = buf.data()[28] ^ 0x93;
-			user_data[20] = '\0';
-			sd_sync = 0;
-			sd_seq = 0;
-			ui->usertxt->setText(QString::fromUtf8(user_data.data()));
-		}
-
-		for(int i = 0; i < 9; ++i){
-			audioq.enqueue(buf.data()[17+i]);
-		}
-	}
-	if(buf.size() == 0x20){ //32
-		s = (buf.data()[14] << 8) | (buf.data()[15] & 0xff);
-		if(s != streamid){
-			return;
-		}
-		ui->streamid->setText("Stream complete");
-		ui->usertxt->clear();
-	}
+	process_dstar<REFLayout>(buf);
 }
 
 void DudeStarRX::handleStateChanged(QAudio::State)
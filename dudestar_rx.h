@@ -25,6 +25,16 @@
 #include <QLabel>
 #include "mbe.h"
 #include "ysf.h"
+#include "crc.h"
+#include "capture.h"
+#include "latency.h"
+#include "voicestreams.h"
+#include "slowdata.h"
+#include "metrics.h"
+#include "audiosink.h"
+#include "drift.h"
+#include "framequeue.h"
+#include "packets.h"
 
 namespace Ui {
 class DudeStarRX;
@@ -35,11 +45,52 @@ class DudeStarRX : public QMainWindow
 	Q_OBJECT
 
 public:
-	explicit DudeStarRX(QWidget *parent = nullptr);
+	explicit DudeStarRX(QWidget *parent = nullptr, bool headless = false);
 	~DudeStarRX();
+	bool set_capture_file(const QString &);
+	int replay(const QString &path, const QString &mode, const QString &reflector, char mod, int port, bool realtime);
+	void connect_to_host(const QString &mode, const QString &name, const QString &h, int p, const QString &cs, char mod, uint32_t id, const QString &password);
+	void set_latency_log(int secs);
+	void set_stream_mix(bool mix) { stream_mix = mix; }
+	void set_skip_repeats(bool skip) { skip_repeats = skip; }
+	/** Speech synthesis of every decoder, checked against mbelib frame by frame if check */
+	void set_synthesis(MBESynth::Mode mode, bool check) { synth_mode = mode; synth_checked = check; }
+	/** Decoded audio kept queued ahead of the sound card, applied on the next connect */
+	void set_audio_latency(int ms) { audio_latency_ms = ms; }
+	/** Follow the sound card clock with adaptive resampling, applied on the next connect */
+	void set_drift_compensation(bool on) { drift_comp = on; }
+	/** Replay against a simulated sound card running ppm fast, to measure drift compensation */
+	void set_replay_skew(double ppm) { replay_skew = ppm; replay_card = true; }
+	void set_ref_modules(const QString &m) { ref_modules = m.toUpper(); }
+	/** Channel and gain per DMR slot or D-STAR module, e.g. "1=left,2=right:-6" */
+	void set_stream_routes(const QString &);
+	const LatencyTracker &get_latency() const { return latency; }
+	/** Voice datagrams received, and heap allocations made while handling them with CONFIG+=alloc_count */
+	uint64_t get_voice_packets() const { return voice_packets; }
+	uint64_t get_voice_allocs() const { return voice_allocs; }
+
+signals:
+	void connected();
+	void frame_decoded();
 
 private:
 	void init_gui();
+	void init_decoder(MBEDecoder *);
+	void init_streams(VoiceStreams::Vocoder);
+	void init_routes();
+	int dmr_priority(uint32_t tg) const;
+	void init_ref_match();
+	int ref_priority(const char *rptr) const;
+	template<class L> void process_dstar(const QByteArray &);
+	bool show_stream(int s, bool opened);
+	void show_slow_data(int s, int r);
+	void process_datagram(const QByteArray &);
+	void send_datagram(const QByteArray &);
+	void update_queue_gauges();
+	void write_audio(const short *pcm, int n);
+	qint64 output_latency_us() const;
+	qint64 buffered_us() const;
+	void track_drift(int nbSamples);
 	Ui::DudeStarRX *ui;
 	QUdpSocket *udp = nullptr;
 	enum{
@@ -69,25 +120,72 @@ private:
 	QString saved_ysfhost;
 	QString saved_dmrhost;
 	char module;
+	QString ref_modules;               //!< modules heard after the connected one, "*" for all
+	uint64_t ref_rptr;                 //!< hostname padded to 7, the RPTR fields with the module masked off
+	uint64_t ref_rptr_mask;
+	int8_t ref_prio[26];               //!< per module A-Z, -1 if not monitored
+	QString stream_routes;
 	uint32_t dmrid;
 	uint32_t dmr_srcid;
 	uint32_t dmr_destid;
+	QList<uint32_t> dmr_talkgroups;    //!< keyed up by tx_dmr_header(), in priority order
 	QString protocol;
+	Metrics::Protocol proto;           //!< protocol, compared per datagram without a QString
 	uint64_t ping_cnt;
+	uint32_t hdr_crc_errs;
+	uint64_t decoded_frames;
+	uint64_t audio_samples;
+	int audioq_frames;                 //!< queue depths last reported to the metrics gauges
+	int ysfq_frames;
+	uint64_t voice_packets;
+	uint64_t voice_allocs;
+	int shown_stream;                  //!< stream whose header is on display, -1 if none
+	int shown_active;                  //!< active stream count on display
+	Callsign<YSFDView::CallsignSize> ysf_gateway;
+	Callsign<YSFDView::CallsignSize> ysf_src;
+	Callsign<YSFDView::CallsignSize> ysf_dst;
+	int ysf_shown_type;                //!< FICH data type and path on display, -1 if none
+	int ysf_shown_path;
+	bool has_connected;
+	bool headless;
+	CaptureWriter capture;
+	LatencyTracker latency;
+	DStarCRC dstarcrc;
 	MBEDecoder *mbe;
 	DSDYSF *ysf;
+	VoiceStreams *streams;             //!< concurrent D-STAR or DMR streams, nullptr otherwise
+	SlowData *slow_data;               //!< per stream in streams, D-STAR only
+	bool stream_mix;
+	bool skip_repeats;
+	MBESynth::Mode synth_mode;
+	bool synth_checked;
+	SynthCheck synth_check;
 	QAudioOutput *audio;
-	QIODevice *audiodev;
-	QByteArray user_data;
+	AudioSink *sink;                   //!< pulled by audio, nullptr without a sound card
+	int audio_latency_ms;
+	qint64 output_latency;             //!< last reported to the metrics gauge
+	DriftEstimator drift;
+	bool drift_comp;
+	int drift_stream;                  //!< stream the drift reference was taken on
+	double drift_max_err;              //!< us, largest filtered playout buffer error
+	bool replay_card;
+	double replay_skew;
+	int audio_rate;
+	bool audio_stereo;
+	static const int AUDIO_BUF_FRAMES = 5; // a YSF frame carries up to 5 vocoder frames
+	short audio_buf[2 * AUDIO_BUF_FRAMES * MBEDecoder::MaxFrameSamples];
 	QTimer *audiotimer;
 	QTimer *ysftimer;
 	QTimer *ping_timer;
 	QTimer *dmr_header_timer;
+	QTimer *latency_timer;
 	QString config_path;
 	QString hosts_filename;
 	QLabel *status_txt;
-	QQueue<unsigned char> audioq;
-	QQueue<unsigned char> ysfq;
+	static const int MaxDatagram = 2048;
+	static const int YSFQueueSize = 32;
+	QByteArray rx_buf;                 //!< reused for every datagram, never shrinks
+	FrameQueue<YSFDView::FrameSize, YSFQueueSize> ysfq;
 	QMap<uint32_t, QString> dmrids;
 
 	const unsigned char header[5] = {0x80,0x44,0x53,0x56,0x54}; //DVSI packet header
@@ -95,12 +193,12 @@ private slots:
 	void about();
 	void process_connect();
 	void readyRead();
-	void readyReadREF();
-	void readyReadXRF();
-	void readyReadDCS();
-	void readyReadXLX();
-	void readyReadYSF();
-	void readyReadDMR();
+	void readyReadREF(const QByteArray &);
+	void readyReadXRF(const QByteArray &);
+	void readyReadDCS(const QByteArray &);
+	void readyReadXLX(const QByteArray &);
+	void readyReadYSF(const QByteArray &);
+	void readyReadDMR(const QByteArray &);
 	void disconnect_from_host();
 	void handleStateChanged(QAudio::State);
 	void hostname_lookup(QHostInfo);
@@ -114,8 +212,10 @@ private slots:
 	void process_dmr_ids();
 	void process_mode_change(const QString &);
 	void process_host_change(const QString &);
+	void process_module_change(const QString &);
 	void process_settings();
 	void process_ping();
+	void log_latency();
 	void load_hosts_file();
 	void tx_dmr_header();
 	void start_request(QString);
@@ -22,42 +22,77 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
-CONFIG += c++11
+CONFIG += c++14
 
 SOURCES += \
         SHA256.cpp \
+        audiosink.cpp \
+        capture.cpp \
         cbptc19696.cpp \
         cgolay2087.cpp \
         chamming.cpp \
         crc.cpp \
         crs129.cpp \
+        drift.cpp \
         dudestar_rx.cpp \
         fec.cpp \
+        latency.cpp \
         main.cpp \
         mbe.cpp \
         mbefec.cpp \
+        metrics.cpp \
+        metricsserver.cpp \
+        mixer.cpp \
+        pcmring.cpp \
         pn.cpp \
+        reflectorsim.cpp \
+        resampler.cpp \
+        slowdata.cpp \
+        synth.cpp \
         viterbi.cpp \
         viterbi5.cpp \
+        voicestreams.cpp \
         ysf.cpp
 
 HEADERS += \
         SHA256.h \
+        alloccount.h \
+        audiosink.h \
+        capture.h \
         cbptc19696.h \
         cgolay2087.h \
         chamming.h \
         crc.h \
         crs129.h \
+        drift.h \
         dudestar_rx.h \
         fec.h \
+        framequeue.h \
+        latency.h \
         mbe.h \
         mbefec.h \
         mbelib_parms.h \
+        metrics.h \
+        metricsserver.h \
+        mixer.h \
+        packets.h \
+        pcmring.h \
         pn.h \
+        reflectorsim.h \
+        resampler.h \
+        slowdata.h \
+        synth.h \
         viterbi.h \
         viterbi5.h \
+        voicestreams.h \
         ysf.h
 
+# qmake CONFIG+=alloc_count counts heap allocations on the receive path (glibc only)
+alloc_count {
+    DEFINES += ALLOC_COUNT
+    SOURCES += alloccount.cpp
+}
+
 FORMS += \
     dudestar_rx.ui
 
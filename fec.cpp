@@ -17,6 +17,69 @@
 #include <string.h>
 #include "fec.h"
 
+/*
+ * Syndrome of the error pattern with bits i1, i2 and i3 set (-1 for none)
+ * against the rows x n parity check matrix H, first row in the top bit.
+ */
+static constexpr int syndromeOf(const unsigned char *H, int n, int rows, int i1, int i2, int i3)
+{
+    int syndromeI = 0;
+
+    for (int ir = 0; ir < rows; ir++)
+    {
+        int bit = H[n*ir + i1];
+
+        if (i2 >= 0)
+            bit += H[n*ir + i2];
+        if (i3 >= 0)
+            bit += H[n*ir + i3];
+
+        syndromeI += (bit % 2) << (rows-1-ir);
+    }
+
+    return syndromeI;
+}
+
+/*
+ * Every pattern of up to Width errors over the first `positions` bits, in
+ * the order the tables used to be filled in each constructor so that
+ * patterns sharing a syndrome resolve to the same one.
+ */
+template<int Size, int Width>
+static constexpr SyndromeTable<Size, Width> syndromeTable(const unsigned char *H, int n, int rows, int positions)
+{
+    SyndromeTable<Size, Width> t{};
+
+    for (int is = 0; is < Size; is++)
+        for (int w = 0; w < Width; w++)
+            t.pos[is][w] = 0xFF;
+
+    for (int i1 = 0; i1 < positions; i1++)
+    {
+        for (int i2 = i1+1; (Width > 1) && (i2 < positions); i2++)
+        {
+            for (int i3 = i2+1; (Width > 2) && (i3 < positions); i3++)
+            {
+                // 3 bit patterns
+                int syndromeI = syndromeOf(H, n, rows, i1, i2, i3);
+                t.pos[syndromeI][0] = i1;
+                t.pos[syndromeI][1] = i2;
+                t.pos[syndromeI][2] = i3;
+            }
+
+            // 2 bit patterns
+            int syndromeI = syndromeOf(H, n, rows, i1, i2, -1);
+            t.pos[syndromeI][0] = i1;
+            t.pos[syndromeI][1] = i2;
+        }
+
+        // single bit patterns
+        t.pos[syndromeOf(H, n, rows, i1, -1, -1)][0] = i1;
+    }
+
+    return t;
+}
+
 const unsigned char Hamming_7_4::m_G[7*4] = {
         1, 0, 0, 0,   1, 0, 1,
         0, 1, 0, 0,   1, 1, 1,
@@ -24,22 +87,14 @@ const unsigned char Hamming_7_4::m_G[7*4] = {
         0, 0, 0, 1,   0, 1, 1,
 };
 
-const unsigned char Hamming_7_4::m_H[7*3] = {
+constexpr unsigned char Hamming_7_4::m_H[7*3] = {
         1, 1, 1, 0,   1, 0, 0,
         0, 1, 1, 1,   0, 1, 0,
         1, 1, 0, 1,   0, 0, 1
 //      0  1  2  3 <- correctable bit positions
 };
 
-void Hamming_7_4::init()
-{
-    // correctable bit positions given syndrome bits as index (see above)
-    memset(m_corr, 0xFF, 8); // initialize with all invalid positions
-    m_corr[0b101] = 0;
-    m_corr[0b111] = 1;
-    m_corr[0b110] = 2;
-    m_corr[0b011] = 3;
-}
+constexpr SyndromeTable<8, 1> Hamming_7_4::m_corr = syndromeTable<8, 1>(Hamming_7_4::m_H, 7, 3, 4);
 
 // ========================================================================================
 
@@ -54,7 +109,7 @@ const unsigned char Hamming_12_8::m_G[12*8] = {
         0, 0, 0, 0, 0, 0, 0, 1,   0, 0, 1, 1,
 };
 
-const unsigned char Hamming_12_8::m_H[12*4] = {
+constexpr unsigned char Hamming_12_8::m_H[12*4] = {
         1, 0, 1, 0, 1, 1, 0, 0,   1, 0, 0, 0,
         1, 1, 0, 1, 0, 1, 1, 0,   0, 1, 0, 0,
         1, 1, 1, 0, 1, 0, 1, 1,   0, 0, 1, 0,
@@ -62,19 +117,7 @@ const unsigned char Hamming_12_8::m_H[12*4] = {
 //      0  1  2  3  4  5  6  7 <- correctable bit positions
 };
 
-void Hamming_12_8::init()
-{
-    // correctable bit positions given syndrome bits as index (see above)
-    memset(m_corr, 0xFF, 16); // initialize with all invalid positions
-    m_corr[0b1110] = 0;
-    m_corr[0b0111] = 1;
-    m_corr[0b1010] = 2;
-    m_corr[0b0101] = 3;
-    m_corr[0b1011] = 4;
-    m_corr[0b1100] = 5;
-    m_corr[0b0110] = 6;
-    m_corr[0b0011] = 7;
-}
+constexpr SyndromeTable<16, 1> Hamming_12_8::m_corr = syndromeTable<16, 1>(Hamming_12_8::m_H, 12, 4, 8);
 
 // ========================================================================================
 
@@ -93,7 +136,7 @@ const unsigned char Hamming_15_11::m_G[15*11] = {
 };
 
 
-const unsigned char Hamming_15_11::m_H[15*4] = {
+constexpr unsigned char Hamming_15_11::m_H[15*4] = {
         1, 1, 1, 1, 0, 1, 0, 1, 1, 0, 0,   1, 0, 0, 0,
         0, 1, 1, 1, 1, 0, 1, 0, 1, 1, 0,   0, 1, 0, 0,
         0, 0, 1, 1, 1, 1, 0, 1, 0, 1, 1,   0, 0, 1, 0,
@@ -101,22 +144,7 @@ const unsigned char Hamming_15_11::m_H[15*4] = {
 //      0  1  2  3  4  5  6  7  8  9 10  <- correctable bit positions
 };
 
-void Hamming_15_11::init()
-{
-    // correctable bit positions given syndrome bits as index (see above)
-    memset(m_corr, 0xFF, 16); // initialize with all invalid positions
-    m_corr[0b1001] = 0;
-    m_corr[0b1101] = 1;
-    m_corr[0b1111] = 2;
-    m_corr[0b1110] = 3;
-    m_corr[0b0111] = 4;
-    m_corr[0b1010] = 5;
-    m_corr[0b0101] = 6;
-    m_corr[0b1011] = 7;
-    m_corr[0b1100] = 8;
-    m_corr[0b0110] = 9;
-    m_corr[0b0011] = 10;
-}
+constexpr SyndromeTable<16, 1> Hamming_15_11::m_corr = syndromeTable<16, 1>(Hamming_15_11::m_H, 15, 4, 11);
 
 // ========================================================================================
 
@@ -134,7 +162,7 @@ const unsigned char Hamming_16_11_4::m_G[16*11] = {
         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,   0, 0, 1, 1, 1
 };
 
-const unsigned char Hamming_16_11_4::m_H[16*5] = {
+constexpr unsigned char Hamming_16_11_4::m_H[16*5] = {
         1, 1, 1, 1, 0, 1, 0, 1, 1, 0, 0,   1, 0, 0, 0, 0,
         0, 1, 1, 1, 1, 0, 1, 0, 1, 1, 0,   0, 1, 0, 0, 0,
         0, 0, 1, 1, 1, 1, 0, 1, 0, 1, 1,   0, 0, 1, 0, 0,
@@ -142,22 +170,7 @@ const unsigned char Hamming_16_11_4::m_H[16*5] = {
         1, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1,   0, 0, 0, 0, 1
 };
 
-void Hamming_16_11_4::init()
-{
-    // correctable bit positions given syndrome bits as index (see above)
-    memset(m_corr, 0xFF, 32); // initialize with all invalid positions
-    m_corr[0b10011] = 0;
-    m_corr[0b11010] = 1;
-    m_corr[0b11111] = 2;
-    m_corr[0b11100] = 3;
-    m_corr[0b01110] = 4;
-    m_corr[0b10101] = 5;
-    m_corr[0b01011] = 6;
-    m_corr[0b10110] = 7;
-    m_corr[0b11001] = 8;
-    m_corr[0b01101] = 9;
-    m_corr[0b00111] = 10;
-}
+constexpr SyndromeTable<32, 1> Hamming_16_11_4::m_corr = syndromeTable<32, 1>(Hamming_16_11_4::m_H, 16, 5, 11);
 
 // ========================================================================================
 
@@ -172,7 +185,7 @@ const unsigned char Golay_20_8::m_G[20*8] = {
         0, 0, 0, 0, 0, 0, 0, 1,    1, 0, 0, 0,  1, 1, 1, 0,  1, 0, 1, 1,
 };
 
-const unsigned char Golay_20_8::m_H[20*12] = {
+constexpr unsigned char Golay_20_8::m_H[20*12] = {
         0, 1, 0, 0, 1, 1, 1, 1,    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
         0, 1, 1, 0, 1, 0, 0, 0,    0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
         1, 0, 1, 1, 0, 1, 0, 0,    0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -204,7 +217,7 @@ const unsigned char Golay_23_12::m_G[23*12] = {
         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,   1, 0, 0, 0, 1, 1, 1, 0, 1, 0, 1,
 };
 
-const unsigned char Golay_23_12::m_H[23*11] = {
+constexpr unsigned char Golay_23_12::m_H[23*11] = {
         1, 0, 1, 0, 0, 1, 0, 0, 1, 1, 1, 1,   1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
         1, 1, 1, 1, 0, 1, 1, 0, 1, 0, 0, 0,   0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
         0, 1, 1, 1, 1, 0, 1, 1, 0, 1, 0, 0,   0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -235,7 +248,7 @@ const unsigned char Golay_24_12::m_G[24*12] = {
         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,   1, 0, 0, 0, 1, 1, 1, 0, 1, 0, 1, 1,
 };
 
-const unsigned char Golay_24_12::m_H[24*12] = {
+constexpr unsigned char Golay_24_12::m_H[24*12] = {
         1, 0, 1, 0, 0, 1, 0, 0, 1, 1, 1, 1,   1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
         1, 1, 1, 1, 0, 1, 1, 0, 1, 0, 0, 0,   0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
         0, 1, 1, 1, 1, 0, 1, 1, 0, 1, 0, 0,   0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -261,7 +274,7 @@ const unsigned char QR_16_7_6::m_G[16*7] = {
         0, 0, 0, 0, 0, 1, 0,    0, 1, 1, 1, 0, 0, 1, 0, 1,
         0, 0, 0, 0, 0, 0, 1,    0, 0, 1, 1, 1, 0, 0, 1, 1,
 };
-const unsigned char QR_16_7_6::m_H[16*9] = {
+constexpr unsigned char QR_16_7_6::m_H[16*9] = {
         0, 1, 1,  1, 1, 0, 0,   1, 0, 0, 0, 0, 0, 0, 0, 0,
         0, 0, 1,  1, 1, 1, 0,   0, 1, 0, 0, 0, 0, 0, 0, 0,
         1, 0, 0,  1, 1, 1, 1,   0, 0, 1, 0, 0, 0, 0, 0, 0,
@@ -277,7 +290,6 @@ const unsigned char QR_16_7_6::m_H[16*9] = {
 
 Hamming_7_4::Hamming_7_4()
 {
-    init();
 }
 
 Hamming_7_4::~Hamming_7_4()
@@ -320,13 +332,13 @@ bool Hamming_7_4::decode(unsigned char *rxBits) // corrects in place
 
     if (syndromeI > 0)
     {
-        if (m_corr[syndromeI] == 0xFF)
+        if (m_corr[syndromeI][0] == 0xFF)
         {
             return false;
         }
         else
         {
-            rxBits[m_corr[syndromeI]] ^= 1; // flip bit
+            rxBits[m_corr[syndromeI][0]] ^= 1; // flip bit
         }
     }
 
@@ -337,7 +349,6 @@ bool Hamming_7_4::decode(unsigned char *rxBits) // corrects in place
 
 Hamming_12_8::Hamming_12_8()
 {
-    init();
 }
 
 Hamming_12_8::~Hamming_12_8()
@@ -393,13 +404,13 @@ bool Hamming_12_8::decode(unsigned char *rxBits, unsigned char *decodedBits, int
 
         if (syndromeI > 0) // single bit error correction
         {
-            if (m_corr[syndromeI] == 0xFF) // uncorrectable error
+            if (m_corr[syndromeI][0] == 0xFF) // uncorrectable error
             {
                 correctable = false;
             }
             else
             {
-                rxBits[m_corr[syndromeI]] ^= 1; // flip bit
+                rxBits[m_corr[syndromeI][0]] ^= 1; // flip bit
             }
         }
 
@@ -414,7 +425,6 @@ bool Hamming_12_8::decode(unsigned char *rxBits, unsigned char *decodedBits, int
 
 Hamming_16_11_4::Hamming_16_11_4()
 {
-    init();
 }
 
 Hamming_16_11_4::~Hamming_16_11_4()
@@ -474,14 +484,14 @@ bool Hamming_16_11_4::decode(unsigned char *rxBits, unsigned char *decodedBits,
 
         if (syndromeI > 0) // single bit error correction
         {
-            if (m_corr[syndromeI] == 0xFF) // uncorrectable error
+            if (m_corr[syndromeI][0] == 0xFF) // uncorrectable error
             {
                 correctable = false;
                 break;
             }
             else
             {
-                rxBits[m_corr[syndromeI]] ^= 1; // flip bit
+                rxBits[m_corr[syndromeI][0]] ^= 1; // flip bit
             }
         }
 
@@ -499,7 +509,6 @@ bool Hamming_16_11_4::decode(unsigned char *rxBits, unsigned char *decodedBits,
 
 Hamming_15_11::Hamming_15_11()
 {
-    init();
 }
 
 Hamming_15_11::~Hamming_15_11()
@@ -558,14 +567,14 @@ bool Hamming_15_11::decode(unsigned char *rxBits, unsigned char *decodedBits, in
 
         if (syndromeI > 0) // single bit error correction
         {
-            if (m_corr[syndromeI] == 0xFF) // uncorrectable error
+            if (m_corr[syndromeI][0] == 0xFF) // uncorrectable error
             {
                 correctable = false;
                 break;
             }
             else
             {
-                rxBits[m_corr[syndromeI]] ^= 1; // flip bit
+                rxBits[m_corr[syndromeI][0]] ^= 1; // flip bit
             }
         }
 
@@ -583,59 +592,13 @@ bool Hamming_15_11::decode(unsigned char *rxBits, unsigned char *decodedBits, in
 
 Golay_20_8::Golay_20_8()
 {
-    init();
 }
 
 Golay_20_8::~Golay_20_8()
 {
 }
 
-void Golay_20_8::init()
-{
-    memset (m_corr, 0xFF, 3*4096);
-
-    for (int i1 = 0; i1 < 8; i1++)
-    {
-        for (int i2 = i1+1; i2 < 8; i2++)
-        {
-            for (int i3 = i2+1; i3 < 8; i3++)
-            {
-                // 3 bit patterns
-                int syndromeI = 0;
-
-                for (int ir = 0; ir < 12; ir++)
-                {
-                    syndromeI += ((m_H[20*ir + i1] +  m_H[20*ir + i2] +  m_H[20*ir + i3]) % 2) << (11-ir);
-                }
-
-                m_corr[syndromeI][0] = i1;
-                m_corr[syndromeI][1] = i2;
-                m_corr[syndromeI][2] = i3;
-            }
-
-            // 2 bit patterns
-            int syndromeI = 0;
-
-            for (int ir = 0; ir < 12; ir++)
-            {
-                syndromeI += ((m_H[20*ir + i1] +  m_H[20*ir + i2]) % 2) << (11-ir);
-            }
-
-            m_corr[syndromeI][0] = i1;
-            m_corr[syndromeI][1] = i2;
-        }
-
-        // single bit patterns
-        int syndromeI = 0;
-
-        for (int ir = 0; ir < 12; ir++)
-        {
-            syndromeI += m_H[20*ir + i1] << (11-ir);
-        }
-
-        m_corr[syndromeI][0] = i1;
-    }
-}
+constexpr SyndromeTable<4096, 3> Golay_20_8::m_corr = syndromeTable<4096, 3>(Golay_20_8::m_H, 20, 12, 8);
 
 // Not very efficient but encode is used for unit testing only
 void Golay_20_8::encode(unsigned char *origBits, unsigned char *encodedBits)
@@ -713,59 +676,13 @@ bool Golay_20_8::decode(unsigned char *rxBits)
 
 Golay_23_12::Golay_23_12()
 {
-    init();
 }
 
 Golay_23_12::~Golay_23_12()
 {
 }
 
-void Golay_23_12::init()
-{
-    memset (m_corr, 0xFF, 3*2048);
-
-    for (int i1 = 0; i1 < 11; i1++)
-    {
-        for (int i2 = i1+1; i2 < 11; i2++)
-        {
-            for (int i3 = i2+1; i3 < 11; i3++)
-            {
-                // 3 bit patterns
-                int syndromeI = 0;
-
-                for (int ir = 0; ir < 11; ir++)
-                {
-                    syndromeI += ((m_H[23*ir + i1] +  m_H[23*ir + i2] +  m_H[23*ir + i3]) % 2) << (10-ir);
-                }
-
-                m_corr[syndromeI][0] = i1;
-                m_corr[syndromeI][1] = i2;
-                m_corr[syndromeI][2] = i3;
-            }
-
-            // 2 bit patterns
-            int syndromeI = 0;
-
-            for (int ir = 0; ir < 11; ir++)
-            {
-                syndromeI += ((m_H[23*ir + i1] +  m_H[23*ir + i2]) % 2) << (10-ir);
-            }
-
-            m_corr[syndromeI][0] = i1;
-            m_corr[syndromeI][1] = i2;
-        }
-
-        // single bit patterns
-        int syndromeI = 0;
-
-        for (int ir = 0; ir < 11; ir++)
-        {
-            syndromeI += m_H[23*ir + i1] << (10-ir);
-        }
-
-        m_corr[syndromeI][0] = i1;
-    }
-}
+constexpr SyndromeTable<2048, 3> Golay_23_12::m_corr = syndromeTable<2048, 3>(Golay_23_12::m_H, 23, 11, 11);
 
 // Not very efficient but encode is used for unit testing only
 void Golay_23_12::encode(unsigned char *origBits, unsigned char *encodedBits)
@@ -846,59 +763,13 @@ bool Golay_23_12::decode(unsigned char *rxBits)
 
 Golay_24_12::Golay_24_12()
 {
-    init();
 }
 
 Golay_24_12::~Golay_24_12()
 {
 }
 
-void Golay_24_12::init()
-{
-    memset (m_corr, 0xFF, 3*4096);
-
-    for (int i1 = 0; i1 < 12; i1++)
-    {
-        for (int i2 = i1+1; i2 < 12; i2++)
-        {
-            for (int i3 = i2+1; i3 < 12; i3++)
-            {
-                // 3 bit patterns
-                int syndromeI = 0;
-
-                for (int ir = 0; ir < 12; ir++)
-                {
-                    syndromeI += ((m_H[24*ir + i1] +  m_H[24*ir + i2] +  m_H[24*ir + i3]) % 2) << (11-ir);
-                }
-
-                m_corr[syndromeI][0] = i1;
-                m_corr[syndromeI][1] = i2;
-                m_corr[syndromeI][2] = i3;
-            }
-
-            // 2 bit patterns
-            int syndromeI = 0;
-
-            for (int ir = 0; ir < 12; ir++)
-            {
-                syndromeI += ((m_H[24*ir + i1] +  m_H[24*ir + i2]) % 2) << (11-ir);
-            }
-
-            m_corr[syndromeI][0] = i1;
-            m_corr[syndromeI][1] = i2;
-        }
-
-        // single bit patterns
-        int syndromeI = 0;
-
-        for (int ir = 0; ir < 12; ir++)
-        {
-            syndromeI += m_H[24*ir + i1] << (11-ir);
-        }
-
-        m_corr[syndromeI][0] = i1;
-    }
-}
+constexpr SyndromeTable<4096, 3> Golay_24_12::m_corr = syndromeTable<4096, 3>(Golay_24_12::m_H, 24, 12, 12);
 
 // Not very efficient but encode is used for unit testing only
 void Golay_24_12::encode(unsigned char *origBits, unsigned char *encodedBits)
@@ -980,44 +851,13 @@ bool Golay_24_12::decode(unsigned char *rxBits)
 
 QR_16_7_6::QR_16_7_6()
 {
-    init();
 }
 
 QR_16_7_6::~QR_16_7_6()
 {
 }
 
-void QR_16_7_6::init()
-{
-    memset (m_corr, 0xFF, 2*512);
-
-    for (int i1 = 0; i1 < 7; i1++)
-    {
-        for (int i2 = i1+1; i2 < 7; i2++)
-        {
-            // 2 bit patterns
-            int syndromeI = 0;
-
-            for (int ir = 0; ir < 9; ir++)
-            {
-                syndromeI += ((m_H[16*ir + i1] +  m_H[16*ir + i2]) % 2) << (8-ir);
-            }
-
-            m_corr[syndromeI][0] = i1;
-            m_corr[syndromeI][1] = i2;
-        }
-
-        // single bit patterns
-        int syndromeI = 0;
-
-        for (int ir = 0; ir < 9; ir++)
-        {
-            syndromeI += m_H[16*ir + i1] << (8-ir);
-        }
-
-        m_corr[syndromeI][0] = i1;
-    }
-}
+constexpr SyndromeTable<512, 2> QR_16_7_6::m_corr = syndromeTable<512, 2>(QR_16_7_6::m_H, 16, 9, 7);
 
 // Not very efficient but encode is used for unit testing only
 void QR_16_7_6::encode(unsigned char *origBits, unsigned char *encodedBits)
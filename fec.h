@@ -17,18 +17,26 @@
 #ifndef FEC_H_
 #define FEC_H_
 
+/** Error positions by syndrome index, 0xFF after the last, built at compile time from the parity check matrix */
+template<int Size, int Width>
+struct SyndromeTable
+{
+	unsigned char pos[Size][Width];
+
+	const unsigned char *operator[](unsigned int syndrome) const { return pos[syndrome]; }
+};
+
 class Hamming_7_4
 {
 public:
 	Hamming_7_4();
 	~Hamming_7_4();
 
-	void init();
 	void encode(unsigned char *origBits, unsigned char *encodedBits);
 	bool decode(unsigned char *rxBits);
 
 private:
-	unsigned char m_corr[8];             //!< single bit error correction by syndrome index
+	static const SyndromeTable<8, 1> m_corr; //!< single bit error correction by syndrome index
     static const unsigned char m_G[7*4]; //!< Generator matrix of bits
 	static const unsigned char m_H[7*3]; //!< Parity check matrix of bits
 };
@@ -39,12 +47,11 @@ public:
     Hamming_12_8();
     ~Hamming_12_8();
 
-    void init();
 	void encode(unsigned char *origBits, unsigned char *encodedBits);
     bool decode(unsigned char *rxBits, unsigned char *decodedBits, int nbCodewords);
 
 private:
-    unsigned char m_corr[16];             //!< single bit error correction by syndrome index
+    static const SyndromeTable<16, 1> m_corr; //!< single bit error correction by syndrome index
     static const unsigned char m_G[12*8]; //!< Generator matrix of bits
     static const unsigned char m_H[12*4]; //!< Parity check matrix of bits
 };
@@ -55,12 +62,11 @@ public:
     Hamming_15_11();
     ~Hamming_15_11();
 
-    void init();
     void encode(unsigned char *origBits, unsigned char *encodedBits);
     bool decode(unsigned char *rxBits, unsigned char *decodedBits, int nbCodewords);
 
 private:
-    unsigned char m_corr[16];              //!< single bit error correction by syndrome index
+    static const SyndromeTable<16, 1> m_corr; //!< single bit error correction by syndrome index
     static const unsigned char m_G[15*11]; //!< Generator matrix of bits
     static const unsigned char m_H[15*4];  //!< Parity check matrix of bits
 };
@@ -71,12 +77,11 @@ public:
     Hamming_16_11_4();
     ~Hamming_16_11_4();
 
-    void init();
     void encode(unsigned char *origBits, unsigned char *encodedBits);
     bool decode(unsigned char *rxBits, unsigned char *decodedBits, int nbCodewords);
 
 private:
-    unsigned char m_corr[32];              //!< single bit error correction by syndrome index
+    static const SyndromeTable<32, 1> m_corr; //!< single bit error correction by syndrome index
     static const unsigned char m_G[16*11]; //!< Generator matrix of bits
     static const unsigned char m_H[16*5];  //!< Parity check matrix of bits
 };
@@ -87,12 +92,11 @@ public:
 	Golay_20_8();
 	~Golay_20_8();
 
-	void init();
 	void encode(unsigned char *origBits, unsigned char *encodedBits);
 	bool decode(unsigned char *rxBits);
 
 private:
-	unsigned char m_corr[4096][3];         //!< up to 3 bit error correction by syndrome index
+	static const SyndromeTable<4096, 3> m_corr; //!< up to 3 bit error correction by syndrome index
     static const unsigned char m_G[20*8];  //!< Generator matrix of bits
     static const unsigned char m_H[20*12]; //!< Parity check matrix of bits
 };
@@ -103,12 +107,11 @@ public:
     Golay_23_12();
     ~Golay_23_12();
 
-    void init();
     void encode(unsigned char *origBits, unsigned char *encodedBits);
     bool decode(unsigned char *rxBits);
 
 private:
-    unsigned char m_corr[2048][3];         //!< up to 3 bit error correction by syndrome index
+    static const SyndromeTable<2048, 3> m_corr; //!< up to 3 bit error correction by syndrome index
     static const unsigned char m_G[23*12]; //!< Generator matrix of bits
     static const unsigned char m_H[23*11]; //!< Parity check matrix of bits
 };
@@ -119,12 +122,11 @@ public:
     Golay_24_12();
     ~Golay_24_12();
 
-    void init();
     void encode(unsigned char *origBits, unsigned char *encodedBits);
     bool decode(unsigned char *rxBits);
 
 private:
-    unsigned char m_corr[4096][3];         //!< up to 3 bit error correction by syndrome index
+    static const SyndromeTable<4096, 3> m_corr; //!< up to 3 bit error correction by syndrome index
     static const unsigned char m_G[24*12]; //!< Generator matrix of bits
     static const unsigned char m_H[24*12]; //!< Parity check matrix of bits
 };
@@ -135,12 +137,11 @@ public:
 	QR_16_7_6();
 	~QR_16_7_6();
 
-	void init();
 	void encode(unsigned char *origBits, unsigned char *encodedBits);
 	bool decode(unsigned char *rxBits);
 
 private:
-	unsigned char m_corr[512][2];          //!< up to 2 bit error correction by syndrome index
+	static const SyndromeTable<512, 2> m_corr; //!< up to 2 bit error correction by syndrome index
     static const unsigned char m_G[16*7];  //!< Generator matrix of bits
 	static const unsigned char m_H[16*9];  //!< Parity check matrix of bits
 };
@@ -0,0 +1,67 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FRAMEQUEUE_H_
+#define FRAMEQUEUE_H_
+
+#include <string.h>
+
+/**
+ * Fixed ring of vocoder frames between the receive path and the decode
+ * timer.  The storage is part of the object, so queueing never allocates;
+ * when full the oldest frame is overwritten.
+ */
+template<int FrameSize, int Capacity> class FrameQueue
+{
+public:
+	FrameQueue() : m_head(0), m_count(0) {}
+
+	int size() const { return m_count; }
+	bool isEmpty() const { return !m_count; }
+	void clear() { m_head = 0; m_count = 0; }
+
+	/** Copy a frame in, false if the oldest one had to be dropped for it */
+	bool push(const unsigned char *frame)
+	{
+		bool room = (m_count < Capacity);
+
+		if(!room){
+			m_head = (m_head + 1) % Capacity;
+			--m_count;
+		}
+		memcpy(m_frames[(m_head + m_count) % Capacity], frame, FrameSize);
+		++m_count;
+		return room;
+	}
+
+	/** Take the oldest frame, valid until the next push() */
+	const unsigned char *pop()
+	{
+		const unsigned char *f = m_frames[m_head];
+
+		m_head = (m_head + 1) % Capacity;
+		--m_count;
+		return f;
+	}
+
+private:
+	unsigned char m_frames[Capacity][FrameSize];
+	int m_head;
+	int m_count;
+};
+
+#endif /* FRAMEQUEUE_H_ */
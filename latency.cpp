@@ -0,0 +1,243 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "latency.h"
+
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+void LatencyHistogram::reset()
+{
+	memset(m_counts, 0, sizeof(m_counts));
+	m_count = 0;
+	m_sum = 0;
+	m_max = 0;
+}
+
+int LatencyHistogram::index(int64_t us)
+{
+	if(us < SubBuckets){
+		return (us < 0) ? 0 : (int)us;
+	}
+
+	int msb = 63 - __builtin_clzll((uint64_t)us);
+	int octave = msb - SubBits + 1;
+
+	if(octave > Octaves){
+		return NbBuckets - 1;
+	}
+
+	return octave * SubBuckets + (int)((us >> (octave - 1)) - SubBuckets);
+}
+
+int64_t LatencyHistogram::upper(int idx)
+{
+	if(idx < SubBuckets){
+		return idx;
+	}
+
+	int octave = idx / SubBuckets;
+	int64_t sub = SubBuckets + idx % SubBuckets;
+	return ((sub + 1) << (octave - 1)) - 1;
+}
+
+void LatencyHistogram::record(int64_t us)
+{
+	++m_counts[index(us)];
+	++m_count;
+	m_sum += us;
+
+	if(us > m_max){
+		m_max = us;
+	}
+}
+
+int64_t LatencyHistogram::getPercentile(double p) const
+{
+	uint64_t target = (uint64_t)(p / 100.0 * m_count + 0.5);
+	uint64_t seen = 0;
+
+	if(!m_count){
+		return 0;
+	}
+	if(target < 1){
+		target = 1;
+	}
+	for(int i = 0; i < NbBuckets; ++i){
+		seen += m_counts[i];
+		if(seen >= target){
+			int64_t v = upper(i);
+			return ((v < m_max) && (i < NbBuckets - 1)) ? v : m_max;
+		}
+	}
+
+	return m_max;
+}
+
+LatencyTracker::LatencyTracker() :
+	m_enabled(false),
+	m_decoding(0),
+	m_rx(0),
+	m_pending(1)
+{
+	m_decoded.reserve(MaxPending);
+	clear();
+}
+
+void LatencyTracker::setEnabled(bool enabled)
+{
+	m_enabled = enabled;
+	clear();
+}
+
+int64_t LatencyTracker::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LatencyTracker::clear()
+{
+	for(size_t i = 0; i < m_pending.size(); ++i){
+		m_pending[i].head = 0;
+		m_pending[i].count = 0;
+	}
+
+	m_decoded.clear();
+	m_decoding = 0;
+}
+
+void LatencyTracker::clear(int queue)
+{
+	if((size_t)queue < m_pending.size()){
+		m_pending[queue].count = 0;
+	}
+}
+
+void LatencyTracker::reset()
+{
+	clear();
+
+	for(int i = 0; i < NbStages; ++i){
+		m_hist[i].reset();
+	}
+}
+
+void LatencyTracker::enqueue(int queue)
+{
+	Stamp s;
+
+	if((size_t)queue >= m_pending.size()){
+		Pending p;
+		p.head = 0;
+		p.count = 0;
+		m_pending.resize(queue + 1, p);
+	}
+
+	Pending &p = m_pending[queue];
+
+	s.rx = m_rx;
+	s.enqueued = now();
+	s.decodeStart = 0;
+	s.decodeEnd = 0;
+
+	if(p.count == MaxPending){ // the oldest frame must have been dropped unseen
+		p.head = (p.head + 1) % MaxPending;
+		--p.count;
+	}
+	p.stamps[(p.head + p.count) % MaxPending] = s;
+	++p.count;
+}
+
+void LatencyTracker::dequeue(int queue)
+{
+	if(((size_t)queue >= m_pending.size()) || !m_pending[queue].count){
+		return; // queued before tracking was enabled
+	}
+
+	Pending &p = m_pending[queue];
+
+	m_decoded.push_back(p.stamps[p.head]);
+	m_decoded.back().decodeStart = now();
+	p.head = (p.head + 1) % MaxPending;
+	--p.count;
+	++m_decoding;
+}
+
+void LatencyTracker::decoded()
+{
+	const int64_t t = now();
+
+	for(size_t i = m_decoded.size() - m_decoding; i < m_decoded.size(); ++i){
+		m_decoded[i].decodeEnd = t;
+	}
+	m_decoding = 0;
+}
+
+void LatencyTracker::drop(int queue)
+{
+	if(((size_t)queue < m_pending.size()) && m_pending[queue].count){
+		Pending &p = m_pending[queue];
+		p.head = (p.head + 1) % MaxPending;
+		--p.count;
+	}
+}
+
+void LatencyTracker::record()
+{
+	int64_t t = now();
+	const size_t done = m_decoded.size() - m_decoding;
+
+	for(size_t i = 0; i < done; ++i){
+		const Stamp &s = m_decoded[i];
+		m_hist[Parse].record(s.enqueued - s.rx);
+		m_hist[Queue].record(s.decodeStart - s.enqueued);
+		m_hist[Decode].record(s.decodeEnd - s.decodeStart);
+		m_hist[Sink].record(t - s.decodeEnd);
+		m_hist[Total].record(t - s.rx);
+	}
+
+	m_decoded.erase(m_decoded.begin(), m_decoded.begin() + done);
+}
+
+const char *LatencyTracker::getStageName(Stage s)
+{
+	static const char *names[NbStages] = {"parse", "queue", "decode", "sink", "total"};
+	return names[s];
+}
+
+std::string LatencyTracker::summary() const
+{
+	char buf[96];
+	std::string s;
+
+	snprintf(buf, sizeof(buf), "latency %llu frames, p50/p99/max us:", (unsigned long long)m_hist[Total].getCount());
+	s = buf;
+
+	for(int i = 0; i < NbStages; ++i){
+		const LatencyHistogram &h = m_hist[i];
+		snprintf(buf, sizeof(buf), " %s %lld/%lld/%lld", getStageName((Stage)i),
+				 (long long)h.getPercentile(50), (long long)h.getPercentile(99), (long long)h.getMax());
+		s += buf;
+	}
+
+	return s;
+}
@@ -0,0 +1,140 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Log-linear histogram of microsecond latencies in the manner of
+ * HdrHistogram: exact below 32 us, then 32 buckets per power of two, so any
+ * recorded value is reported within 3% with a fixed 9 KB footprint.
+ */
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void record(int64_t us);
+	void reset();
+
+	uint64_t getCount() const { return m_count; }
+	int64_t getMax() const { return m_max; }
+	double getMean() const { return m_count ? (double)m_sum / m_count : 0.0; }
+	/** Smallest recorded bucket bound below which p percent of the values fall */
+	int64_t getPercentile(double p) const;
+
+private:
+	static const int SubBits = 5;
+	static const int SubBuckets = 1 << SubBits;
+	static const int Octaves = 36;                       //!< values up to 2^41 us, longer ones are clamped
+	static const int NbBuckets = SubBuckets * (Octaves + 1);
+
+	static int index(int64_t us);
+	static int64_t upper(int idx);
+
+	uint64_t m_counts[NbBuckets];
+	uint64_t m_count;
+	int64_t m_sum;
+	int64_t m_max;
+};
+
+/**
+ * Follows every vocoder frame from datagram arrival to the audio sink write.
+ *
+ * The receive path calls received() once per datagram, enqueued() for each
+ * frame it queues, and the decode timer calls decodeStart() for each frame
+ * it takes off a queue and decodeEnd() once that frame, or the batch of
+ * frames started since the last decodeEnd(), is decoded, then sinkWritten()
+ * once the audio of all of them went out.  Frames are matched to their stamps in FIFO order
+ * per queue, so several streams can each have their own queue number.
+ * Every call returns at once while tracking is disabled.
+ */
+class LatencyTracker
+{
+public:
+	enum Stage {
+		Parse,      //!< datagram arrival to frame enqueued
+		Queue,      //!< waiting in a frame queue for the decode timer
+		Decode,     //!< FEC and vocoder
+		Sink,       //!< audio device write
+		Total,      //!< datagram arrival to audio device write
+		NbStages
+	};
+
+	LatencyTracker();
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const { return m_enabled; }
+
+	void received() { if(m_enabled) m_rx = now(); }
+	void enqueued(int queue = 0) { if(m_enabled) enqueue(queue); }
+	void decodeStart(int queue = 0) { if(m_enabled) dequeue(queue); }
+	void decodeEnd() { if(m_enabled) decoded(); }
+	void sinkWritten() { if(m_enabled) record(); }
+	/** A frame left the queue without being decoded */
+	void discarded(int queue) { if(m_enabled) drop(queue); }
+
+	/** Frames were dropped from the queues, forget their stamps */
+	void clear();
+	void clear(int queue);
+	/** Start a new session: clear and empty all histograms */
+	void reset();
+
+	const LatencyHistogram &getHistogram(Stage s) const { return m_hist[s]; }
+	static const char *getStageName(Stage s);
+	/** One line of count and p50/p99/max per stage */
+	std::string summary() const;
+
+private:
+	struct Stamp
+	{
+		int64_t rx;
+		int64_t enqueued;
+		int64_t decodeStart;
+		int64_t decodeEnd;
+	};
+
+	static const int MaxPending = 64;       //!< per queue, more than any frame queue holds
+
+	/** Fixed ring so tracking a frame never allocates */
+	struct Pending
+	{
+		Stamp stamps[MaxPending];
+		int head;
+		int count;
+	};
+
+	static int64_t now();
+	void enqueue(int queue);
+	void dequeue(int queue);
+	void decoded();
+	void drop(int queue);
+	void record();
+
+	bool m_enabled;
+	size_t m_decoding;                      //!< stamps at the end of m_decoded still being decoded
+	int64_t m_rx;
+	std::vector<Pending> m_pending;         //!< per queue
+	std::vector<Stamp> m_decoded;           //!< decoded since the last sink write
+	LatencyHistogram m_hist[NbStages];
+};
+
+#endif /* LATENCY_H_ */
@@ -16,12 +16,117 @@
 */
 
 #include "dudestar_rx.h"
+#include "reflectorsim.h"
+#include "metricsserver.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <string.h>
+#include <algorithm>
 
 int main(int argc, char *argv[])
 {
+	bool headless = false;
+
+	for(int i = 1; i < argc; ++i){
+		if(!strncmp(argv[i], "--replay", 8) || !strncmp(argv[i], "--simulate", 10)){
+			headless = true;
+		}
+	}
+	if(headless && qgetenv("QT_QPA_PLATFORM").isEmpty()){
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+
 	QApplication a(argc, argv);
-	DudeStarRX dsrx;
+	QCommandLineParser parser;
+	QCommandLineOption capture_opt("capture", "Record every received datagram to <file>.", "file");
+	QCommandLineOption replay_opt("replay", "Decode a capture or pcap <file> without a window or sound card and print throughput.", "file");
+	QCommandLineOption mode_opt("mode", "Protocol of the replayed capture: REF, XRF, DCS, YSF or DMR.", "mode", "REF");
+	QCommandLineOption reflector_opt("reflector", "Reflector name the REF headers are matched against, e.g. REF001.", "name");
+	QCommandLineOption module_opt("module", "Reflector module the REF headers are matched against.", "module", "C");
+	QCommandLineOption port_opt("port", "Only replay datagrams sent from this UDP port.", "port", "-1");
+	QCommandLineOption realtime_opt("realtime", "Replay at the captured packet rate instead of as fast as possible.");
+	QCommandLineOption simulate_opt("simulate", "Run headless clients against a local <mode> reflector simulator and print connect time, latency and CPU load.", "mode");
+	QCommandLineOption sessions_opt("sessions", "Number of simulated client sessions.", "n", "1");
+	QCommandLineOption speed_opt("speed", "Simulated voice packet rate relative to real time.", "x", "1");
+	QCommandLineOption seconds_opt("seconds", "Length of the simulation.", "s", "30");
+	QCommandLineOption metrics_opt("metrics", "Serve Prometheus metrics on http://127.0.0.1:<port>/metrics.", "port");
+	QCommandLineOption modules_opt("modules", "Also hear these REF modules besides the connected one, e.g. ABD, or * for all of them.", "modules");
+	QCommandLineOption route_opt("route", "Send the streams of a DMR slot or D-STAR module to one channel with a gain in dB, e.g. 1=left,2=right:-6 or A=both,B=mute.", "routes");
+	QCommandLineOption mix_opt("mix", "Mix concurrent DMR streams instead of playing the one on the first listed talkgroup.");
+	QCommandLineOption skip_repeats_opt("skip-repeats", "Play a repeated AMBE frame from the audio of the first instead of decoding it again.");
+	QCommandLineOption synth_opt("synth", "Speech synthesis: mbelib, or the in tree float or fixed point oscillators.", "engine", "mbelib");
+	QCommandLineOption synth_check_opt("synth-check", "Replay with the in tree synthesis and report its SNR against mbelib on every frame.");
+	QCommandLineOption audio_latency_opt("audio-latency", "Decoded audio to keep queued ahead of the sound card, in ms.", "ms", "120");
+	QCommandLineOption no_drift_opt("no-drift", "Do not follow the sound card clock with adaptive resampling.");
+	QCommandLineOption skew_opt("skew", "Replay against a simulated sound card whose clock runs <ppm> fast, or slow if negative, and report the drift compensation.", "ppm");
+	QCommandLineOption latency_opt("latency", "Track per frame latency from datagram arrival to audio write and log p50/p99/max every <secs> seconds.", "secs");
+	parser.setApplicationDescription("DUDE-Star RX");
+	parser.addHelpOption();
+	parser.addOption(capture_opt);
+	parser.addOption(replay_opt);
+	parser.addOption(mode_opt);
+	parser.addOption(reflector_opt);
+	parser.addOption(module_opt);
+	parser.addOption(port_opt);
+	parser.addOption(realtime_opt);
+	parser.addOption(simulate_opt);
+	parser.addOption(sessions_opt);
+	parser.addOption(speed_opt);
+	parser.addOption(seconds_opt);
+	parser.addOption(latency_opt);
+	parser.addOption(audio_latency_opt);
+	parser.addOption(no_drift_opt);
+	parser.addOption(skew_opt);
+	parser.addOption(metrics_opt);
+	parser.addOption(mix_opt);
+	parser.addOption(skip_repeats_opt);
+	parser.addOption(synth_opt);
+	parser.addOption(synth_check_opt);
+	parser.addOption(route_opt);
+	parser.addOption(modules_opt);
+	parser.process(a);
+
+	MetricsServer metrics;
+
+	if(parser.isSet(metrics_opt) && !metrics.listen(QHostAddress::LocalHost, parser.value(metrics_opt).toUShort())){
+		qWarning() << "Cannot serve metrics on port " << parser.value(metrics_opt);
+	}
+
+	if(parser.isSet(simulate_opt)){
+		return run_simulation(parser.value(simulate_opt).toUpper(), std::max(1, parser.value(sessions_opt).toInt()),
+							  std::max(0.01, parser.value(speed_opt).toDouble()), parser.value(seconds_opt).toInt());
+	}
+
+	DudeStarRX dsrx(nullptr, headless);
+
+	if(parser.isSet(latency_opt)){
+		dsrx.set_latency_log(parser.value(latency_opt).toInt());
+	}
+	dsrx.set_stream_mix(parser.isSet(mix_opt));
+	dsrx.set_skip_repeats(parser.isSet(skip_repeats_opt));
+	MBESynth::Mode synth = MBESynth::Mbelib;
+	if(!MBESynth::parseMode(parser.value(synth_opt).toLower().toLatin1().constData(), &synth)){
+		qWarning() << "Unknown synthesis " << parser.value(synth_opt) << ", using mbelib";
+	}
+	if(parser.isSet(synth_check_opt) && (synth == MBESynth::Mbelib)){
+		synth = MBESynth::Float;
+	}
+	dsrx.set_synthesis(synth, parser.isSet(synth_check_opt));
+	dsrx.set_audio_latency(std::max(20, parser.value(audio_latency_opt).toInt()));
+	dsrx.set_drift_compensation(!parser.isSet(no_drift_opt));
+	if(parser.isSet(skew_opt)){
+		dsrx.set_replay_skew(parser.value(skew_opt).toDouble());
+	}
+	dsrx.set_ref_modules(parser.value(modules_opt));
+	dsrx.set_stream_routes(parser.value(route_opt));
+	if(headless){
+		QString m = parser.value(module_opt).toUpper();
+		return dsrx.replay(parser.value(replay_opt), parser.value(mode_opt).toUpper(), parser.value(reflector_opt),
+						   m.isEmpty() ? 'C' : m.toStdString()[0], parser.value(port_opt).toInt(), parser.isSet(realtime_opt));
+	}
+	if(parser.isSet(capture_opt) && !dsrx.set_capture_file(parser.value(capture_opt))){
+		qWarning() << "Cannot open capture file " << parser.value(capture_opt);
+	}
 	dsrx.show();
 
 	return a.exec();
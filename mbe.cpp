@@ -23,179 +23,627 @@
 #include <math.h>
 #include "mbe.h"
 #include "mbelib_parms.h"
+#include "resampler.h"
+#include "metrics.h"
+#include "mbefec.h"
 
-const int MBEDecoder::dW[72] = {0,0,3,2,1,1,0,0,1,1,0,0,3,2,1,1,3,2,1,1,0,0,3,2,0,0,3,2,1,1,0,0,1,1,0,0,
-                                3,2,1,1,3,2,1,1,0,0,3,2,0,0,3,2,1,1,0,0,1,1,0,0,3,2,1,1,3,3,2,1,0,0,3,3,};
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-const int MBEDecoder::dX[72] = {10,22,11,9,10,22,11,23,8,20,9,21,10,8,9,21,8,6,7,19,8,20,9,7,6,18,7,5,6,18,7,19,4,16,5,17,6,
-                                4,5,17,4,2,3,15,4,16,5,3,2,14,3,1,2,14,3,15,0,12,1,13,2,0,1,13,0,12,10,11,0,12,1,13,};
-
-const int MBEDecoder::rW[36] = {
-  0, 1, 0, 1, 0, 1,
-  0, 1, 0, 1, 0, 1,
-  0, 1, 0, 1, 0, 1,
-  0, 1, 0, 1, 0, 2,
-  0, 2, 0, 2, 0, 2,
-  0, 2, 0, 2, 0, 2
-};
-
-const int MBEDecoder::rX[36] = {
-  23, 10, 22, 9, 21, 8,
-  20, 7, 19, 6, 18, 5,
-  17, 4, 16, 3, 15, 2,
-  14, 1, 13, 0, 12, 10,
-  11, 9, 10, 8, 9, 7,
-  8, 6, 7, 5, 6, 4
+/*
+ * AMBE bit unpack schedules flattened to offsets into ambe_fr[4][24], eight
+ * destinations per received byte.
+ *
+ * D-Star: entry 8*i + j is bit j (LSB first) of byte i, ie. dW[k]*24 + dX[k]
+ * of the former w/x walk.
+ */
+const unsigned char MBEDecoder::dI[72] = {
+	10, 22, 83, 57, 34, 46, 11, 23,
+	32, 44,  9, 21, 82, 56, 33, 45,
+	80, 54, 31, 43,  8, 20, 81, 55,
+	 6, 18, 79, 53, 30, 42,  7, 19,
+	28, 40,  5, 17, 78, 52, 29, 41,
+	76, 50, 27, 39,  4, 16, 77, 51,
+	 2, 14, 75, 49, 26, 38,  3, 15,
+	24, 36,  1, 13, 74, 48, 25, 37,
+	72, 84, 58, 35,  0, 12, 73, 85
 };
 
-// bit 0
-const int MBEDecoder::rY[36] = {
-  0, 2, 0, 2, 0, 2,
-  0, 2, 0, 3, 0, 3,
-  1, 3, 1, 3, 1, 3,
-  1, 3, 1, 3, 1, 3,
-  1, 3, 1, 3, 1, 3,
-  1, 3, 1, 3, 1, 3
+/*
+ * DMR: entry 8*i + j is bit 7 - j (MSB first) of byte i, alternating between
+ * the bit 1 (rW/rX) and bit 0 (rY/rZ) schedules of the AMBE 3600x2450 dibits.
+ */
+const unsigned char MBEDecoder::rI[72] = {
+	23,  5, 34, 51, 22,  4, 33, 50,
+	21,  3, 32, 49, 20,  2, 31, 48,
+	19,  1, 30, 85, 18,  0, 29, 84,
+	17, 46, 28, 83, 16, 45, 27, 82,
+	15, 44, 26, 81, 14, 43, 25, 80,
+	13, 42, 24, 79, 12, 41, 58, 78,
+	11, 40, 57, 77, 10, 39, 56, 76,
+	 9, 38, 55, 75,  8, 37, 54, 74,
+	 7, 36, 53, 73,  6, 35, 52, 72
 };
 
-const int MBEDecoder::rZ[36] = {
-  5, 3, 4, 2, 3, 1,
-  2, 0, 1, 13, 0, 12,
-  22, 11, 21, 10, 20, 9,
-  19, 8, 18, 7, 17, 6,
-  16, 5, 15, 4, 14, 3,
-  13, 2, 12, 1, 11, 0
-};
+// frames as they arrive from the network, ie. before unpack_dstar()/unpack_dmr()
+const unsigned char MBEDecoder::dstar_silence[9] = { 0x9e, 0x8d, 0x32, 0x88, 0x26, 0x1a, 0x3f, 0x61, 0xe8 };
+const unsigned char MBEDecoder::dmr_silence[9] = { 0xb9, 0xe8, 0x81, 0x52, 0x61, 0x73, 0x00, 0x2a, 0x6b };
 
 MBEDecoder::MBEDecoder() :
-	m_upsamplerLastValue(0.0f),
-	m_mbelibParms(nullptr)
+	m_mbelibParms(nullptr),
+	m_audio_out_float_buf(nullptr),
+	m_resampler(nullptr),
+	m_synth(nullptr),
+	m_check(nullptr),
+	m_repeat(false),
+	m_reference(nullptr),
+	m_reference_data(nullptr),
+	m_audio_out_buf(nullptr)
 {
 	m_mbelibParms = new mbelibParms();
-    m_audio_out_temp_buf_p = m_audio_out_temp_buf;
-	memset(m_audio_out_float_buf, 0, sizeof(float) * 1120);
-	m_audio_out_float_buf_p = m_audio_out_float_buf;
-	memset(m_aout_max_buf, 0, sizeof(float) * 200);
+	memset(m_aout_max_buf, 0, sizeof(m_aout_max_buf));
 	m_aout_max_buf_p = m_aout_max_buf;
 	m_aout_max_buf_idx = 0;
 
-	memset(m_audio_out_buf, 0, sizeof(short) * 2 * 48000);
-	m_audio_out_buf_p = m_audio_out_buf;
+	m_audio_out_buf_p = nullptr;
 	m_audio_out_nb_samples = 0;
-	m_audio_out_buf_size = 48000; // given in number of unique samples
-	m_audio_out_idx = 0;
-	m_audio_out_idx2 = 0;
+	m_audio_out_buf_size = 0;
 
 	m_aout_gain = 25;
 	m_volume = 1.0f;
 	m_auto_gain = true;
 	m_stereo = false;
 	m_channels = 3; // both channels by default if stereo is set
-	m_upsample = 0;
+	m_skip_repeats = false;
+	m_skipped = 0;
 
 	initMbeParms();
 	memset(ambe_d, 0, 49);
+	memset(m_ambe_fr, 0, sizeof(m_ambe_fr));
 }
 
 MBEDecoder::~MBEDecoder()
 {
+	delete[] m_audio_out_float_buf;
+	delete m_resampler;
+	delete m_synth;
 	delete m_mbelibParms;
 }
 
+bool MBEDecoder::setOutputRate(int rate, bool adaptive)
+{
+	delete[] m_audio_out_float_buf;
+	delete m_resampler;
+	m_audio_out_float_buf = nullptr;
+	m_resampler = nullptr;
+
+	if((rate == 8000) && !adaptive){
+		return true;
+	}
+
+	if((rate < 8000) || (rate * 160 > MaxFrameSamples * 8000)){
+		return false;
+	}
+
+	m_resampler = new Resampler(rate, 8000, adaptive);
+	if(m_resampler->maxOutput(160) > MaxFrameSamples){
+		delete m_resampler;
+		m_resampler = nullptr;
+		return setOutputRate(rate, false); // no room left to play slower
+	}
+	m_audio_out_float_buf = new float[m_resampler->maxOutput(160)];
+	return true;
+}
+
+void MBEDecoder::setTrim(double ppm)
+{
+	if(m_resampler){
+		m_resampler->setTrim(ppm);
+	}
+}
+
+void MBEDecoder::setSynthesis(MBESynth::Mode mode, SynthCheck *check)
+{
+	delete m_synth;
+	m_synth = (mode == MBESynth::Mbelib) ? nullptr : new MBESynth(mode);
+	m_check = m_synth ? check : nullptr;
+	if(m_check){
+		m_synth->setLibcRandom(true);
+	}
+}
+
+int MBEDecoder::getOutputRate() const
+{
+	return m_resampler ? m_resampler->getOutputRate() : 8000;
+}
+
 void MBEDecoder::initMbeParms()
 {
 	mbe_initMbeParms(m_mbelibParms->m_cur_mp, m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced);
 	m_errs = 0;
 	m_errs2 = 0;
 	m_err_str[0] = 0;
+	m_silent = false;
+	m_last_valid = false;
 
 	if (m_auto_gain){
 	m_aout_gain = 25;
 	}
 }
 
-void MBEDecoder::process_dstar(unsigned char *d)
+void MBEDecoder::unpack_dstar(const unsigned char *d, char ambe_fr[4][24])
 {
-	char ambe_fr[4][24];
+	char *fr = &ambe_fr[0][0];
+	const unsigned char *p = dI;
 
-	memset(ambe_fr, 0, 96);
-	w = dW;
-	x = dX;
+	for(int i = 0; i < 9; ++i, p += 8){
+		for(int j = 0; j < 8; ++j){
+			fr[p[j]] = 1 & (d[i] >> j);
+		}
+	}
+}
+
+void MBEDecoder::unpack_dmr(const unsigned char *d, char ambe_fr[4][24])
+{
+	char *fr = &ambe_fr[0][0];
+	const unsigned char *p = rI;
 
-	for(int i = 0; i < 9; ++i){
+	for(int i = 0; i < 9; ++i, p += 8){
 		for(int j = 0; j < 8; ++j){
-			ambe_fr[*w][*x] = (1 & (d[i] >> j));
-			w++;
-			x++;
+			fr[p[j]] = 1 & (d[i] >> (7 - j));
 		}
 	}
+}
 
-	mbe_processAmbe3600x2400Framef(m_audio_out_temp_buf, &m_errs, &m_errs2, m_err_str, ambe_fr, ambe_d,m_mbelibParms-> m_cur_mp, m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced, 3);
-	processAudio();
+void MBEDecoder::pack_dstar(const char ambe_fr[4][24], unsigned char *d)
+{
+	const char *fr = &ambe_fr[0][0];
+	const unsigned char *p = dI;
+
+	for(int i = 0; i < 9; ++i, p += 8){
+		d[i] = 0;
+		for(int j = 0; j < 8; ++j){
+			d[i] |= fr[p[j]] << j;
+		}
+	}
+}
+
+void MBEDecoder::pack_dmr(const char ambe_fr[4][24], unsigned char *d)
+{
+	const char *fr = &ambe_fr[0][0];
+	const unsigned char *p = rI;
+
+	for(int i = 0; i < 9; ++i, p += 8){
+		d[i] = 0;
+		for(int j = 0; j < 8; ++j){
+			d[i] |= fr[p[j]] << (7 - j);
+		}
+	}
 }
 
-void MBEDecoder::process_dmr(unsigned char *d)
+/*
+ * Inverse of mbe_eccAmbe3600x24x0C0(), mbe_demodulateAmbe3600x24x0Data() and
+ * mbe_eccAmbe3600x24x0Data(): bits 0-11 and 12-23 are the data bits of the
+ * Golay (23,12) words C0 and C1, MSB first, and C1 is whitened with a PN
+ * sequence seeded by the data of C0. Bits 24-34 and 35-48 go to C2 and C3
+ * as they are.
+ */
+void MBEDecoder::encodeAmbe(const char ambe_d[49], char ambe_fr[4][24])
 {
-	char ambe_fr[4][24];
-
-	memset(ambe_fr, 0, 96);
-	w = rW;
-	x = rX;
-	y = rY;
-	z = rZ;
-
-	for(int i = 0; i < 9; ++i){
-		for(int j = 0; j < 8; j+=2){
-			ambe_fr[*y][*z] = (1 & (d[i] >> (7 - (j+1))));
-			ambe_fr[*w][*x] = (1 & (d[i] >> (7 - j)));
-			w++;
-			x++;
-			y++;
-			z++;
+	unsigned int c0 = 0;
+	unsigned int c1 = 0;
+	char parity = 0;
+
+	memset(ambe_fr, 0, 4 * 24);
+	for(int i = 0; i < 12; ++i){
+		c0 = (c0 << 1) | (ambe_d[i] & 1);
+		c1 = (c1 << 1) | (ambe_d[12 + i] & 1);
+	}
+
+	const unsigned int g0 = GolayMBE::encode2312(c0);
+	const unsigned int g1 = GolayMBE::encode2312(c1);
+	unsigned int pr = 16 * c0;
+
+	for(int k = 0; k < 23; ++k){
+		ambe_fr[0][k + 1] = (g0 >> k) & 1;
+		ambe_fr[1][k] = (g1 >> k) & 1;
+		parity ^= ambe_fr[0][k + 1];
+	}
+	ambe_fr[0][0] = parity; // extended Golay (24,12) parity, mbelib does not check it
+
+	for(int j = 22; j >= 0; --j){
+		pr = (173 * pr + 13849) & 0xffff;
+		ambe_fr[1][j] ^= pr >> 15;
+	}
+	for(int i = 0; i < 11; ++i){
+		ambe_fr[2][10 - i] = ambe_d[24 + i] & 1;
+	}
+	for(int i = 0; i < 14; ++i){
+		ambe_fr[3][13 - i] = ambe_d[35 + i] & 1;
+	}
+}
+
+bool MBEDecoder::skipSynthesis(const unsigned char *d, const unsigned char *silence)
+{
+	if(!memcmp(d, silence, 9)){
+		if(!m_silent){
+			// speech after the pause starts from fresh parameters, as after a lost stream
+			mbe_initMbeParms(m_mbelibParms->m_cur_mp, m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced);
+			m_silent = true;
+			m_last_valid = false;
 		}
+		memset(m_audio_out_temp_buf, 0, sizeof(m_audio_out_temp_buf));
+	}
+	else if(m_skip_repeats && m_last_valid && !memcmp(d, m_last_frame, 9)){
+		memcpy(m_audio_out_temp_buf, m_last_audio, sizeof(m_audio_out_temp_buf));
+	}
+	else{
+		m_silent = false;
+		return false;
 	}
 
-	mbe_processAmbe3600x2450Framef(m_audio_out_temp_buf, &m_errs, &m_errs2, m_err_str, ambe_fr, ambe_d,m_mbelibParms-> m_cur_mp, m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced, 3);
+	++m_skipped;
+	Metrics::inc(Metrics::VocoderFramesSkipped);
+	return true;
+}
+
+void MBEDecoder::keepFrame(const unsigned char *d)
+{
+	if(m_skip_repeats){
+		memcpy(m_last_frame, d, 9);
+		memcpy(m_last_audio, m_audio_out_temp_buf, sizeof(m_last_audio));
+		m_last_valid = true;
+	}
+}
+
+void MBEDecoder::process_dstar(const unsigned char *d)
+{
+	if(!skipSynthesis(d, dstar_silence)){
+		unpack_dstar(d, m_ambe_fr);
+		processAmbe2400(m_ambe_fr);
+		Metrics::add(Metrics::FECCorrectedAMBE, m_errs2);
+		keepFrame(d);
+	}
+	processAudio();
+}
+
+void MBEDecoder::process_dmr(const unsigned char *d)
+{
+	if(!skipSynthesis(d, dmr_silence)){
+		unpack_dmr(d, m_ambe_fr);
+		processAmbe2450(m_ambe_fr);
+		Metrics::add(Metrics::FECCorrectedAMBE, m_errs2);
+		keepFrame(d);
+	}
 	processAudio();
 }
 
 void MBEDecoder::process_frame(char ambe_fr[4][24])
 {
-	mbe_processAmbe3600x2450Framef(m_audio_out_temp_buf, &m_errs, &m_errs2, m_err_str, ambe_fr, ambe_d,m_mbelibParms-> m_cur_mp, m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced, 3);
+	processAmbe2450(ambe_fr);
+	Metrics::add(Metrics::FECCorrectedAMBE, m_errs2);
 	processAudio();
 }
 
 void MBEDecoder::processData(char ambe_data[49])
 {
-	mbe_processAmbe2450Dataf(m_audio_out_temp_buf, &m_errs,&m_errs2, m_err_str, ambe_data, m_mbelibParms->m_cur_mp,m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced, 3);
+	const int bad = decodeData(ambe_data);
+	if(bad != Synthesized){
+		synthesize(bad);
+	}
 	processAudio();
 }
 
 void MBEDecoder::processData4400(char imbe_data[88])
 {
-	mbe_processImbe4400Dataf(m_audio_out_temp_buf, &m_errs,&m_errs2, m_err_str, imbe_data, m_mbelibParms->m_cur_mp,m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced, 3);
+	const int bad = decodeData4400(imbe_data);
+	if(bad != Synthesized){
+		synthesize(bad);
+	}
 	processAudio();
 }
 
-void MBEDecoder::processAudio()
+void MBEDecoder::processBatch(const Job *jobs, int n)
 {
-	int i, n;
-	float aout_abs, max, gainfactor, gaindelta, maxbuf;
+	bool decoded[MaxBatch];  // not a silence or repeat played without synthesis
+	int bad[MaxBatch];       // parameters decoded and speech not synthesized yet unless Synthesized
+
+	for(; n > 0; jobs += MaxBatch, n -= MaxBatch){
+		const int nb = (n < MaxBatch) ? n : MaxBatch;
+
+		for(int i = 0; i < nb; ++i){
+			MBEDecoder *d = jobs[i].decoder;
+			const unsigned char *frame = jobs[i].frame;
+
+			d->resetAudio();
+			if(jobs[i].format == DStar){
+				decoded[i] = !d->skipSynthesis(frame, dstar_silence);
+				if(decoded[i]){
+					unpack_dstar(frame, d->m_ambe_fr);
+				}
+			}
+			else if(jobs[i].format == DMR){
+				decoded[i] = !d->skipSynthesis(frame, dmr_silence);
+				if(decoded[i]){
+					unpack_dmr(frame, d->m_ambe_fr);
+				}
+			}
+			else{
+				decoded[i] = true;
+			}
+		}
 
-	if (m_auto_gain){
-		// detect max level
-		max = 0;
-		m_audio_out_temp_buf_p = m_audio_out_temp_buf;
+		for(int i = 0; i < nb; ++i){
+			MBEDecoder *d = jobs[i].decoder;
 
-		for (n = 0; n < 160; n++){
-			aout_abs = fabsf(*m_audio_out_temp_buf_p);
+			bad[i] = Synthesized;
+			if(!decoded[i]){
+				continue;
+			}
+			switch(jobs[i].format){
+			case DStar:
+				bad[i] = d->decodeAmbe2400(d->m_ambe_fr);
+				break;
+			case DMR:
+				bad[i] = d->decodeAmbe2450(d->m_ambe_fr);
+				break;
+			case Ambe2450:
+				bad[i] = d->decodeData((char *)jobs[i].frame); // mbelib only reads the bits
+				break;
+			case Imbe4400:
+				bad[i] = d->decodeData4400((char *)jobs[i].frame);
+				break;
+			}
+		}
 
-			if (aout_abs > max){
-				max = aout_abs;
-            }
+		for(int i = 0; i < nb; ++i){
+			if(bad[i] != Synthesized){
+				jobs[i].decoder->synthesize(bad[i]);
+			}
+		}
 
-			m_audio_out_temp_buf_p++;
+		for(int i = 0; i < nb; ++i){
+			MBEDecoder *d = jobs[i].decoder;
+
+			if(decoded[i] && ((jobs[i].format == DStar) || (jobs[i].format == DMR))){
+				Metrics::add(Metrics::FECCorrectedAMBE, d->m_errs2);
+				d->keepFrame(jobs[i].frame);
+			}
+			d->processAudio();
 		}
+	}
+}
+
+/*
+ * With MBESynth the steps of mbe_process*Framef() are taken one by one, so
+ * that mbelib corrects and dequantizes the frame and only the synthesis of
+ * the speech is replaced.
+ */
+void MBEDecoder::processAmbe2400(char ambe_fr[4][24])
+{
+	const int bad = decodeAmbe2400(ambe_fr);
+	if(bad != Synthesized){
+		synthesize(bad);
+	}
+}
+
+void MBEDecoder::processAmbe2450(char ambe_fr[4][24])
+{
+	const int bad = decodeAmbe2450(ambe_fr);
+	if(bad != Synthesized){
+		synthesize(bad);
+	}
+}
+
+int MBEDecoder::decodeAmbe2400(char ambe_fr[4][24])
+{
+	if(!m_synth){
+		mbe_processAmbe3600x2400Framef(m_audio_out_temp_buf, &m_errs, &m_errs2, m_err_str, ambe_fr, ambe_d,m_mbelibParms-> m_cur_mp, m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced, 3);
+		return Synthesized;
+	}
+	m_errs = mbe_eccAmbe3600x2400C0(ambe_fr);
+	mbe_demodulateAmbe3600x2400Data(ambe_fr);
+	m_errs2 = m_errs + mbe_eccAmbe3600x2400Data(ambe_fr, ambe_d);
+
+	const int bad = mbe_decodeAmbe2400Parms(ambe_d, m_mbelibParms->m_cur_mp, m_mbelibParms->m_prev_mp);
+	m_repeat = (bad < 2) && (m_errs2 > 3); // erasure (2) and tone (3) frames are muted, not repeated
+	m_reference = mbe_processAmbe2400Dataf;
+	m_reference_data = ambe_d;
+	return bad;
+}
+
+int MBEDecoder::decodeAmbe2450(char ambe_fr[4][24])
+{
+	if(!m_synth){
+		mbe_processAmbe3600x2450Framef(m_audio_out_temp_buf, &m_errs, &m_errs2, m_err_str, ambe_fr, ambe_d,m_mbelibParms-> m_cur_mp, m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced, 3);
+		return Synthesized;
+	}
+	m_errs = mbe_eccAmbe3600x2450C0(ambe_fr);
+	mbe_demodulateAmbe3600x2450Data(ambe_fr);
+	m_errs2 = m_errs + mbe_eccAmbe3600x2450Data(ambe_fr, ambe_d);
+
+	const int bad = mbe_decodeAmbe2450Parms(ambe_d, m_mbelibParms->m_cur_mp, m_mbelibParms->m_prev_mp);
+	m_repeat = (bad < 2) && (m_errs2 > 3);
+	m_reference = mbe_processAmbe2450Dataf;
+	m_reference_data = ambe_d;
+	return bad;
+}
+
+int MBEDecoder::decodeData(char ambe_data[49])
+{
+	if(!m_synth){
+		mbe_processAmbe2450Dataf(m_audio_out_temp_buf, &m_errs,&m_errs2, m_err_str, ambe_data, m_mbelibParms->m_cur_mp,m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced, 3);
+		return Synthesized;
+	}
+	const int bad = mbe_decodeAmbe2450Parms(ambe_data, m_mbelibParms->m_cur_mp, m_mbelibParms->m_prev_mp);
+	m_repeat = (bad < 2) && (m_errs2 > 3);
+	m_reference = mbe_processAmbe2450Dataf;
+	m_reference_data = ambe_data;
+	return bad;
+}
+
+int MBEDecoder::decodeData4400(char imbe_data[88])
+{
+	if(!m_synth){
+		mbe_processImbe4400Dataf(m_audio_out_temp_buf, &m_errs,&m_errs2, m_err_str, imbe_data, m_mbelibParms->m_cur_mp,m_mbelibParms->m_prev_mp, m_mbelibParms->m_prev_mp_enhanced, 3);
+		return Synthesized;
+	}
+	const int bad = mbe_decodeImbe4400Parms(imbe_data, m_mbelibParms->m_cur_mp, m_mbelibParms->m_prev_mp);
+	m_repeat = bad || (m_errs2 > 5);
+	m_reference = mbe_processImbe4400Dataf;
+	m_reference_data = imbe_data;
+	return 0; // mbelib repeats an IMBE frame with a bad pitch instead of muting it
+}
+
+/**
+ * Repeat the last parameters of a damaged frame, enhance and synthesize as
+ * mbelib does, or mute and start over on an erasure or tone frame and after
+ * 3 repeats in a row.
+ */
+void MBEDecoder::synthesize(int bad)
+{
+	mbe_parms *cur = m_mbelibParms->m_cur_mp;
+	mbe_parms *prev = m_mbelibParms->m_prev_mp;
+	mbe_parms *enhanced = m_mbelibParms->m_prev_mp_enhanced;
+	mbe_parms c, p, e;
+	unsigned int seed = 0;
+
+	if(m_check){
+		// mbelib takes the whole frame again from copies, drawing the same random phases and noise from rand()
+		c = *cur;
+		p = *prev;
+		e = *enhanced;
+		seed = m_check->nextSeed();
+		srand(seed);
+	}
+
+	if(m_repeat){
+		mbe_useLastMbeParms(cur, prev);
+		cur->repeat++;
+	}
+	else{
+		cur->repeat = 0;
+	}
+
+	if(bad || (cur->repeat > 3)){
+		mbe_synthesizeSilencef(m_audio_out_temp_buf);
+		mbe_initMbeParms(cur, prev, enhanced);
+	}
+	else{
+		mbe_moveMbeParms(cur, prev);
+		mbe_spectralAmpEnhance(cur);
+		m_synth->synthesize(m_audio_out_temp_buf, cur, enhanced, 3);
+		mbe_moveMbeParms(cur, enhanced);
+	}
+
+	if(m_check){
+		float ref[160];
+		int errs = m_errs;
+		int errs2 = m_errs2;
+
+		srand(seed);
+		m_reference(ref, &errs, &errs2, m_err_str, m_reference_data, &c, &p, &e, 3);
+		m_check->add(ref, m_audio_out_temp_buf, 160);
+	}
+}
+
+float MBEDecoder::absMax(const float *in)
+{
+#if defined(__SSE2__)
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	__m128 vmax = _mm_setzero_ps();
+
+	for (int n = 0; n < 160; n += 8){
+		vmax = _mm_max_ps(vmax, _mm_andnot_ps(sign, _mm_loadu_ps(in + n)));
+		vmax = _mm_max_ps(vmax, _mm_andnot_ps(sign, _mm_loadu_ps(in + n + 4)));
+	}
+
+	vmax = _mm_max_ps(vmax, _mm_movehl_ps(vmax, vmax));
+	vmax = _mm_max_ss(vmax, _mm_shuffle_ps(vmax, vmax, 1));
+	return _mm_cvtss_f32(vmax);
+#else
+	float max = 0;
+
+	for (int n = 0; n < 160; n++){
+		float aout_abs = fabsf(in[n]);
+
+		if (aout_abs > max){
+			max = aout_abs;
+		}
+	}
+
+	return max;
+#endif
+}
+
+/*
+ * Fused gain ramp, saturation to +/-32760 and truncating conversion to S16,
+ * vectorized by 8 with a scalar tail for resampled frame lengths.
+ * Sample n is scaled by (gain + n * gaindelta) exactly as the former separate
+ * passes did, so both paths give bit-identical output to them as long as the
+ * compiler does not contract the scalar multiply-add into an FMA (x86 builds
+ * without -mfma); with contraction the result may differ by 1 LSB.
+ */
+void MBEDecoder::gainToS16(const float *in, short *out, int nbSamples, float gain, float gaindelta, bool stereo)
+{
+	int n = 0;
+
+#if defined(__SSE2__)
+	const __m128 vgain = _mm_set1_ps(gain);
+	const __m128 vdelta = _mm_set1_ps(gaindelta);
+	const __m128 vfour = _mm_set1_ps(4.0f);
+	const __m128 vhi = _mm_set1_ps(32760.0f);
+	const __m128 vlo = _mm_set1_ps(-32760.0f);
+	__m128 vn = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+	for (; n + 8 <= nbSamples; n += 8){
+		__m128 a = _mm_mul_ps(_mm_add_ps(vgain, _mm_mul_ps(vn, vdelta)), _mm_loadu_ps(in + n));
+		vn = _mm_add_ps(vn, vfour);
+		__m128 b = _mm_mul_ps(_mm_add_ps(vgain, _mm_mul_ps(vn, vdelta)), _mm_loadu_ps(in + n + 4));
+		vn = _mm_add_ps(vn, vfour);
+		a = _mm_min_ps(_mm_max_ps(a, vlo), vhi);
+		b = _mm_min_ps(_mm_max_ps(b, vlo), vhi);
+		__m128i s = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+
+		if (stereo){
+			_mm_storeu_si128((__m128i *) out, _mm_unpacklo_epi16(s, s));
+			_mm_storeu_si128((__m128i *) (out + 8), _mm_unpackhi_epi16(s, s));
+			out += 16;
+		}
+		else{
+			_mm_storeu_si128((__m128i *) out, s);
+			out += 8;
+		}
+	}
+#endif
+
+	for (; n < nbSamples; n++){
+		float v = (gain + (static_cast<float>(n) * gaindelta)) * in[n];
+
+		if (v > static_cast<float>(32760)){
+			v = static_cast<float>(32760);
+		}
+		else if (v < static_cast<float>(-32760)){
+			v = static_cast<float>(-32760);
+		}
+
+		*out++ = static_cast<short>(v);
+
+		if (stereo){
+			*out++ = static_cast<short>(v);
+		}
+	}
+}
+
+void MBEDecoder::processAudio()
+{
+	int i;
+	float max, gain, gainfactor, gaindelta, maxbuf;
+
+	if (m_auto_gain){
+		// detect max level
+		max = absMax(m_audio_out_temp_buf);
 
 		*m_aout_max_buf_p = max;
 		m_aout_max_buf_p++;
@@ -240,49 +688,39 @@ void MBEDecoder::processAudio()
 		}
 
 		gaindelta /= static_cast<float>(160);
-
-		// adjust output gain
-		m_audio_out_temp_buf_p = m_audio_out_temp_buf;
-
-		for (n = 0; n < 160; n++){
-			*m_audio_out_temp_buf_p = (m_aout_gain + (static_cast<float>(n) * gaindelta)) * (*m_audio_out_temp_buf_p);
-			m_audio_out_temp_buf_p++;
-		}
-
+		gain = m_aout_gain;
 		m_aout_gain += (static_cast<float>(160) * gaindelta);
 	}
 	else{
+		// unity gain leaves the samples untouched: (1 + n*0) * x == x
+		gain = static_cast<float>(1);
 		gaindelta = static_cast<float>(0);
 	}
 
-	// copy audio data to output buffer and upsample if necessary
-	m_audio_out_temp_buf_p = m_audio_out_temp_buf;
-
-	if (m_audio_out_nb_samples + 160 >= m_audio_out_buf_size){
-		resetAudio();
+	if (!m_audio_out_buf){
+		return;
 	}
 
-	m_audio_out_float_buf_p = m_audio_out_float_buf;
-
-	for (n = 0; n < 160; n++){
-		if (*m_audio_out_temp_buf_p > static_cast<float>(32760)){
-			*m_audio_out_temp_buf_p = static_cast<float>(32760);
-		}
-		else if (*m_audio_out_temp_buf_p < static_cast<float>(-32760)){
-			*m_audio_out_temp_buf_p = static_cast<float>(-32760);
-		}
+	int nbSamples = m_resampler ? m_resampler->maxOutput(160) : 160;
 
-		*m_audio_out_buf_p = static_cast<short>(*m_audio_out_temp_buf_p);
-		m_audio_out_buf_p++;
+	if (m_audio_out_nb_samples + nbSamples > m_audio_out_buf_size){
+		resetAudio();
+	}
 
-		if (m_stereo){
-			*m_audio_out_buf_p = static_cast<short>(*m_audio_out_temp_buf_p);
-			m_audio_out_buf_p++;
+	if (m_resampler){
+		// gain is ramped at the vocoder rate, then the frame is resampled and clipped
+		for (int n = 0; n < 160; n++){
+			m_audio_out_temp_buf[n] *= gain + (static_cast<float>(n) * gaindelta);
 		}
 
-		m_audio_out_nb_samples++;
-		m_audio_out_temp_buf_p++;
-		m_audio_out_idx++;
-		m_audio_out_idx2++;
+		nbSamples = m_resampler->process(m_audio_out_temp_buf, 160, m_audio_out_float_buf);
+		gainToS16(m_audio_out_float_buf, m_audio_out_buf_p, nbSamples, static_cast<float>(1), static_cast<float>(0), m_stereo);
 	}
+	else{
+		// adjust output gain, clip and convert to the S16 output buffer in one pass
+		gainToS16(m_audio_out_temp_buf, m_audio_out_buf_p, 160, gain, gaindelta, m_stereo);
+	}
+
+	m_audio_out_buf_p += m_stereo ? 2 * nbSamples : nbSamples;
+	m_audio_out_nb_samples += nbSamples;
 }
@@ -18,21 +18,69 @@
 #ifndef MBE_H_
 #define MBE_H_
 
+#include "synth.h"
+
 struct mbelibParms;
+class Resampler;
 
 class MBEDecoder
 {
 public:
+	enum Format { DStar, DMR, Ambe2450, Imbe4400 };
+
+	/** One frame of one decoder in a processBatch() call */
+	struct Job
+	{
+		MBEDecoder *decoder;
+		Format format;
+		const unsigned char *frame;    //!< 9 bytes for DStar and DMR, 49 or 88 bits one per byte for Ambe2450 and Imbe4400
+	};
+
+	static const int MaxBatch = 64;    //!< frames taken through each step together, longer batches go in parts
+
 	explicit MBEDecoder();
 	~MBEDecoder();
 
 	void initMbeParms();
-	void process_dstar(unsigned char *d);
-	void process_dmr(unsigned char *d);
+	void process_dstar(const unsigned char *d);
+	void process_dmr(const unsigned char *d);
 	//void process_ysf(char *d);
 	void process_frame(char ambe_fr[4][24]);
 	void processData(char ambe_data[49]);
 	void processData4400(char imbe_data[88]);
+	/**
+	 * One frame for each of n different decoders, as process_dstar(),
+	 * process_dmr(), processData() or processData4400() would decode them
+	 * one at a time, into the audio buffer of each decoder after resetAudio().
+	 * Every frame goes through one step before any goes through the next
+	 * (silence and repeats, FEC and dequantization, synthesis, then gain and
+	 * resampling), so the code and tables of each step stay in cache.
+	 */
+	static void processBatch(const Job *jobs, int n);
+
+	/** Scatter the 72 bits of a 9 byte AMBE frame into the 4x24 layout mbelib decodes */
+	static void unpack_dstar(const unsigned char *d, char ambe_fr[4][24]);
+	static void unpack_dmr(const unsigned char *d, char ambe_fr[4][24]);
+	/** Peak of a 160 sample frame, for the auto gain */
+	static float absMax(const float *in);
+	/** Gain ramp from gain by gaindelta per sample, clipping and conversion of nbSamples to S16, doubled in stereo */
+	static void gainToS16(const float *in, short *out, int nbSamples, float gain, float gaindelta, bool stereo);
+
+	/** Gather the 72 bits of ambe_fr into a 9 byte AMBE frame, the inverse of unpack_dstar() and unpack_dmr() */
+	static void pack_dstar(const char ambe_fr[4][24], unsigned char *d);
+	static void pack_dmr(const char ambe_fr[4][24], unsigned char *d);
+	/** AMBE 3600x2400 or 3600x2450 FEC of 49 parameter bits, so mbelib takes them back out without errors */
+	static void encodeAmbe(const char ambe_d[49], char ambe_fr[4][24]);
+
+	static const int MaxFrameSamples = 7 * 160; //!< one 20 ms frame at the highest supported output rate
+
+	/** Decoded S16 samples are written here, buffer holds nbSamples (twice that in stereo) */
+	void setAudioBuffer(short *buf, int nbSamples)
+	{
+		m_audio_out_buf = buf;
+		m_audio_out_buf_size = nbSamples;
+		resetAudio();
+	}
 
 	short *getAudio(int& nbSamples)
     {
@@ -51,14 +99,31 @@ public:
 	void setVolume(float volume) { m_volume = volume; }
 	void setStereo(bool stereo) { m_stereo = stereo; }
 	void setChannels(unsigned char channels) { m_channels = channels % 4; }
-	void setUpsamplingFactor(int upsample) { m_upsample = upsample; }
-	int getUpsamplingFactor() const { return m_upsample; }
+	/** Adaptive keeps a resampler even at 8 kHz, so setTrim() can follow the sound card clock */
+	bool setOutputRate(int rate, bool adaptive = false);
+	int getOutputRate() const;
+	/** Play ppm faster than the nominal rate, slower if negative, after setOutputRate(rate, true) */
+	void setTrim(double ppm);
+	/** Replay the last synthesized audio for a frame identical to the one before it */
+	void setSkipRepeats(bool skip) { m_skip_repeats = skip; }
+	/** Frames played without running mbelib: silence patterns, and repeats with setSkipRepeats() */
+	unsigned int getSkipped() const { return m_skipped; }
+	/** Synthesize speech with MBESynth instead of mbelib, and compare every frame with mbelib when check is given */
+	void setSynthesis(MBESynth::Mode mode, SynthCheck *check = nullptr);
 
 private:
+	bool skipSynthesis(const unsigned char *d, const unsigned char *silence);
+	void keepFrame(const unsigned char *d);
+	void processAmbe2400(char ambe_fr[4][24]);
+	void processAmbe2450(char ambe_fr[4][24]);
+	static const int Synthesized = -1;
+	/** FEC and dequantization into m_cur_mp and the bad code for synthesize(), or Synthesized when mbelib did all of the decoding */
+	int decodeAmbe2400(char ambe_fr[4][24]);
+	int decodeAmbe2450(char ambe_fr[4][24]);
+	int decodeData(char ambe_data[49]);
+	int decodeData4400(char imbe_data[88]);
+	void synthesize(int bad);
 	void processAudio();
-	void upsample(int upsampling, float invalue);
-
-	float m_upsamplerLastValue;
 
 	mbelibParms *m_mbelibParms;
 	int m_errs;
@@ -66,36 +131,43 @@ private:
 	char m_err_str[64];
 
 	float m_audio_out_temp_buf[160];   //!< output of decoder
-	float *m_audio_out_temp_buf_p;
 
-	float m_audio_out_float_buf[1120]; //!< output of upsampler - 1 frame of 160 samples upampled up to 7 times
-	float *m_audio_out_float_buf_p;
+	float *m_audio_out_float_buf;      //!< output of resampler - 1 frame, allocated with the resampler
+	Resampler *m_resampler;            //!< nullptr when the sink takes 8 kHz directly
+	MBESynth *m_synth;                 //!< nullptr when mbelib synthesizes
+	SynthCheck *m_check;
+	bool m_repeat;                     //!< the decoded frame was damaged, synthesize() plays the last parameters again
+	/** mbe_process*Dataf() that SynthCheck compares the whole frame with, from the bits decoded last */
+	void (*m_reference)(float *, int *, int *, char *, char *, mbe_parameters *, mbe_parameters *, mbe_parameters *, int);
+	char *m_reference_data;
 
-	float m_aout_max_buf[200];
+	float m_aout_max_buf[25];          //!< frame peaks over the last 500 ms for auto gain
 	float *m_aout_max_buf_p;
 	int m_aout_max_buf_idx;
 
-	short m_audio_out_buf[2*48000];    //!< final result - 1s of L+R S16LE samples
+	short *m_audio_out_buf;            //!< final result, caller provided L+R or mono S16LE samples
 	short *m_audio_out_buf_p;
 	int   m_audio_out_nb_samples;
-	int   m_audio_out_buf_size;
-	int   m_audio_out_idx;
-	int   m_audio_out_idx2;
+	int   m_audio_out_buf_size;        //!< given in number of unique samples
 
 	float m_aout_gain;
 	float m_volume;
 	bool m_auto_gain;
-	int m_upsample;            //!< upsampling factor
 	bool m_stereo;             //!< double each audio sample to produce L+R channels
 	unsigned char m_channels;  //!< when in stereo output to none (0) or only left (1), right (2) or both (3) channels
-	const int *w, *x, *y, *z;
-	static const int dW[72];
-	static const int dX[72];
-	static const int rW[36];
-	static const int rX[36];
-	static const int rY[36];
-	static const int rZ[36];
+	static const unsigned char dI[72]; //!< D-Star bit unpack offsets into m_ambe_fr
+	static const unsigned char rI[72]; //!< DMR bit unpack offsets into m_ambe_fr
+	char m_ambe_fr[4][24];             //!< only the 72 unpacked positions are ever written, the rest stay zero
 	char ambe_d[49];
+
+	static const unsigned char dstar_silence[9]; //!< AMBE silence sent by D-STAR gateways and radios
+	static const unsigned char dmr_silence[9];   //!< AMBE+2 silence sent by DMR networks, after FEC
+	bool m_silent;                     //!< mbelib parameters were reset by the current run of silence
+	bool m_skip_repeats;
+	bool m_last_valid;
+	unsigned char m_last_frame[9];     //!< last synthesized frame and its audio before gain
+	float m_last_audio[160];
+	unsigned int m_skipped;
 };
 
 #endif /* MBE_H_ */
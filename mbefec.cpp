@@ -18,8 +18,16 @@
 
 #include "mbefec.h"
 
-const int GolayMBE::golayGenerator[12] = {
-  0x63a, 0x31d, 0x7b4, 0x3da, 0x1ed, 0x6cc, 0x366, 0x1b3, 0x6e3, 0x54b, 0x49f, 0x475
+/*
+ * golayParity[k][n] is the XOR of the rows of mbelib's golayGenerator
+ *   0x63a, 0x31d, 0x7b4, 0x3da, 0x1ed, 0x6cc, 0x366, 0x1b3, 0x6e3, 0x54b, 0x49f, 0x475
+ * (data bit 11 first) selected by nibble n in position k (0 for data bits
+ * 11..8) of the 12 data bits.
+ */
+const unsigned short GolayMBE::golayParity[3][16] = {
+  {0x000, 0x3da, 0x7b4, 0x46e, 0x31d, 0x0c7, 0x4a9, 0x773, 0x63a, 0x5e0, 0x18e, 0x254, 0x527, 0x6fd, 0x293, 0x149},
+  {0x000, 0x1b3, 0x366, 0x2d5, 0x6cc, 0x77f, 0x5aa, 0x419, 0x1ed, 0x05e, 0x28b, 0x338, 0x721, 0x692, 0x447, 0x5f4},
+  {0x000, 0x475, 0x49f, 0x0ea, 0x54b, 0x13e, 0x1d4, 0x5a1, 0x6e3, 0x296, 0x27c, 0x609, 0x3a8, 0x7dd, 0x737, 0x342}
 };
 
 const int GolayMBE::golayMatrix[2048] = {
@@ -94,174 +102,129 @@ const int GolayMBE::golayMatrix[2048] = {
   34, 256, 34, 512, 34, 1032, 80
 };
 
-void GolayMBE::mbe_checkGolayBlock(long int *block)
+unsigned int GolayMBE::decode2312(unsigned int block)
 {
-    static int i, syndrome, eccexpected, eccbits, databits;
-    long int mask, block_l;
+    unsigned int databits = block >> 11;
+    unsigned int eccexpected = golayParity[0][databits >> 8]
+            ^ golayParity[1][(databits >> 4) & 0xf]
+            ^ golayParity[2][databits & 0xf];
+    unsigned int syndrome = eccexpected ^ (block & 0x7ff);
 
-    block_l = *block;
-
-    mask = 0x400000l;
-    eccexpected = 0;
-
-    for (i = 0; i < 12; i++)
-    {
-        if ((block_l & mask) != 0l)
-        {
-            eccexpected ^= golayGenerator[i];
-        }
-        mask = mask >> 1;
-    }
-
-    eccbits = (int) (block_l & 0x7ffl);
-    syndrome = eccexpected ^ eccbits;
+    return databits ^ golayMatrix[syndrome];
+}
 
-    databits = (int) (block_l >> 11);
-    databits = databits ^ golayMatrix[syndrome];
+unsigned int GolayMBE::encode2312(unsigned int databits)
+{
+    databits &= 0xfff;
 
-    *block = (long) databits;
+    return (databits << 11) | (golayParity[0][databits >> 8]
+            ^ golayParity[1][(databits >> 4) & 0xf]
+            ^ golayParity[2][databits & 0xf]);
 }
 
 int GolayMBE::mbe_golay2312(unsigned char *in, unsigned char *out)
 {
+    unsigned int block = 0;
 
-    int i, errs;
-    long block;
-
-    block = 0;
-
-    for (i = 22; i >= 0; i--)
+    for (int i = 22; i >= 0; i--)
     {
-        block = block << 1;
-        block = block + in[i];
+        block = (block << 1) | in[i];
     }
 
-    mbe_checkGolayBlock(&block);
-
-    for (i = 22; i >= 11; i--)
-    {
-        out[i] = (block & 2048) >> 11;
-        block = block << 1;
-    }
+    unsigned int databits = decode2312(block);
+    unsigned int flipped = databits ^ (block >> 11);
+    int errs = 0;
 
-    for (i = 10; i >= 0; i--)
+    for (int i = 0; i < 11; i++)
     {
         out[i] = in[i];
     }
 
-    errs = 0;
-
-    for (i = 22; i >= 11; i--)
+    for (int i = 0; i < 12; i++)
     {
-        if (out[i] != in[i])
-        {
-            errs++;
-        }
+        out[11 + i] = (databits >> i) & 1;
+        errs += (flipped >> i) & 1;
     }
 
     return errs;
 }
 
-const int HammingMBE::hammingGenerator[4] = {
-  0x7f08, 0x78e4, 0x66d2, 0x55b1
+/*
+ * Syndrome lookups: entry [k][n] is the syndrome of nibble n in position k
+ * (0 for block bits 3..0) so a syndrome is the XOR of four lookups. They
+ * are derived from mbelib's parity check rows, syndrome bit 3 first:
+ *   hammingGenerator               0x7f08, 0x78e4, 0x66d2, 0x55b1
+ *   imbe7100x4400hammingGenerator  0x7ac8, 0x3d64, 0x1eb2, 0x7591
+ */
+const unsigned char HammingMBE::hammingSyndrome[4][16] = {
+  { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+  { 0,  3,  5,  6,  6,  5,  3,  0,  7,  4,  2,  1,  1,  2,  4,  7},
+  { 0,  9, 10,  3, 11,  2,  1,  8, 12,  5,  6, 15,  7, 14, 13,  4},
+  { 0, 13, 14,  3, 15,  2,  1, 12,  0, 13, 14,  3, 15,  2,  1, 12}
 };
 
-const int HammingMBE::imbe7100x4400hammingGenerator[4] = {
-  0x7ac8, 0x3d64, 0x1eb2, 0x7591
+const unsigned char HammingMBE::imbe7100x4400hammingSyndrome[4][16] = {
+  { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+  { 0,  3,  6,  5, 12, 15, 10,  9, 11,  8, 13, 14,  7,  4,  1,  2},
+  { 0,  5, 10, 15,  7,  2, 13,  8, 14, 11,  4,  1,  9, 12,  3,  6},
+  { 0, 15, 13,  2,  9,  6,  4, 11,  0, 15, 13,  2,  9,  6,  4, 11}
 };
 
 const int HammingMBE::hammingMatrix[16] = {
   0x0, 0x1, 0x2, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80, 0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000
 };
 
-int HammingMBE::mbe_hamming1511(unsigned char *in, unsigned char *out)
+int HammingMBE::decode(int block, const unsigned char syndromes[4][16], int& errs)
 {
-    int i, j, errs, block, syndrome, stmp, stmp2;
-
-    errs = 0;
-    block = 0;
-
-    for (i = 14; i >= 0; i--)
-    {
-        block <<= 1;
-        block |= in[i];
-    }
+    int syndrome = syndromes[0][block & 0xf]
+            ^ syndromes[1][(block >> 4) & 0xf]
+            ^ syndromes[2][(block >> 8) & 0xf]
+            ^ syndromes[3][(block >> 12) & 0xf];
 
-    syndrome = 0;
+    errs = syndrome > 0 ? 1 : 0;
+    return block ^ hammingMatrix[syndrome];
+}
 
-    for (i = 0; i < 4; i++)
-    {
-        syndrome <<= 1;
-        stmp = block;
-        stmp &= hammingGenerator[i];
-        stmp2 = (stmp % 2);
+int HammingMBE::decode1511(int block, int& errs)
+{
+    return decode(block, hammingSyndrome, errs);
+}
 
-        for (j = 0; j < 14; j++)
-        {
-            stmp >>= 1;
-            stmp2 ^= (stmp % 2);
-        }
+int HammingMBE::decode7100x4400(int block, int& errs)
+{
+    return decode(block, imbe7100x4400hammingSyndrome, errs);
+}
 
-        syndrome |= stmp2;
-    }
+int HammingMBE::pack15(const unsigned char *in)
+{
+    int block = 0;
 
-    if (syndrome > 0)
+    for (int i = 14; i >= 0; i--)
     {
-        errs++;
-        block ^= hammingMatrix[syndrome];
+        block = (block << 1) | in[i];
     }
 
-    for (i = 14; i >= 0; i--)
+    return block;
+}
+
+void HammingMBE::unpack15(int block, unsigned char *out)
+{
+    for (int i = 0; i < 15; i++)
     {
-        out[i] = (block & 0x4000) >> 14;
-        block = block << 1;
+        out[i] = (block >> i) & 1;
     }
+}
 
+int HammingMBE::mbe_hamming1511(unsigned char *in, unsigned char *out)
+{
+    int errs;
+    unpack15(decode1511(pack15(in), errs), out);
     return errs;
 }
 
 int HammingMBE::mbe_7100x4400hamming1511(unsigned char *in, unsigned char *out)
 {
-    int i, j, errs, block, syndrome, stmp, stmp2;
-
-    errs = 0;
-    block = 0;
-
-    for (i = 14; i >= 0; i--)
-    {
-        block <<= 1;
-        block |= in[i];
-    }
-
-    syndrome = 0;
-
-    for (i = 0; i < 4; i++)
-    {
-        syndrome <<= 1;
-        stmp = block;
-        stmp &= imbe7100x4400hammingGenerator[i];
-        stmp2 = (stmp % 2);
-
-        for (j = 0; j < 14; j++)
-        {
-            stmp >>= 1;
-            stmp2 ^= (stmp % 2);
-        }
-
-        syndrome |= stmp2;
-    }
-
-    if (syndrome > 0)
-    {
-        errs++;
-        block ^= hammingMatrix[syndrome];
-    }
-
-    for (i = 14; i >= 0; i--)
-    {
-        out[i] = (block & 0x4000) >> 14;
-        block = block << 1;
-    }
-
+    int errs;
+    unpack15(decode7100x4400(pack15(in), errs), out);
     return errs;
 }
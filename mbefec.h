@@ -26,11 +26,13 @@ class GolayMBE
 {
 public:
     static int  mbe_golay2312(unsigned char *in, unsigned char *out);
+    /** Packed word decoder: bit k of block is in[k], returns the corrected 12 data bits (block bits 22..11) */
+    static unsigned int decode2312(unsigned int block);
+    /** Codeword of the 12 data bits in the packed layout decode2312() takes */
+    static unsigned int encode2312(unsigned int databits);
 
 private:
-    static void mbe_checkGolayBlock(long int *block);
-
-    static const int golayGenerator[12];
+    static const unsigned short golayParity[3][16]; //!< generator row XORs for each data nibble, MSB first
     static const int golayMatrix[2048];
 };
 
@@ -42,10 +44,17 @@ class HammingMBE
 public:
     static int mbe_hamming1511(unsigned char *in, unsigned char *out);
     static int mbe_7100x4400hamming1511(unsigned char *in, unsigned char *out);
+    /** Packed word decoders: bit k of block is in[k], returns the corrected 15 bits block */
+    static int decode1511(int block, int& errs);
+    static int decode7100x4400(int block, int& errs);
 
 private:
-    static const int hammingGenerator[4];
-    static const int imbe7100x4400hammingGenerator[4];
+    static int decode(int block, const unsigned char syndromes[4][16], int& errs);
+    static int pack15(const unsigned char *in);
+    static void unpack15(int block, unsigned char *out);
+
+    static const unsigned char hammingSyndrome[4][16];              //!< AMBE Hamming syndrome for each block nibble
+    static const unsigned char imbe7100x4400hammingSyndrome[4][16]; //!< IMBE 7100x4400 Hamming syndrome for each block nibble
     static const int hammingMatrix[16];
 };
 
@@ -0,0 +1,155 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "metrics.h"
+
+thread_local Metrics::Shard *Metrics::m_local = nullptr;
+std::atomic<Metrics::Shard *> Metrics::m_shards(nullptr);
+std::atomic<int64_t> Metrics::m_gauges[Metrics::NbGauges];
+
+struct MetricDesc
+{
+	const char *name;
+	const char *labels;
+	const char *help;
+};
+
+// series of one family must be adjacent, HELP and TYPE are written once per name
+static const MetricDesc counters[Metrics::NbCounters] = {
+	{"dudestar_received_bytes_total", "", "UDP payload bytes received from reflectors."},
+	{"dudestar_sent_bytes_total", "", "UDP payload bytes sent to reflectors."},
+	{"dudestar_sent_packets_total", "", "Datagrams sent to reflectors."},
+	{"dudestar_dropped_frames_total", "", "Queued vocoder frames discarded before decoding."},
+	{"dudestar_fec_corrected_bits_total", "code=\"ambe\"", "Bit errors corrected by forward error correction."},
+	{"dudestar_fec_corrected_bits_total", "code=\"golay_23_12\"", ""},
+	{"dudestar_fec_corrected_bits_total", "code=\"hamming_15_11\"", ""},
+	{"dudestar_fec_uncorrectable_total", "code=\"golay_24_12\"", "Codewords with more errors than the code corrects."},
+	{"dudestar_crc_failures_total", "check=\"dstar_header\"", "Received blocks whose CRC did not match."},
+	{"dudestar_crc_failures_total", "check=\"ysf_fich\"", ""},
+	{"dudestar_pings_sent_total", "", "Keepalives sent or answered."},
+	{"dudestar_connects_total", "", "Completed reflector logins."},
+	{"dudestar_reconnects_total", "", "Logins by a client that had been connected before."},
+	{"dudestar_audio_underruns_total", "", "Sound card reads that ran out of audio while a stream was heard."},
+	{"dudestar_audio_overruns_total", "", "Decoded audio writes that did not fit in the playout ring."},
+	{"dudestar_vocoder_skipped_frames_total", "", "Silence and repeated vocoder frames played without synthesis."},
+};
+
+static const MetricDesc gauges[Metrics::NbGauges] = {
+	{"dudestar_queued_frames", "queue=\"audio\"", "Vocoder frames waiting for the decode timer."},
+	{"dudestar_queued_frames", "queue=\"ysf\"", ""},
+	{"dudestar_audio_output_latency_microseconds", "", "Decoded audio queued ahead of the speaker, in the playout ring and the device buffer."},
+};
+
+static const char *protocol_names[Metrics::NbProtocols] = {"REF", "XRF", "DCS", "XLX", "YSF", "DMR"};
+static const char *packet_names[Metrics::NbPackets] = {"header", "voice", "end", "ping", "control"};
+
+Metrics::Shard *Metrics::attach()
+{
+	Shard *s = new Shard;
+
+	for(int i = 0; i < NbSeries; ++i){
+		s->v[i].store(0, std::memory_order_relaxed);
+	}
+
+	s->next = m_shards.load(std::memory_order_relaxed);
+	while(!m_shards.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed)){
+	}
+
+	m_local = s;
+	return s;
+}
+
+uint64_t Metrics::sum(int idx)
+{
+	uint64_t total = 0;
+
+	for(Shard *s = m_shards.load(std::memory_order_acquire); s; s = s->next){
+		total += s->v[idx].load(std::memory_order_relaxed);
+	}
+
+	return total;
+}
+
+static void family(std::string &out, const MetricDesc &d, const char *type, const char *&last)
+{
+	if(last && !strcmp(last, d.name)){
+		return;
+	}
+
+	out += "# HELP ";
+	out += d.name;
+	out += " ";
+	out += d.help;
+	out += "\n# TYPE ";
+	out += d.name;
+	out += " ";
+	out += type;
+	out += "\n";
+	last = d.name;
+}
+
+static void sample(std::string &out, const char *name, const char *labels, const char *value)
+{
+	out += name;
+	if(labels[0]){
+		out += "{";
+		out += labels;
+		out += "}";
+	}
+	out += " ";
+	out += value;
+	out += "\n";
+}
+
+std::string Metrics::render()
+{
+	std::string out;
+	const char *last = nullptr;
+	char value[32];
+	char labels[64];
+
+	out.reserve(4096);
+
+	for(int i = 0; i < NbCounters; ++i){
+		family(out, counters[i], "counter", last);
+		snprintf(value, sizeof(value), "%llu", (unsigned long long)sum(i));
+		sample(out, counters[i].name, counters[i].labels, value);
+	}
+
+	out += "# HELP dudestar_received_packets_total Datagrams received from reflectors by protocol and type.\n";
+	out += "# TYPE dudestar_received_packets_total counter\n";
+
+	for(int p = 0; p < NbProtocols; ++p){
+		for(int t = 0; t < NbPackets; ++t){
+			snprintf(labels, sizeof(labels), "protocol=\"%s\",type=\"%s\"", protocol_names[p], packet_names[t]);
+			snprintf(value, sizeof(value), "%llu", (unsigned long long)sum(NbCounters + p * NbPackets + t));
+			sample(out, "dudestar_received_packets_total", labels, value);
+		}
+	}
+
+	last = nullptr;
+
+	for(int i = 0; i < NbGauges; ++i){
+		family(out, gauges[i], "gauge", last);
+		snprintf(value, sizeof(value), "%lld", (long long)m_gauges[i].load(std::memory_order_relaxed));
+		sample(out, gauges[i].name, gauges[i].labels, value);
+	}
+
+	return out;
+}
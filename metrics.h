@@ -0,0 +1,102 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+/**
+ * Process wide counters and gauges, rendered in the Prometheus text format.
+ *
+ * Counters live in per thread shards that only their own thread writes, so
+ * an increment is a relaxed load and store with no locked instruction.  The
+ * exporter sums the shards when it is scraped.  Shards are kept when their
+ * thread exits so its counts are never lost.  Gauges are shared relaxed
+ * atomics updated by delta, so several clients in one process add up.
+ */
+class Metrics
+{
+public:
+	enum Counter {
+		BytesReceived,
+		BytesSent,
+		PacketsSent,
+		FramesDropped,              //!< queued vocoder frames discarded on disconnect or overflow
+		FECCorrectedAMBE,           //!< bits corrected by mbelib in D-STAR and DMR AMBE frames
+		FECCorrectedGolay2312,      //!< YSF VFR Golay(23,12) corrections
+		FECCorrectedHamming1511,    //!< YSF VFR Hamming(15,11) corrections
+		FECFailedGolay2412,         //!< YSF FICH Golay(24,12) codewords beyond correction
+		CRCFailedDStarHeader,
+		CRCFailedYSFFICH,
+		PingsSent,                  //!< keepalives sent or answered
+		Connects,
+		Reconnects,                 //!< connects by a client that had been connected before
+		AudioUnderruns,             //!< sound card reads that ran out of PCM during a stream
+		AudioOverruns,              //!< decoder writes that did not fit in the PCM ring
+		VocoderFramesSkipped,       //!< AMBE frames played without mbelib synthesis
+		NbCounters
+	};
+
+	enum Gauge {
+		AudioQueueFrames,           //!< AMBE frames waiting in the voice stream queues
+		YSFQueueFrames,             //!< YSF frames waiting in ysfq
+		AudioOutputLatency,         //!< microseconds of PCM queued in the ring and the device buffer
+		NbGauges
+	};
+
+	enum Protocol { REF, XRF, DCS, XLX, YSF, DMR, NbProtocols };
+	enum Packet { Header, Voice, End, Ping, Control, NbPackets };
+
+	static void inc(Counter c) { add(c, 1); }
+	static void add(Counter c, uint64_t n) { bump(c, n); }
+	static void packet(Protocol p, Packet t) { bump(NbCounters + p * NbPackets + t, 1); }
+	static void addGauge(Gauge g, int64_t delta) { m_gauges[g].fetch_add(delta, std::memory_order_relaxed); }
+
+	static uint64_t get(Counter c) { return sum(c); }
+	static uint64_t getPackets(Protocol p, Packet t) { return sum(NbCounters + p * NbPackets + t); }
+	static int64_t getGauge(Gauge g) { return m_gauges[g].load(std::memory_order_relaxed); }
+
+	/** All series in the Prometheus text exposition format, version 0.0.4 */
+	static std::string render();
+
+private:
+	static const int NbSeries = NbCounters + NbProtocols * NbPackets;
+
+	struct Shard
+	{
+		std::atomic<uint64_t> v[NbSeries];
+		Shard *next;
+	};
+
+	static void bump(int idx, uint64_t n)
+	{
+		Shard *s = m_local ? m_local : attach();
+		s->v[idx].store(s->v[idx].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	static Shard *attach();
+	static uint64_t sum(int idx);
+
+	static thread_local Shard *m_local;
+	static std::atomic<Shard *> m_shards;
+	static std::atomic<int64_t> m_gauges[NbGauges];
+};
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,78 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "metricsserver.h"
+#include "metrics.h"
+
+MetricsServer::MetricsServer(QObject *parent) :
+	QObject(parent)
+{
+	server = new QTcpServer(this);
+	connect(server, SIGNAL(newConnection()), this, SLOT(new_connection()));
+}
+
+bool MetricsServer::listen(const QHostAddress &address, quint16 port)
+{
+	return server->listen(address, port);
+}
+
+void MetricsServer::new_connection()
+{
+	while(server->hasPendingConnections()){
+		QTcpSocket *s = server->nextPendingConnection();
+		connect(s, SIGNAL(readyRead()), this, SLOT(process_request()));
+		connect(s, SIGNAL(disconnected()), s, SLOT(deleteLater()));
+	}
+}
+
+void MetricsServer::process_request()
+{
+	QTcpSocket *s = qobject_cast<QTcpSocket *>(sender());
+	QByteArray status;
+	QByteArray body;
+
+	if(!s){
+		return;
+	}
+	if(!s->peek(MaxRequest).contains("\r\n\r\n")){
+		if(s->bytesAvailable() >= MaxRequest){
+			s->abort();
+		}
+		return; // wait for the rest of the headers
+	}
+
+	QList<QByteArray> request = s->readLine(MaxRequest).simplified().split(' ');
+	s->readAll();
+	disconnect(s, SIGNAL(readyRead()), this, SLOT(process_request()));
+
+	if((request.size() >= 2) && (request[0] == "GET") && ((request[1] == "/metrics") || request[1].startsWith("/metrics?"))){
+		status = "200 OK";
+		body = QByteArray::fromStdString(Metrics::render());
+	}
+	else{
+		status = "404 Not Found";
+		body = "Only /metrics is served here\n";
+	}
+
+	QByteArray out = "HTTP/1.0 " + status + "\r\n";
+	out += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+	out += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+	out += "Connection: close\r\n\r\n";
+	out += body;
+	s->write(out);
+	s->disconnectFromHost();
+}
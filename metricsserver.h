@@ -0,0 +1,46 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QtNetwork>
+
+/**
+ * Minimal HTTP/1.0 responder for Prometheus scrapes: GET /metrics returns
+ * Metrics::render(), anything else a 404.  It runs on the event loop of the
+ * thread that created it and closes every connection after one response.
+ */
+class MetricsServer : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit MetricsServer(QObject *parent = nullptr);
+	bool listen(const QHostAddress &address, quint16 port);
+
+private slots:
+	void new_connection();
+	void process_request();
+
+private:
+	static const int MaxRequest = 8192;
+	QTcpServer *server;
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,117 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <math.h>
+#include "mixer.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+Mixer::Mixer() :
+	m_stereo(false)
+{
+	clear();
+}
+
+void Mixer::clear()
+{
+	memset(m_acc, 0, sizeof(m_acc));
+	m_inputs = 0;
+}
+
+void Mixer::add(const short *in, int nbSamples, float gain, int route)
+{
+	if(nbSamples > FrameSamples){
+		nbSamples = FrameSamples;
+	}
+	if(!(route & Both) || !nbSamples){
+		return;
+	}
+	if(!m_stereo){
+		mac(m_acc[0], in, nbSamples, gain);
+	}
+	else{
+		if(route & Left){
+			mac(m_acc[0], in, nbSamples, gain);
+		}
+		if(route & Right){
+			mac(m_acc[1], in, nbSamples, gain);
+		}
+	}
+	++m_inputs;
+}
+
+void Mixer::mac(float *acc, const short *in, int n, float gain)
+{
+	int i = 0;
+
+#if defined(__SSE2__)
+	const __m128 vgain = _mm_set1_ps(gain);
+
+	for(; i + 8 <= n; i += 8){
+		__m128i s = _mm_loadu_si128((const __m128i *)(in + i));
+		// sign extend the 8 samples to two vectors of 32 bits
+		__m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+		__m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+		_mm_store_ps(acc + i, _mm_add_ps(_mm_load_ps(acc + i), _mm_mul_ps(lo, vgain)));
+		_mm_store_ps(acc + i + 4, _mm_add_ps(_mm_load_ps(acc + i + 4), _mm_mul_ps(hi, vgain)));
+	}
+#endif
+
+	for(; i < n; ++i){
+		acc[i] += in[i] * gain;
+	}
+}
+
+static inline short sat(float v)
+{
+	v = (v > 32767.0f) ? 32767.0f : (v < -32768.0f) ? -32768.0f : v;
+	return (short)lrintf(v); // rounds to even like the SSE2 conversion
+}
+
+void Mixer::toS16(const float *left, const float *right, int n, short *out)
+{
+	int i = 0;
+
+#if defined(__SSE2__)
+	// the 32 to 16 bit pack saturates, which is the clipping
+	for(; i + 8 <= n; i += 8){
+		__m128i l = _mm_packs_epi32(_mm_cvtps_epi32(_mm_loadu_ps(left + i)), _mm_cvtps_epi32(_mm_loadu_ps(left + i + 4)));
+
+		if(!right){
+			_mm_storeu_si128((__m128i *)(out + i), l);
+			continue;
+		}
+
+		__m128i r = _mm_packs_epi32(_mm_cvtps_epi32(_mm_loadu_ps(right + i)), _mm_cvtps_epi32(_mm_loadu_ps(right + i + 4)));
+		_mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi16(l, r));
+		_mm_storeu_si128((__m128i *)(out + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+	}
+#endif
+
+	for(; i < n; ++i){
+		if(!right){
+			out[i] = sat(left[i]);
+		}
+		else{
+			out[2 * i] = sat(left[i]);
+			out[2 * i + 1] = sat(right[i]);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MIXER_H_
+#define MIXER_H_
+
+/**
+ * Mixes 20 ms vocoder frames of any number of streams at 8 kHz, before the
+ * one resampler of the output, so the cost per stream is a frame of
+ * multiply-adds whatever the sound card rate.  Each input has a linear
+ * gain and is routed to the left, right or both channels of a stereo
+ * output; a mono output takes every input that is not muted.  Sums are
+ * kept in float and only saturated to S16 once, on output.
+ */
+class Mixer
+{
+public:
+	enum Route { Mute = 0, Left = 1, Right = 2, Both = 3 };   //!< as MBEDecoder::setChannels()
+
+	static const int FrameSamples = 160;
+
+	Mixer();
+
+	void setStereo(bool stereo) { m_stereo = stereo; }
+	bool isStereo() const { return m_stereo; }
+
+	/** Start a new frame */
+	void clear();
+	/** Add up to FrameSamples S16 samples of one stream */
+	void add(const short *in, int nbSamples, float gain, int route);
+	int getInputs() const { return m_inputs; }
+
+	/** Left or mono sum, then right, FrameSamples each */
+	const float *getChannel(int c) const { return m_acc[c]; }
+
+	/** Saturate n samples of one (right == nullptr) or two channels to S16, interleaved */
+	static void toS16(const float *left, const float *right, int n, short *out);
+
+private:
+	static void mac(float *acc, const short *in, int n, float gain);
+
+	alignas(16) float m_acc[2][FrameSamples];
+	bool m_stereo;
+	int m_inputs;
+};
+
+#endif /* MIXER_H_ */
@@ -0,0 +1,206 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PACKETS_H_
+#define PACKETS_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Read only views over received datagrams.
+ *
+ * A view holds a pointer into the datagram and reads each field in place at
+ * an offset fixed at compile time, so nothing is copied and a getter is a
+ * single load.  The D-STAR views take one of the layouts below, which give
+ * the framing of each reflector protocol, so one handler serves REF, XRF
+ * and DCS.  The datagram must outlive the view and its size has to be
+ * checked with the layout's is*() functions first.
+ */
+
+/** DPlus: a 2 byte length and flag prefix, then DSVT framing */
+struct REFLayout
+{
+	static constexpr int HeaderSize = 58;
+	static constexpr int VoiceSize = 29;
+	static constexpr int EndSize = 32;
+	static constexpr int StreamID = 14;
+	static constexpr int Seq = 16;
+	static constexpr int AMBE = 17;
+	static constexpr int SlowData = 26;
+	static constexpr int RadioHeader = 17;
+	static constexpr bool HeaderCRC = true;
+	static constexpr bool MatchModule = true;  //!< streams of every module are sent, RPT1/RPT2 tell them apart
+
+	static bool isHeader(const char *d, int len) { return (len == HeaderSize) && !memcmp(d + 1, "\x80" "DSVT", 5); }
+	static bool isVoice(const char *d, int len) { return (len == VoiceSize) && !memcmp(d + 1, "\x80" "DSVT", 5); }
+	static bool isEnd(const char *d, int len) { return (len == EndSize) && !memcmp(d + 1, "\x80" "DSVT", 5); }
+};
+
+/** DExtra: DSVT framing, the stream ends on a voice frame with the last frame flag */
+struct XRFLayout
+{
+	static constexpr int HeaderSize = 56;
+	static constexpr int VoiceSize = 27;
+	static constexpr int StreamID = 12;
+	static constexpr int Seq = 14;
+	static constexpr int AMBE = 15;
+	static constexpr int SlowData = 24;
+	static constexpr int RadioHeader = 15;
+	static constexpr bool HeaderCRC = true;
+	static constexpr bool MatchModule = false;
+
+	static bool isHeader(const char *d, int len) { return (len == HeaderSize) && !memcmp(d, "DSVT", 4); }
+	static bool isVoice(const char *d, int len) { return (len == VoiceSize) && !memcmp(d, "DSVT", 4); }
+	static bool isEnd(const char *, int) { return false; }
+};
+
+/** DCS: every voice frame repeats the radio header, which has no CRC */
+struct DCSLayout
+{
+	static constexpr int MinSize = 100;
+	static constexpr int StreamID = 43;
+	static constexpr int Seq = 45;
+	static constexpr int AMBE = 46;
+	static constexpr int SlowData = 55;
+	static constexpr int RadioHeader = 4;
+	static constexpr bool HeaderCRC = false;
+	static constexpr bool MatchModule = false;
+
+	static bool isHeader(const char *d, int len) { return (len >= MinSize) && !memcmp(d, "0001", 4); }
+	static bool isVoice(const char *d, int len) { return isHeader(d, len); }
+	static bool isEnd(const char *, int) { return false; }
+};
+
+/** Stream ID, sequence and radio header of a D-STAR header packet */
+template<class L> class DStarHeaderView
+{
+public:
+	explicit DStarHeaderView(const char *d) : m_d((const unsigned char *)d) {}
+
+	uint16_t getStreamID() const { return (m_d[L::StreamID] << 8) | m_d[L::StreamID + 1]; }
+	/** The 41 byte radio header: 3 flag bytes, RPT2, RPT1, UR, MY, MY suffix and CRC */
+	const unsigned char *getRadioHeader() const { return m_d + L::RadioHeader; }
+	const char *getRptr2() const { return (const char *)m_d + L::RadioHeader + 3; }
+	const char *getRptr1() const { return (const char *)m_d + L::RadioHeader + 11; }
+	const char *getUrcall() const { return (const char *)m_d + L::RadioHeader + 19; }
+	const char *getMycall() const { return (const char *)m_d + L::RadioHeader + 27; }
+
+	static constexpr int CallsignSize = 8;
+	static constexpr int RadioHeaderSize = 41;
+
+private:
+	const unsigned char *m_d;
+};
+
+/** One 20 ms voice frame: 9 bytes of AMBE and 3 of slow data */
+template<class L> class DStarVoiceView
+{
+public:
+	explicit DStarVoiceView(const char *d) : m_d((const unsigned char *)d) {}
+
+	uint16_t getStreamID() const { return (m_d[L::StreamID] << 8) | m_d[L::StreamID + 1]; }
+	/** Frame counter 0-20, frame 0 carries the slow data sync */
+	uint8_t getSeq() const { return m_d[L::Seq] & 0x1f; }
+	bool isLast() const { return (m_d[L::Seq] & 0x40) != 0; }
+	const unsigned char *getAMBE() const { return m_d + L::AMBE; }
+	const unsigned char *getSlowData() const { return m_d + L::SlowData; }
+
+private:
+	const unsigned char *m_d;
+};
+
+/** YSF network YSFD: gateway, source and destination callsigns, then one 120 byte frame */
+class YSFDView
+{
+public:
+	static constexpr int Size = 155;
+	static constexpr int CallsignSize = 10;
+	static constexpr int FrameSize = 115;        //!< FICH and payload after the 5 byte sync
+
+	static bool isYSFD(const char *d, int len) { return (len == Size) && !memcmp(d, "YSFD", 4); }
+
+	explicit YSFDView(const char *d) : m_d((const unsigned char *)d) {}
+
+	const char *getGateway() const { return (const char *)m_d + 4; }
+	const char *getSource() const { return (const char *)m_d + 14; }
+	const char *getDest() const { return (const char *)m_d + 24; }
+	/** Frame counter in bits 1-7, bit 0 set on the last frame */
+	uint8_t getCounter() const { return m_d[34]; }
+	const unsigned char *getFrame() const { return m_d + 40; }
+
+private:
+	const unsigned char *m_d;
+};
+
+/** Fixed size callsign kept by value, for comparing what is on display without a QString */
+template<int N> struct Callsign
+{
+	char c[N + 1];
+
+	void clear() { memset(c, 0, sizeof(c)); }
+	/** Copy N bytes from a datagram, true if they differ from what was held */
+	bool update(const char *p)
+	{
+		if(!memcmp(c, p, N)){
+			return false;
+		}
+		memcpy(c, p, N);
+		c[N] = '\0';
+		return true;
+	}
+};
+
+/** MMDVM Homebrew DMRD: a 20 byte header then one 33 byte DMR burst */
+class DMRDView
+{
+public:
+	static constexpr int Size = 55;
+
+	static bool isDMRD(const char *d, int len) { return (len == Size) && !memcmp(d, "DMRD", 4); }
+
+	explicit DMRDView(const char *d) : m_d((const unsigned char *)d) {}
+
+	uint8_t getSeq() const { return m_d[4]; }
+	uint32_t getSrcID() const { return (m_d[5] << 16) | (m_d[6] << 8) | m_d[7]; }
+	uint32_t getDstID() const { return (m_d[8] << 16) | (m_d[9] << 8) | m_d[10]; }
+	uint32_t getRepeaterID() const { return ((uint32_t)m_d[11] << 24) | (m_d[12] << 16) | (m_d[13] << 8) | m_d[14]; }
+	uint8_t getSlot() const { return (m_d[15] & 0x80) ? 2 : 1; }
+	bool isGroupCall() const { return (m_d[15] & 0x40) == 0; }
+	/** Voice sync or data sync, otherwise a voice frame B-F */
+	bool isVoiceSync() const { return (m_d[15] & 0x30) == 0x10; }
+	bool isDataSync() const { return (m_d[15] & 0x30) == 0x20; }
+	/** Data type on data sync, voice frame 0-5 otherwise */
+	uint8_t getDataType() const { return m_d[15] & 0x0f; }
+	bool isTerminator() const { return isDataSync() && (getDataType() == 2); }
+	uint32_t getStreamID() const { return ((uint32_t)m_d[16] << 24) | (m_d[17] << 16) | (m_d[18] << 8) | m_d[19]; }
+	const unsigned char *getBurst() const { return m_d + 20; }
+
+	/** The three 9 byte AMBE frames of a voice burst, around the 48 bit sync/EMB in the middle */
+	void getAMBE(unsigned char ambe[27]) const
+	{
+		const unsigned char *b = getBurst();
+		memcpy(ambe, b, 14);
+		ambe[13] = (b[13] & 0xf0) | (b[19] & 0x0f);
+		memcpy(ambe + 14, b + 20, 13);
+	}
+
+private:
+	const unsigned char *m_d;
+};
+
+#endif /* PACKETS_H_ */
@@ -0,0 +1,90 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "pcmring.h"
+
+PCMRing::PCMRing() :
+	m_mask(0),
+	m_write(0),
+	m_read(0)
+{
+	setCapacity(1);
+}
+
+void PCMRing::setCapacity(int samples)
+{
+	uint32_t n = 1;
+
+	while((int)n < samples){
+		n <<= 1;
+	}
+	m_buf.assign(n, 0);
+	m_mask = n - 1;
+	clear();
+}
+
+void PCMRing::clear()
+{
+	m_write.store(0, std::memory_order_relaxed);
+	m_read.store(0, std::memory_order_relaxed);
+}
+
+int PCMRing::getFill() const
+{
+	return m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_acquire);
+}
+
+int PCMRing::write(const int16_t *pcm, int n)
+{
+	uint32_t w = m_write.load(std::memory_order_relaxed);
+	uint32_t r = m_read.load(std::memory_order_acquire);
+	int room = getCapacity() - (int)(w - r);
+
+	if(n > room){
+		n = room;
+	}
+	int first = getCapacity() - (int)(w & m_mask);
+	if(first > n){
+		first = n;
+	}
+	memcpy(&m_buf[w & m_mask], pcm, first * sizeof(int16_t));
+	memcpy(&m_buf[0], pcm + first, (n - first) * sizeof(int16_t));
+	m_write.store(w + n, std::memory_order_release);
+
+	return n;
+}
+
+int PCMRing::read(int16_t *pcm, int n)
+{
+	uint32_t r = m_read.load(std::memory_order_relaxed);
+	uint32_t w = m_write.load(std::memory_order_acquire);
+	int fill = (int)(w - r);
+
+	if(n > fill){
+		n = fill;
+	}
+	int first = getCapacity() - (int)(r & m_mask);
+	if(first > n){
+		first = n;
+	}
+	memcpy(pcm, &m_buf[r & m_mask], first * sizeof(int16_t));
+	memcpy(pcm + first, &m_buf[0], (n - first) * sizeof(int16_t));
+	m_read.store(r + n, std::memory_order_release);
+
+	return n;
+}
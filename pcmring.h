@@ -0,0 +1,60 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PCMRING_H_
+#define PCMRING_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * Single producer, single consumer ring of 16 bit PCM samples between the
+ * decoder and the sound card.  The producer only moves m_write and the
+ * consumer only m_read, each published with a release store, so neither
+ * side takes a lock and either may run on its own thread.  The capacity is
+ * rounded up to a power of two and the indices run freely, so the fill is
+ * their difference.
+ */
+class PCMRing
+{
+public:
+	PCMRing();
+
+	/** Resize and empty the ring, neither side may be running */
+	void setCapacity(int samples);
+	int getCapacity() const { return (int)m_mask + 1; }
+	/** Empty the ring, neither side may be running */
+	void clear();
+
+	/** Samples waiting, exact from either side */
+	int getFill() const;
+	int getFree() const { return getCapacity() - getFill(); }
+
+	/** Producer: copy up to n samples in, returns the number taken */
+	int write(const int16_t *pcm, int n);
+	/** Consumer: copy up to n samples out, returns the number read */
+	int read(int16_t *pcm, int n);
+
+private:
+	std::vector<int16_t> m_buf;
+	uint32_t m_mask;
+	std::atomic<uint32_t> m_write;
+	std::atomic<uint32_t> m_read;
+};
+
+#endif /* PCMRING_H_ */
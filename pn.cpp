@@ -16,19 +16,11 @@
 
 #include "pn.h"
 
-PN_9_5::PN_9_5(unsigned int seed) : m_seed(seed)
+static constexpr PN_9_5::Tables generateTables(unsigned int seed)
 {
-    init();
-}
-
-PN_9_5::~PN_9_5()
-{}
-
-
-void PN_9_5::init()
-{
-    unsigned char byte;
-    unsigned int sr = m_seed;
+    PN_9_5::Tables t{};
+    unsigned char byte = 0;
+    unsigned int sr = seed;
 
     for (int i = 0; i < 512; i++)
     {
@@ -42,13 +34,35 @@ void PN_9_5::init()
         sr >>= 1;
         sr |= (bit4 ^ bit0) << 8;
 
-        m_bitTable[i] = bit0;
+        t.bitTable[i] = bit0;
         byte += bit0 << (7 - (i%8));
+        t.wordTable[i/64] |= (uint64_t) bit0 << (i%64);
 
         if (i%8 == 7)
         {
-            m_byteTable[i/8] = byte;
+            t.byteTable[i/8] = byte;
         }
     }
 
+    return t;
+}
+
+// YSF DCH whitening
+static constexpr unsigned int ysfSeed = 0x1c9;
+static constexpr PN_9_5::Tables ysfTables = generateTables(ysfSeed);
+
+PN_9_5::PN_9_5(unsigned int seed) :
+    m_tables(&ysfTables),
+    m_own_tables(nullptr)
+{
+    if (seed != ysfSeed)
+    {
+        m_own_tables = new Tables(generateTables(seed));
+        m_tables = m_own_tables;
+    }
+}
+
+PN_9_5::~PN_9_5()
+{
+    delete m_own_tables;
 }
@@ -17,33 +17,49 @@
 #ifndef PN_H_
 #define PN_H_
 
+#include <stdint.h>
+
 class PN_9_5
 {
 public:
     explicit PN_9_5(unsigned int seed);
     ~PN_9_5();
 
+    PN_9_5(const PN_9_5&) = delete;
+    PN_9_5& operator=(const PN_9_5&) = delete;
+
     unsigned char getByte(unsigned int byteIndex) const
     {
-        return m_byteTable[byteIndex % 64];
+        return m_tables->byteTable[byteIndex % 64];
     }
 
     unsigned char getBit(unsigned int bitIndex) const
     {
-        return m_bitTable[bitIndex % 512];
+        return m_tables->bitTable[bitIndex % 512];
     }
 
     const unsigned char *getBits() const
     {
-        return m_bitTable;
+        return m_tables->bitTable;
     }
 
-private:
-    void init();
+    /** bit j of word i is sequence bit 64*i + j */
+    uint64_t getWord(unsigned int wordIndex) const
+    {
+        return m_tables->wordTable[wordIndex % 8];
+    }
+
+    /** The sequence of one seed as bytes, bits and 64 bit words */
+    struct Tables
+    {
+        unsigned char byteTable[64];
+        unsigned char bitTable[512];
+        uint64_t wordTable[8];
+    };
 
-    unsigned int m_seed;
-    unsigned char m_byteTable[64];
-    unsigned char m_bitTable[512];
+private:
+    const Tables *m_tables; //!< shared for the YSF seed, else m_own_tables
+    Tables *m_own_tables;
 };
 
 #endif /* PN_H_ */
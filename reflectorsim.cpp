@@ -0,0 +1,706 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <ctime>
+#include <algorithm>
+#include <QCoreApplication>
+#include "reflectorsim.h"
+#include "dudestar_rx.h"
+#include "SHA256.h"
+#include "alloccount.h"
+#include "mbe.h"
+
+static const unsigned char dmr_voice_sync[7] = {0x07, 0x55, 0xfd, 0x7d, 0xf7, 0x5f, 0x70}; // BS sourced, nibble aligned
+static const unsigned char ysf_sync[5] = {0xd4, 0x71, 0xc9, 0x63, 0x4d};
+static const char sd_text[] = "DUDE-Star RX sim    ";
+
+// about 6 seconds per over before the stream ID changes
+static const uint32_t DSTAR_OVER = 21 * 15;
+static const uint32_t YSF_OVER = 60;
+static const uint32_t DMR_OVER = 6 * 17;
+
+static int parse_id(const char *cs, int len)
+{
+	int id = 0;
+
+	if((len < 4) || memcmp(cs, "SIM", 3)){
+		return -1;
+	}
+	for(int i = 3; (i < len) && (cs[i] >= '0') && (cs[i] <= '9'); ++i){
+		id = (id * 10) + (cs[i] - '0');
+	}
+
+	return id;
+}
+
+static qint64 percentile(const QVector<qint64> &sorted, double p)
+{
+	if(sorted.isEmpty()){
+		return 0;
+	}
+
+	return sorted[std::min(sorted.size() - 1, (int)(p * sorted.size()))];
+}
+
+ReflectorSim::ReflectorSim(const QString &m, int count, double s, QObject *parent) :
+	QObject(parent),
+	mode(m.toUpper()),
+	speed(s),
+	udp(nullptr),
+	packets_due(0),
+	sessions(count),
+	packets_sent(0),
+	units_sent(0),
+	units_decoded(0),
+	units_lost(0),
+	viterbi(2, Viterbi::Poly25y, true),
+	crc(CRC::PolyCCITT16, 16, 0x0, 0xffff),
+	pn(0x1c9)
+{
+	units = 1;
+	init_voice();
+
+	if(mode == "YSF"){
+		name = "SIMULATOR";
+		packet_ms = 100;
+	}
+	else if(mode == "DMR"){
+		name = "SIMULATOR";
+		packet_ms = 60;
+		units = 3;
+	}
+	else{
+		name = mode + "999";
+		packet_ms = 20;
+	}
+
+	tick_timer = new QTimer(this);
+	keepalive_timer = new QTimer(this);
+	tick_timer->setTimerType(Qt::PreciseTimer);
+	connect(tick_timer, SIGNAL(timeout()), this, SLOT(tick()));
+	connect(keepalive_timer, SIGNAL(timeout()), this, SLOT(keepalive()));
+}
+
+ReflectorSim::~ReflectorSim()
+{
+}
+
+/**
+ * AMBE frames with random parameters and a pitch index below the erasure,
+ * silence and tone codes, so that every frame is decoded and synthesized
+ * like speech rather than skipped as the silence pattern is.
+ */
+void ReflectorSim::init_voice()
+{
+	uint32_t r = 0x2545f491;
+
+	for(int n = 0; n < VOICE_FRAMES; ++n){
+		char ambe_d[49];
+		char ambe_fr[4][24];
+
+		for(int i = 0; i < 49; ++i){
+			r ^= r << 13;
+			r ^= r >> 17;
+			r ^= r << 5;
+			ambe_d[i] = (r >> 16) & 1;
+		}
+		ambe_d[0] = 0; // MSB of the pitch index
+		memcpy(voice_bits[n], ambe_d, 49);
+		MBEDecoder::encodeAmbe(ambe_d, ambe_fr);
+		MBEDecoder::pack_dstar(ambe_fr, dstar_voice[n]);
+		MBEDecoder::pack_dmr(ambe_fr, dmr_voice[n]);
+	}
+}
+
+QString ReflectorSim::callsign(int id)
+{
+	return QString("SIM%1").arg(id, 3, 10, QChar('0'));
+}
+
+bool ReflectorSim::start()
+{
+	if((mode != "REF") && (mode != "XRF") && (mode != "DCS") && (mode != "YSF") && (mode != "DMR")){
+		return false;
+	}
+
+	udp = new QUdpSocket(this);
+
+	if(!udp->bind(QHostAddress::LocalHost, 0)){
+		return false;
+	}
+
+	connect(udp, SIGNAL(readyRead()), this, SLOT(readyRead()));
+	clock.start();
+	tick_timer->start(std::max(1, (int)(packet_ms / speed)));
+	keepalive_timer->start(1000);
+	return true;
+}
+
+void ReflectorSim::add_client(QObject *client, int id)
+{
+	clients[client] = id;
+	sessions[id].connect_start = now();
+}
+
+void ReflectorSim::client_connected()
+{
+	int id = clients.value(sender(), -1);
+
+	if(id >= 0){
+		connect_times.append(now() - sessions[id].connect_start);
+	}
+}
+
+void ReflectorSim::client_frame_decoded()
+{
+	int id = clients.value(sender(), -1);
+
+	if(id < 0){
+		return;
+	}
+	if(sessions[id].sent.isEmpty()){
+		++units_lost; // decoded something that was never sent, the pairing is off
+		return;
+	}
+
+	latencies.append(now() - sessions[id].sent.dequeue());
+	++units_decoded;
+}
+
+int ReflectorSim::find_session(quint16 port) const
+{
+	for(int i = 0; i < sessions.size(); ++i){
+		if(sessions[i].port == port){
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void ReflectorSim::send(const Session &s, const QByteArray &out)
+{
+	udp->writeDatagram(out, QHostAddress::LocalHost, s.port);
+}
+
+void ReflectorSim::readyRead()
+{
+	QByteArray buf;
+	QByteArray out;
+	QHostAddress sender;
+	quint16 senderPort;
+
+	while(udp->hasPendingDatagrams()){
+		buf.resize(udp->pendingDatagramSize());
+		udp->readDatagram(buf.data(), buf.size(), &sender, &senderPort);
+		const char *d = buf.constData();
+		int id = -1;
+		out.clear();
+
+		if(mode == "REF"){
+			if((buf.size() == 5) && (d[0] == 5)){
+				out = buf; // link request or unlink, echoed
+				if((d[4] == 0) && ((id = find_session(senderPort)) >= 0)){
+					sessions[id].connected = false;
+				}
+			}
+			else if((buf.size() == 28) && ((unsigned char)d[0] == 0x1c) && ((id = parse_id(d + 4, 6)) >= 0) && (id < sessions.size())){
+				out.append("\x08\xc0\x04\x00OKRW", 8);
+				sessions[id].port = senderPort;
+				sessions[id].connected = true;
+				sessions[id].frame = 0;
+			}
+		}
+		else if((mode == "XRF") || (mode == "DCS")){
+			if(((buf.size() == 11) || (buf.size() == 519)) && ((id = parse_id(d, 8)) >= 0) && (id < sessions.size())){
+				if(d[9] == ' '){
+					sessions[id].connected = false;
+				}
+				else{
+					out.append(d, 10);
+					out.append("ACK", 4);
+					sessions[id].port = senderPort;
+					sessions[id].connected = true;
+					sessions[id].frame = 0;
+				}
+			}
+		}
+		else if(mode == "YSF"){
+			if((buf.size() >= 14) && !memcmp(d, "YSFP", 4) && ((id = parse_id(d + 4, 10)) >= 0) && (id < sessions.size())){
+				out.append("YSFP", 4);
+				out.append(name.leftJustified(10, ' ').toLocal8Bit());
+				if(!sessions[id].connected){
+					sessions[id].port = senderPort;
+					sessions[id].connected = true;
+					sessions[id].frame = 0;
+				}
+			}
+			else if(!memcmp(d, "YSFU", 4) && ((id = find_session(senderPort)) >= 0)){
+				sessions[id].connected = false;
+			}
+		}
+		else if((mode == "DMR") && (buf.size() >= 8)){
+			uint32_t dmrid = ((unsigned char)d[4] << 24) | ((unsigned char)d[5] << 16) | ((unsigned char)d[6] << 8) | (unsigned char)d[7];
+			if(!memcmp(d, "RPTPING", 7)){
+				out.append("MSTPONG", 7);
+				out.append(d + 7, 4);
+			}
+			else if(((id = (int)(dmrid - BaseDMRID)) >= 0) && (id < sessions.size())){
+				Session &s = sessions[id];
+				if((buf.size() == 8) && !memcmp(d, "RPTL", 4)){
+					s.port = senderPort;
+					s.salt = 0x5a5a0000 ^ dmrid;
+					out.append("RPTACK", 6);
+					out.append((char)(s.salt >> 24));
+					out.append((char)(s.salt >> 16));
+					out.append((char)(s.salt >> 8));
+					out.append((char)s.salt);
+				}
+				else if((buf.size() == 40) && !memcmp(d, "RPTK", 4)){
+					CSHA256 sha256;
+					QByteArray in;
+					unsigned char hash[32];
+					in.append((char)(s.salt >> 24));
+					in.append((char)(s.salt >> 16));
+					in.append((char)(s.salt >> 8));
+					in.append((char)s.salt);
+					in.append(get_password().toLocal8Bit());
+					sha256.buffer((const unsigned char *)in.constData(), in.size(), hash);
+					out.append(memcmp(hash, d + 8, 32) ? "MSTNAK" : "RPTACK", 6);
+					out.append(d + 4, 4);
+				}
+				else if((buf.size() == 302) && !memcmp(d, "RPTC", 4)){
+					out.append("RPTACK", 6);
+					out.append(d + 4, 4);
+					s.connected = true;
+					s.frame = 0;
+				}
+				else if((buf.size() == 9) && !memcmp(d, "RPTCL", 5)){
+					s.connected = false;
+				}
+			}
+		}
+		if(!out.isEmpty()){
+			udp->writeDatagram(out, sender, senderPort);
+		}
+	}
+}
+
+void ReflectorSim::keepalive()
+{
+	QByteArray out;
+
+	if(mode == "REF"){
+		out.append("\x03\x60\x00", 3);
+	}
+	else if(mode == "XRF"){
+		out.append(name.leftJustified(8, ' ').toLocal8Bit());
+		out.append('\0');
+	}
+	else if(mode == "DCS"){
+		out.append(name.leftJustified(7, ' ').toLocal8Bit());
+		out.append(' ');
+		out.append('\0');
+		out.append(13, ' ');
+	}
+	else{
+		return; // YSF and DMR clients ping the reflector
+	}
+	for(int i = 0; i < sessions.size(); ++i){
+		if(sessions[i].connected){
+			send(sessions[i], out);
+		}
+	}
+}
+
+void ReflectorSim::tick()
+{
+	uint64_t due = (uint64_t)(clock.nsecsElapsed() / 1e6 * speed / packet_ms);
+
+	for(; packets_due < due; ++packets_due){
+		for(int i = 0; i < sessions.size(); ++i){
+			Session &s = sessions[i];
+			if(!s.connected){
+				continue;
+			}
+			if(s.frame == 0){
+				s.streamid = (qrand() & 0xfffe) + 1;
+			}
+			if(mode == "REF"){
+				send_ref(s);
+			}
+			else if(mode == "XRF"){
+				send_xrf(s);
+			}
+			else if(mode == "DCS"){
+				send_dcs(s);
+			}
+			else if(mode == "YSF"){
+				send_ysf(s);
+			}
+			else if(mode == "DMR"){
+				send_dmr(s);
+			}
+			++packets_sent;
+			units_sent += units;
+			for(int u = 0; u < units; ++u){
+				s.sent.enqueue(now());
+			}
+		}
+	}
+}
+
+void ReflectorSim::dstar_header(unsigned char *hdr, int id)
+{
+	hdr[0] = hdr[1] = hdr[2] = 0;
+	memcpy(hdr + 3, name.leftJustified(7, ' ').append(get_module()).toLocal8Bit().constData(), 8);
+	memcpy(hdr + 11, name.leftJustified(7, ' ').append('G').toLocal8Bit().constData(), 8);
+	memcpy(hdr + 19, "CQCQCQ  ", 8);
+	memcpy(hdr + 27, callsign(id).leftJustified(8, ' ').toLocal8Bit().constData(), 8);
+	memcpy(hdr + 35, "SIM ", 4);
+	dstarcrc.append_crc(hdr, 41);
+}
+
+void ReflectorSim::dstar_slow_data(unsigned char *sd, uint32_t frame)
+{
+	int seq = frame % 21;
+	int b = 5 * ((seq - 1) / 2);
+
+	if(seq == 0){
+		sd[0] = 0x55;
+		sd[1] = 0x2d;
+		sd[2] = 0x16;
+	}
+	else if((seq <= 8) && (seq & 1)){
+		sd[0] = (0x40 | ((seq - 1) / 2)) ^ 0x70;
+		sd[1] = sd_text[b] ^ 0x4f;
+		sd[2] = sd_text[b + 1] ^ 0x93;
+	}
+	else if(seq <= 8){
+		sd[0] = sd_text[b + 2] ^ 0x70;
+		sd[1] = sd_text[b + 3] ^ 0x4f;
+		sd[2] = sd_text[b + 4] ^ 0x93;
+	}
+	else{
+		sd[0] = 0x66 ^ 0x70;
+		sd[1] = 0x66 ^ 0x4f;
+		sd[2] = 0x66 ^ 0x93;
+	}
+}
+
+void ReflectorSim::send_ref(Session &s)
+{
+	unsigned char p[58];
+	int id = &s - sessions.data();
+
+	memset(p, 0, sizeof(p));
+	memcpy(p + 1, "\x80" "DSVT", 5);
+	p[10] = 0x20;
+	p[12] = 0x01;
+	p[13] = 0x02;
+	p[14] = s.streamid >> 8;
+	p[15] = s.streamid & 0xff;
+
+	if(s.frame == 0){
+		p[0] = 0x3a;
+		p[6] = 0x10;
+		p[16] = 0x80;
+		dstar_header(p + 17, id);
+		send(s, QByteArray((const char *)p, 58));
+	}
+
+	p[0] = 0x1d;
+	p[6] = 0x20;
+	p[16] = s.frame % 21;
+	memcpy(p + 17, dstar_voice[s.frame % VOICE_FRAMES], 9);
+	dstar_slow_data(p + 26, s.frame);
+	send(s, QByteArray((const char *)p, 29));
+
+	if(++s.frame == DSTAR_OVER){
+		p[0] = 0x20;
+		p[16] = (s.frame % 21) | 0x40;
+		memset(p + 26, 0x55, 3);
+		memcpy(p + 29, "\x55\xc8\x7a", 3);
+		send(s, QByteArray((const char *)p, 32));
+		s.frame = 0;
+	}
+}
+
+void ReflectorSim::send_xrf(Session &s)
+{
+	unsigned char p[56];
+	int id = &s - sessions.data();
+
+	memset(p, 0, sizeof(p));
+	memcpy(p, "DSVT", 4);
+	p[8] = 0x20;
+	p[10] = 0x01;
+	p[11] = 0x02;
+	p[12] = s.streamid >> 8;
+	p[13] = s.streamid & 0xff;
+
+	if(s.frame == 0){
+		p[4] = 0x10;
+		p[14] = 0x80;
+		dstar_header(p + 15, id);
+		send(s, QByteArray((const char *)p, 56));
+	}
+
+	p[4] = 0x20;
+	p[14] = s.frame % 21;
+	memcpy(p + 15, dstar_voice[s.frame % VOICE_FRAMES], 9);
+	dstar_slow_data(p + 24, s.frame);
+
+	if(++s.frame == DSTAR_OVER){
+		p[14] |= 0x40;
+		s.frame = 0;
+	}
+
+	send(s, QByteArray((const char *)p, 27));
+}
+
+void ReflectorSim::send_dcs(Session &s)
+{
+	unsigned char p[100];
+	unsigned char hdr[41];
+	int id = &s - sessions.data();
+
+	memset(p, 0, sizeof(p));
+	dstar_header(hdr, id);
+	memcpy(p, "0001", 4);
+	memcpy(p + 7, hdr + 3, 36);
+	p[43] = s.streamid >> 8;
+	p[44] = s.streamid & 0xff;
+	p[45] = s.frame % 21;
+	memcpy(p + 46, dstar_voice[s.frame % VOICE_FRAMES], 9);
+	dstar_slow_data(p + 55, s.frame);
+	p[58] = s.counter++;
+	p[61] = 0x01;
+
+	if(++s.frame == DSTAR_OVER){
+		p[45] |= 0x40;
+		s.frame = 0;
+	}
+
+	send(s, QByteArray((const char *)p, 100));
+}
+
+void ReflectorSim::send_ysf(Session &s)
+{
+	unsigned char p[155];
+	int id = &s - sessions.data();
+	int fi = (s.frame == 0) ? 0 : (s.frame == YSF_OVER - 1) ? 2 : 1;
+
+	memset(p, ' ', 34);
+	memcpy(p, "YSFD", 4);
+	memcpy(p + 4, "SIMGW", 5);
+	memcpy(p + 14, callsign(id).toLocal8Bit().constData(), 6);
+	memcpy(p + 24, "ALL", 3);
+	p[34] = (s.counter++ << 1) | (fi == 2);
+	memcpy(p + 35, ysf_sync, 5);
+	encode_ysf(p + 40, fi, (fi == 1) ? (s.frame - 1) % 7 : 0, 6, 5 * s.frame);
+	send(s, QByteArray((const char *)p, 155));
+
+	if(++s.frame == YSF_OVER){
+		s.frame = 0;
+	}
+}
+
+void ReflectorSim::send_dmr(Session &s)
+{
+	unsigned char p[55];
+	unsigned char *f = p + 20;
+	uint32_t src = BaseDMRID + (&s - sessions.data());
+	int burst = s.frame % 6;
+
+	memset(p, 0, sizeof(p));
+	memcpy(p, "DMRD", 4);
+	p[4] = s.counter++;
+	p[5] = src >> 16;
+	p[6] = src >> 8;
+	p[7] = src;
+	p[10] = 9; // TG 9
+	p[11] = src >> 24;
+	p[12] = src >> 16;
+	p[13] = src >> 8;
+	p[14] = src;
+	p[15] = burst ? burst : 0x10; // TS1 group call, voice sync on burst A
+	p[16] = 0;
+	p[17] = 0;
+	p[18] = s.streamid >> 8;
+	p[19] = s.streamid & 0xff;
+
+	// three AMBE frames around the 48 bit sync/EMB field, as readyReadDMR() takes them apart
+	unsigned char a[27];
+	for(int i = 0; i < 3; ++i){
+		memcpy(a + 9 * i, dmr_voice[(3 * s.frame + i) % VOICE_FRAMES], 9);
+	}
+	memcpy(f, a, 13);
+	f[13] = a[13] & 0xf0;
+	f[19] = a[13] & 0x0f;
+	memcpy(f + 20, a + 14, 13);
+	if(burst == 0){
+		f[13] |= dmr_voice_sync[0];
+		memcpy(f + 14, dmr_voice_sync + 1, 5);
+		f[19] |= dmr_voice_sync[6];
+	}
+
+	send(s, QByteArray((const char *)p, 55));
+
+	if(++s.frame == DMR_OVER){
+		s.frame = 0;
+	}
+}
+
+/**
+ * Build the 115 bytes after the sync of a YSF frame: FICH with the given frame
+ * information, V/D mode 2, and five VCH carrying the 49 bit AMBE frames from
+ * voice_bits[voice] on. The DCH are left empty. This is the inverse of DSDYSF::processFICH() and processVD2Voice().
+ */
+void ReflectorSim::encode_ysf(unsigned char *frame, int fi, int fn, int ft, uint32_t voice)
+{
+	unsigned char dibits[460];
+	unsigned char bits[100];
+	unsigned char bytes[6];
+	unsigned char sym[100];
+	unsigned char raw[104];
+
+	memset(dibits, 0, sizeof(dibits));
+	memset(bits, 0, sizeof(bits));
+
+	// FICH: FI, CS, CM, BN, BT, FN, FT, reserved, Dev, MR, VoIP, DT, SQL, SC
+	bits[0] = (fi >> 1) & 1;
+	bits[1] = fi & 1;
+	for(int i = 0; i < 3; ++i){
+		bits[10 + i] = (fn >> (2 - i)) & 1;
+		bits[13 + i] = (ft >> (2 - i)) & 1;
+	}
+	bits[21] = 1;
+	bits[22] = 1; // V/D mode 2
+
+	for(int i = 0; i < 4; ++i){
+		bytes[i] = 0;
+		for(int j = 0; j < 8; ++j){
+			bytes[i] |= bits[8 * i + j] << (7 - j);
+		}
+	}
+
+	unsigned int c = crc.crctablefast(bytes, 4);
+	for(int j = 0; j < 16; ++j){
+		bits[32 + j] = (c >> (15 - j)) & 1;
+	}
+
+	unsigned char coded[100];
+	memset(coded, 0, sizeof(coded)); // 4 tail bits
+	for(int i = 0; i < 4; ++i){
+		golay.encode(&bits[12 * i], &coded[24 * i]);
+	}
+
+	viterbi.encodeToSymbols(sym, coded, 100, 0);
+
+	for(int i = 0; i < 100; ++i){
+		dibits[20 * (i % 5) + i / 5] = sym[i];
+	}
+
+	// VCH: 27 bits repeated 3 times, 22 bits as is, one spare, whitened, then the 26x4 interleave
+	for(int n = 0; n < 5; ++n){
+		const unsigned char *b = voice_bits[(voice + n) % VOICE_FRAMES];
+		unsigned char *vch = &dibits[100 + 72 * n + 20];
+
+		memset(raw, 0, sizeof(raw));
+		for(int i = 0; i < 49; ++i){
+			if(i < 27){
+				raw[3 * i] = raw[3 * i + 1] = raw[3 * i + 2] = b[i];
+			}
+			else{
+				raw[81 + i - 27] = b[i];
+			}
+		}
+		for(int i = 0; i < 104; ++i){
+			raw[i] ^= pn.getBit(i);
+		}
+		for(int i = 0; i < 26; ++i){
+			vch[2 * i] = (raw[i] << 1) | raw[26 + i];
+			vch[2 * i + 1] = (raw[52 + i] << 1) | raw[78 + i];
+		}
+	}
+
+	for(int i = 0; i < 115; ++i){
+		frame[i] = (dibits[4 * i] << 6) | (dibits[4 * i + 1] << 4) | (dibits[4 * i + 2] << 2) | dibits[4 * i + 3];
+	}
+}
+
+void ReflectorSim::print_report(double secs, double cpu)
+{
+	int connected = 0;
+
+	for(int i = 0; i < sessions.size(); ++i){
+		connected += sessions[i].connected;
+	}
+
+	std::sort(connect_times.begin(), connect_times.end());
+	std::sort(latencies.begin(), latencies.end());
+	printf("Simulated %s reflector, %d sessions at %.2fx for %.1f s\n", mode.toLocal8Bit().constData(), sessions.size(), speed, secs);
+	printf("connected:     %d/%d, connect time p50 %.2f ms, max %.2f ms\n", connected, sessions.size(),
+		   percentile(connect_times, 0.5) / 1000.0, connect_times.isEmpty() ? 0.0 : connect_times.last() / 1000.0);
+	printf("packets sent:  %llu, %.0f/s\n", (unsigned long long)packets_sent, packets_sent / secs);
+	printf("audio frames:  %llu sent, %llu decoded, %llu still queued, %llu unmatched\n", (unsigned long long)units_sent,
+		   (unsigned long long)units_decoded, (unsigned long long)(units_sent - units_decoded), (unsigned long long)units_lost);
+	printf("latency:       p50 %.2f ms, p99 %.2f ms, max %.2f ms (send to decoded audio)\n", percentile(latencies, 0.5) / 1000.0,
+		   percentile(latencies, 0.99) / 1000.0, latencies.isEmpty() ? 0.0 : latencies.last() / 1000.0);
+	printf("cpu:           %.1f%% of one core, about %.0f sessions per core at this rate\n", 100.0 * cpu / secs,
+		   (cpu > 0.0) ? sessions.size() * secs / cpu : 0.0);
+}
+
+int run_simulation(const QString &mode, int count, double speed, int secs)
+{
+	ReflectorSim sim(mode, count, speed);
+	QVector<DudeStarRX *> clients;
+	QElapsedTimer wall;
+
+	if(!sim.start()){
+		fprintf(stderr, "Cannot start a %s simulator\n", mode.toLocal8Bit().constData());
+		return 1;
+	}
+
+	for(int i = 0; i < count; ++i){
+		DudeStarRX *c = new DudeStarRX(nullptr, true);
+		QObject::connect(c, SIGNAL(connected()), &sim, SLOT(client_connected()));
+		QObject::connect(c, SIGNAL(frame_decoded()), &sim, SLOT(client_frame_decoded()));
+		sim.add_client(c, i);
+		c->connect_to_host(mode.toUpper(), sim.get_name(), "127.0.0.1", sim.get_port(), ReflectorSim::callsign(i),
+						   sim.get_module(), ReflectorSim::BaseDMRID + i, sim.get_password());
+		clients.append(c);
+	}
+
+	std::clock_t cpu = std::clock();
+	wall.start();
+	QTimer::singleShot(secs * 1000, QCoreApplication::instance(), SLOT(quit()));
+	QCoreApplication::exec();
+	sim.print_report(wall.nsecsElapsed() / 1e9, (std::clock() - cpu) / (double)CLOCKS_PER_SEC);
+	if(AllocCount::isEnabled()){
+		uint64_t packets = 0, allocs = 0;
+		for(int i = 0; i < clients.size(); ++i){
+			packets += clients[i]->get_voice_packets();
+			allocs += clients[i]->get_voice_allocs();
+		}
+		printf("heap allocs:   %llu in %llu voice packets, %.2f per packet\n", (unsigned long long)allocs, (unsigned long long)packets,
+			   packets ? allocs / (double)packets : 0.0);
+	}
+	qDeleteAll(clients);
+	return 0;
+}
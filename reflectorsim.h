@@ -0,0 +1,133 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef REFLECTORSIM_H
+#define REFLECTORSIM_H
+
+#include <QObject>
+#include <QtNetwork>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QQueue>
+#include <QVector>
+#include <QMap>
+#include "viterbi5.h"
+#include "fec.h"
+#include "crc.h"
+#include "pn.h"
+
+/**
+ * Loopback stand-in for a REF (DPlus), XRF (DExtra), DCS, YSF or Homebrew DMR
+ * reflector. It answers the client side handshakes and keepalives the way
+ * hostname_lookup() and the readyReadXXX() handlers expect, then streams
+ * synthetic voice (valid headers, AMBE voice frames, slow data text, encoded
+ * YSF V/D mode 2 frames) to every connected session at a configurable speed.
+ *
+ * Clients are identified by their callsign, SIMnnn, or for DMR by their ID,
+ * BaseDMRID + nnn. When a client's connected()/frame_decoded() signals are
+ * routed to the simulator it measures connect time and end to end latency
+ * from the send of a voice packet to the decode of its audio.
+ */
+class ReflectorSim : public QObject
+{
+	Q_OBJECT
+
+public:
+	ReflectorSim(const QString &mode, int sessions, double speed, QObject *parent = nullptr);
+	~ReflectorSim();
+
+	bool start();
+	quint16 get_port() const { return udp->localPort(); }
+	QString get_name() const { return name; }
+	char get_module() const { return 'C'; }
+	QString get_password() const { return "passw0rd"; }
+	void add_client(QObject *client, int id);
+	void print_report(double secs, double cpu);
+
+	static QString callsign(int id);
+	static const uint32_t BaseDMRID = 3100000;
+
+public slots:
+	void client_connected();
+	void client_frame_decoded();
+
+private slots:
+	void readyRead();
+	void tick();
+	void keepalive();
+
+private:
+	struct Session
+	{
+		bool connected = false;
+		quint16 port = 0;
+		uint16_t streamid = 0;
+		uint32_t frame = 0;                //!< packets sent in the current over
+		uint8_t counter = 0;
+		uint32_t salt = 0;
+		qint64 connect_start = 0;
+		QQueue<qint64> sent;               //!< send time of every audio unit not decoded yet
+	};
+
+	int find_session(quint16 port) const;
+	void send(const Session &s, const QByteArray &out);
+	void send_ref(Session &s);
+	void send_xrf(Session &s);
+	void send_dcs(Session &s);
+	void send_ysf(Session &s);
+	void send_dmr(Session &s);
+	void dstar_header(unsigned char *hdr, int id);
+	void dstar_slow_data(unsigned char *sd, uint32_t frame);
+	void init_voice();
+	void encode_ysf(unsigned char *frame, int fi, int fn, int ft, uint32_t voice);
+	qint64 now() const { return clock.nsecsElapsed() / 1000; }
+
+	QString mode;
+	QString name;
+	double speed;
+	int packet_ms;                         //!< one voice packet every packet_ms at speed 1
+	int units;                             //!< audio units the client decodes per voice packet
+	QUdpSocket *udp;
+	QTimer *tick_timer;
+	QTimer *keepalive_timer;
+	QElapsedTimer clock;
+	uint64_t packets_due;
+	QVector<Session> sessions;
+	QMap<QObject *, int> clients;
+	QVector<qint64> connect_times;
+	QVector<qint64> latencies;
+	uint64_t packets_sent;
+	uint64_t units_sent;
+	uint64_t units_decoded;
+	uint64_t units_lost;
+
+	Viterbi5 viterbi;
+	Golay_24_12 golay;
+	CRC crc;
+	PN_9_5 pn;
+	DStarCRC dstarcrc;
+
+	static const int VOICE_FRAMES = 50;    //!< one second of voice, looped by every stream
+	unsigned char voice_bits[VOICE_FRAMES][49];  //!< AMBE parameters, one bit per byte as YSF V/D mode 2 carries them
+	unsigned char dstar_voice[VOICE_FRAMES][9];
+	unsigned char dmr_voice[VOICE_FRAMES][9];
+};
+
+/** Run sessions headless clients against a simulator for secs seconds and print the report */
+int run_simulation(const QString &mode, int sessions, double speed, int secs);
+
+#endif // REFLECTORSIM_H
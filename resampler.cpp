@@ -0,0 +1,204 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "resampler.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static int gcd(int a, int b)
+{
+	while(b){
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+Resampler::Resampler(int outRate, int inRate, bool adaptive) :
+	m_outRate(outRate),
+	m_phase(0),
+	m_S(0),
+	m_acc(0),
+	m_step(0),
+	m_trim(0.0),
+	m_histPos(0)
+{
+	int g = gcd(outRate, inRate);
+	m_L = outRate / g;
+	m_M = inRate / g;
+	if(adaptive){
+		m_S = (MinPhases + m_L - 1) / m_L;
+	}
+	m_coeffs = coefficients(m_S ? m_L * m_S : m_L);
+	setTrim(0.0);
+	memset(m_hist, 0, sizeof(m_hist));
+}
+
+Resampler::~Resampler()
+{
+}
+
+void Resampler::reset()
+{
+	m_phase = 0;
+	m_acc = 0;
+	m_histPos = 0;
+	memset(m_hist, 0, sizeof(m_hist));
+}
+
+const float *Resampler::coefficients(int L)
+{
+	static std::mutex lock;
+	static std::map<int, std::vector<float> > banks;
+	std::lock_guard<std::mutex> guard(lock);
+	std::vector<float> &bank = banks[L];
+
+	if(bank.empty()){
+		const int N = L * TapsPerPhase;
+		const double fc = 0.45 / L; // cutoff relative to the oversampled rate, 3.6 kHz for an 8 kHz input
+		std::vector<double> proto(N);
+
+		for(int n = 0; n < N; ++n){
+			double t = n - (N - 1) / 2.0;
+			double sinc = (t == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+			double w = 0.42 - 0.5 * cos(2.0 * M_PI * n / (N - 1)) + 0.08 * cos(4.0 * M_PI * n / (N - 1));
+			proto[n] = sinc * w;
+		}
+
+		double sum = 0.0;
+
+		for(int n = 0; n < N; ++n){
+			sum += proto[n];
+		}
+
+		// unity gain per phase, stored time reversed so tap j multiplies the j-th oldest input;
+		// phase L is phase 0 of the next input, which the adaptive path interpolates towards
+		bank.resize(N + TapsPerPhase);
+
+		for(int p = 0; p <= L; ++p){
+			for(int j = 0; j < TapsPerPhase; ++j){
+				int n = p + (TapsPerPhase - 1 - j) * L;
+				bank[p * TapsPerPhase + j] = (n < N) ? (float)(proto[n] * L / sum) : 0.0f;
+			}
+		}
+	}
+
+	return bank.data();
+}
+
+float Resampler::dot(const float *a, const float *b)
+{
+#if defined(__SSE2__)
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+
+	for(int j = 0; j < TapsPerPhase; j += 8){
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(b + j)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + j + 4), _mm_loadu_ps(b + j + 4)));
+	}
+
+	acc0 = _mm_add_ps(acc0, acc1);
+	acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+	acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+	return _mm_cvtss_f32(acc0);
+#else
+	float acc = 0.0f;
+
+	for(int j = 0; j < TapsPerPhase; ++j){
+		acc += a[j] * b[j];
+	}
+
+	return acc;
+#endif
+}
+
+void Resampler::setTrim(double ppm)
+{
+	if(!m_S){
+		return;
+	}
+	if(ppm > MaxTrim){
+		ppm = MaxTrim;
+	}
+	else if(ppm < -MaxTrim){
+		ppm = -MaxTrim;
+	}
+	m_trim = ppm;
+	m_step = (uint64_t)((double)m_M * m_S * (1.0 + ppm * 1e-6) * 4294967296.0 + 0.5);
+}
+
+int Resampler::process(const float *in, int nbIn, float *out)
+{
+	int nbOut = 0;
+
+	if(m_S){
+		return processAdaptive(in, nbIn, out);
+	}
+
+	for(int i = 0; i < nbIn; ++i){
+		m_hist[m_histPos] = in[i];
+		m_hist[m_histPos + TapsPerPhase] = in[i];
+		m_histPos = (m_histPos + 1) % TapsPerPhase;
+
+		// every output instant falling between this input and the next one
+		while(m_phase < m_L){
+			out[nbOut++] = dot(m_coeffs + m_phase * TapsPerPhase, m_hist + m_histPos);
+			m_phase += m_M;
+		}
+
+		m_phase -= m_L;
+	}
+
+	return nbOut;
+}
+
+int Resampler::processAdaptive(const float *in, int nbIn, float *out)
+{
+	const uint64_t end = (uint64_t)(m_L * m_S) << 32;
+	int nbOut = 0;
+
+	for(int i = 0; i < nbIn; ++i){
+		m_hist[m_histPos] = in[i];
+		m_hist[m_histPos + TapsPerPhase] = in[i];
+		m_histPos = (m_histPos + 1) % TapsPerPhase;
+
+		while(m_acc < end){
+			const float *c = m_coeffs + (m_acc >> 32) * TapsPerPhase;
+			const float *h = m_hist + m_histPos;
+			uint32_t frac = (uint32_t)m_acc;
+			float a = dot(c, h);
+
+			if(frac){
+				a += (dot(c + TapsPerPhase, h) - a) * (frac * (1.0f / 4294967296.0f));
+			}
+			out[nbOut++] = a;
+			m_acc += m_step;
+		}
+
+		m_acc -= end;
+	}
+
+	return nbOut;
+}
@@ -0,0 +1,74 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include <stdint.h>
+
+/**
+ * Rational L/M polyphase FIR resampler used to bring the 8 kHz vocoder output
+ * up to a rate the sound card accepts (16, 44.1, 48 kHz...). The prototype
+ * low pass is a Blackman windowed sinc cut just below 4 kHz; its coefficient
+ * banks are built once per ratio and shared by every instance.
+ *
+ * An adaptive resampler can also play slightly faster or slower than the
+ * nominal ratio, to follow a sound card clock.  Its bank has at least
+ * MinPhases phases and the output instant falls between two of them, so
+ * the result is interpolated from both; it is built even for equal rates.
+ */
+class Resampler
+{
+public:
+	explicit Resampler(int outRate, int inRate = 8000, bool adaptive = false);
+	~Resampler();
+
+	/** Resample nbIn input samples, returns the number of samples written to out */
+	int process(const float *in, int nbIn, float *out);
+	void reset();
+
+	/** Consume the input ppm faster than the nominal ratio (slower if negative), adaptive only */
+	void setTrim(double ppm);
+	double getTrim() const { return m_trim; }
+
+	int getOutputRate() const { return m_outRate; }
+	bool isAdaptive() const { return m_S != 0; }
+	int maxOutput(int nbIn) const { return (nbIn * m_L + m_M - 1) / m_M + (m_S ? 2 + nbIn * m_L / (m_M * 500) : 0); }
+
+	static const int TapsPerPhase = 32;
+	static const int MinPhases = 64;
+	static const int MaxTrim = 1000;    //!< ppm
+
+private:
+	static const float *coefficients(int L);
+	static float dot(const float *a, const float *b);
+	int processAdaptive(const float *in, int nbIn, float *out);
+
+	int m_outRate;
+	int m_L;                         //!< interpolation factor
+	int m_M;                         //!< decimation factor
+	int m_phase;                     //!< current phase in the L times oversampled domain
+	int m_S;                         //!< sub-phases per phase when adaptive, 0 otherwise
+	uint64_t m_acc;                  //!< adaptive: phase in the L*S domain, 32.32 fixed point
+	uint64_t m_step;                 //!< adaptive: m_acc advance per output sample
+	double m_trim;
+	const float *m_coeffs;           //!< L phases of TapsPerPhase taps, time reversed, then one more
+	float m_hist[2*TapsPerPhase];    //!< input delay line, mirrored so a window is always contiguous
+	int m_histPos;
+};
+
+#endif /* RESAMPLER_H_ */
@@ -0,0 +1,129 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "slowdata.h"
+#include "crc.h"
+
+static const uint32_t Scrambler = 0x934f70;     // 0x70 0x4f 0x93, first byte lowest
+
+const uint8_t SlowData::m_kinds[16] = {
+	Ignore, Ignore, Ignore, KindGPS, KindText, KindHeader, Ignore, Ignore,
+	Ignore, Ignore, Ignore, Ignore, Ignore, Ignore, Ignore, Ignore     // 0x6 fill, 0xc squelch
+};
+
+SlowData::SlowData()
+{
+	m_text[0] = '\0';
+	m_line[0] = '\0';
+	memset(m_header, 0, sizeof(m_header));
+	reset();
+}
+
+void SlowData::reset()
+{
+	m_last = -1;
+	m_textBlocks = 0;
+	m_headerLen = 0;
+	m_lineLen = 0;
+}
+
+int SlowData::process(uint8_t seq, const unsigned char *sd)
+{
+	uint32_t w = (sd[0] | (sd[1] << 8) | (sd[2] << 16)) ^ Scrambler;
+
+	if(seq == 0){
+		if(w == (0x162d55 ^ Scrambler)){ // sync, the header copy restarts
+			m_headerLen = 0;
+		}
+		m_last = -1;
+		return None;
+	}
+	if(seq & 1){
+		m_block[0] = w;
+		m_block[1] = w >> 8;
+		m_block[2] = w >> 16;
+		m_last = seq;
+		return None;
+	}
+	if(m_last != seq - 1){
+		return None; // first half lost
+	}
+
+	m_block[3] = w;
+	m_block[4] = w >> 8;
+	m_block[5] = w >> 16;
+	m_last = -1;
+
+	return block();
+}
+
+int SlowData::block()
+{
+	const int len = m_block[0] & 0x0f;
+	const unsigned char *data = m_block + 1;
+	int r = None;
+
+	switch(m_kinds[m_block[0] >> 4]){
+	case KindText:
+		memcpy(m_textWork + (len & 3) * 5, data, 5);
+		m_textBlocks |= 1 << (len & 3);
+		if(m_textBlocks == 0x0f){
+			memcpy(m_text, m_textWork, TextSize);
+			m_text[TextSize] = '\0';
+			m_textBlocks = 0;
+			r = Text;
+		}
+		break;
+	case KindGPS:
+		for(int i = 0; (i < len) && (i < 5); ++i){
+			char c = data[i];
+			if((c == '\r') || (c == '\n')){
+				if(m_lineLen){
+					memcpy(m_line, m_lineWork, m_lineLen);
+					m_line[m_lineLen] = '\0';
+					r |= strncmp(m_line, "$$CRC", 5) ? GPS : DPRS;
+				}
+				m_lineLen = 0;
+			}
+			else if(m_lineLen < MaxLine - 1){
+				m_lineWork[m_lineLen++] = c;
+			}
+			else{
+				m_lineLen = 0; // runaway line
+			}
+		}
+		break;
+	case KindHeader:
+		for(int i = 0; (i < len) && (i < 5) && (m_headerLen < HeaderSize); ++i){
+			m_headerWork[m_headerLen++] = data[i];
+		}
+		if(m_headerLen == HeaderSize){
+			DStarCRC crc;
+			if(crc.check_crc(m_headerWork, HeaderSize)){
+				memcpy(m_header, m_headerWork, HeaderSize);
+				r = Header;
+			}
+			m_headerLen = 0;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return r;
+}
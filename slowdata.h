@@ -0,0 +1,80 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SLOWDATA_H_
+#define SLOWDATA_H_
+
+#include <stdint.h>
+
+/**
+ * D-STAR slow data decoder for one voice stream.
+ *
+ * Each voice frame carries 3 scrambled bytes of slow data.  Frame 0 of a
+ * superframe holds the sync pattern, frames 1-20 hold ten 6 byte blocks
+ * whose first byte gives the block type in the high nibble: 0x3 GPS/DPRS
+ * with the number of bytes in the low nibble, 0x4 text with the block
+ * number, 0x5 a copy of the radio header.  Results are only published once
+ * complete: 20 characters of text, a radio header with a valid CRC, or one
+ * GPS/DPRS line ended by CR.
+ */
+class SlowData
+{
+public:
+	enum Result {
+		None = 0,
+		Text = 1,
+		GPS = 2,          //!< an NMEA sentence
+		DPRS = 4,         //!< a "$$CRC" D-PRS position report
+		Header = 8
+	};
+
+	static const int TextSize = 20;
+	static const int HeaderSize = 41;
+	static const int MaxLine = 256;
+
+	SlowData();
+
+	/** Forget partial blocks, published results are kept */
+	void reset();
+	/** Take the slow data of frame seq 0-20, returns the Results completed by it */
+	int process(uint8_t seq, const unsigned char *sd);
+
+	const char *getText() const { return m_text; }
+	/** Last GPS or DPRS line, without its CR */
+	const char *getLine() const { return m_line; }
+	const unsigned char *getHeader() const { return m_header; }
+
+private:
+	enum Kind { Ignore, KindGPS, KindText, KindHeader };
+	static const uint8_t m_kinds[16];    //!< Kind by high nibble of the block type
+
+	int block();
+
+	unsigned char m_block[6];
+	int m_last;                          //!< seq of the first half in m_block, -1 if none
+	unsigned char m_textWork[TextSize];
+	uint8_t m_textBlocks;                //!< bit per text block received
+	unsigned char m_headerWork[HeaderSize];
+	int m_headerLen;
+	char m_lineWork[MaxLine];
+	int m_lineLen;
+	char m_text[TextSize + 1];
+	char m_line[MaxLine];
+	unsigned char m_header[HeaderSize];
+};
+
+#endif /* SLOWDATA_H_ */
@@ -0,0 +1,472 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "synth.h"
+#include "mbelib_parms.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const float Pi = 3.14159265358979f;
+static const double TwoPi = 6.283185307179586;
+
+// rising half from sample 56, falling half up to sample 104, rounded out to blocks of 4
+const int MBESynth::Start[3] = { 56, 0, 0 };
+const int MBESynth::End[3] = { MBESynth::N, 108, MBESynth::N };
+
+struct SynthTables
+{
+	float ws[2 * MBESynth::N + 1];     //!< synthesis window, ws[n + N] is the falling half
+	int16_t wsq[2 * MBESynth::N + 1];  //!< same in Q14
+	int16_t cos[4096];                 //!< one turn of cosine in Q14
+
+	SynthTables()
+	{
+		// ws(n) of the IMBE standard: 1 up to |n| = 55, then down to 0 at |n| = 105
+		for(int i = 0; i <= 2 * MBESynth::N; ++i){
+			int n = abs(i - MBESynth::N);
+			ws[i] = (n <= 55) ? 1.0f : (n < 105) ? (float)(105 - n) / 50.0f : 0.0f;
+			wsq[i] = (int16_t)lrintf(ws[i] * 16384.0f);
+		}
+		for(int i = 0; i < 4096; ++i){
+			cos[i] = (int16_t)lrint(::cos(TwoPi * i / 4096) * 16384.0);
+		}
+	}
+};
+
+static const SynthTables tables;
+
+MBESynth::MBESynth(Mode mode) :
+	m_mode(mode),
+	m_libc_random(false),
+	m_seed(0x2545f491),
+	m_scale(1.0f)
+{
+}
+
+const char *MBESynth::modeName(Mode mode)
+{
+	static const char *names[] = { "mbelib", "float", "fixed" };
+	return names[mode];
+}
+
+bool MBESynth::parseMode(const char *name, Mode *mode)
+{
+	for(int m = Mbelib; m <= Fixed; ++m){
+		if(!strcmp(name, modeName((Mode)m))){
+			*mode = (Mode)m;
+			return true;
+		}
+	}
+	return false;
+}
+
+float MBESynth::random()
+{
+	if(m_libc_random){
+		return (float)rand() / (float)RAND_MAX;
+	}
+	m_seed ^= m_seed << 13;
+	m_seed ^= m_seed >> 17;
+	m_seed ^= m_seed << 5;
+	return (float)(m_seed >> 8) * (1.0f / 16777216.0f);
+}
+
+float MBESynth::randomPhase()
+{
+	return random() * (2.0f * Pi) - Pi;
+}
+
+/** The per sample noise added to a multisine above 2.7 kHz, drawn uvquality times per sample as mbelib does */
+void MBESynth::noise(float *sum, float level, int uvquality)
+{
+	for(int n = 0; n < N; ++n){
+		float s = 0.0f;
+		for(int i = 0; i < uvquality; ++i){
+			s += random();
+		}
+		sum[n] = s * level;
+	}
+}
+
+#if defined(__SSE2__)
+/** cos of 4 arguments within +-1000 rad: reduced to +-pi/2 by a multiple of pi, then a degree 12 Taylor polynomial */
+static inline __m128 cos4(__m128 x)
+{
+	const __m128i k = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.318309886f)));
+	const __m128 kf = _mm_cvtepi32_ps(k);
+	// pi in two parts, the first with 8 significant bits so k * part is exact
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(kf, _mm_set1_ps(3.140625f)));
+	r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(9.67653589793e-4f)));
+
+	const __m128 r2 = _mm_mul_ps(r, r);
+	__m128 p = _mm_set1_ps(2.08767570e-9f);
+	p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(-2.75573192e-7f));
+	p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(2.48015873e-5f));
+	p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(-1.38888889e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(4.16666667e-2f));
+	p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(-0.5f));
+	p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(1.0f));
+
+	// cos(r + k pi) = (-1)^k cos(r)
+	return _mm_xor_ps(p, _mm_castsi128_ps(_mm_slli_epi32(k, 31)));
+}
+#else
+static inline float cos1(float x)
+{
+	const float k = nearbyintf(x * 0.318309886f);
+	float r = x - k * 3.140625f;
+	r -= k * 9.67653589793e-4f;
+
+	const float r2 = r * r;
+	float p = 2.08767570e-9f;
+	p = p * r2 - 2.75573192e-7f;
+	p = p * r2 + 2.48015873e-5f;
+	p = p * r2 - 1.38888889e-3f;
+	p = p * r2 + 4.16666667e-2f;
+	p = p * r2 - 0.5f;
+	p = p * r2 + 1.0f;
+	return ((int)k & 1) ? -p : p;
+}
+#endif
+
+/** acc[n] += a cos(w n + phi) for n0 <= n < n1, both multiples of 4 */
+void MBESynth::oscFloat(float *acc, int n0, int n1, float w, float phi, float a)
+{
+#if defined(__SSE2__)
+	const __m128 vw = _mm_set1_ps(w);
+	const __m128 vphi = _mm_set1_ps(phi);
+	const __m128 va = _mm_set1_ps(a);
+	const __m128 four = _mm_set1_ps(4.0f);
+	__m128 vn = _mm_setr_ps((float)n0, (float)(n0 + 1), (float)(n0 + 2), (float)(n0 + 3));
+
+	for(int n = n0; n < n1; n += 4){
+		const __m128 x = _mm_add_ps(_mm_mul_ps(vw, vn), vphi);
+		_mm_store_ps(acc + n, _mm_add_ps(_mm_load_ps(acc + n), _mm_mul_ps(va, cos4(x))));
+		vn = _mm_add_ps(vn, four);
+	}
+#else
+	for(int n = n0; n < n1; ++n){
+		acc[n] += a * cos1(w * (float)n + phi);
+	}
+#endif
+}
+
+/** acc[n] += (a + da n) cos(phi + w n + c n^2) over the whole frame */
+void MBESynth::chirpFloat(float *acc, float w, float phi, float c, float a, float da)
+{
+#if defined(__SSE2__)
+	const __m128 vw = _mm_set1_ps(w);
+	const __m128 vphi = _mm_set1_ps(phi);
+	const __m128 vc = _mm_set1_ps(c);
+	const __m128 va = _mm_set1_ps(a);
+	const __m128 vda = _mm_set1_ps(da);
+	const __m128 four = _mm_set1_ps(4.0f);
+	__m128 vn = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+	for(int n = 0; n < N; n += 4){
+		const __m128 x = _mm_add_ps(_mm_add_ps(vphi, _mm_mul_ps(vw, vn)), _mm_mul_ps(vc, _mm_mul_ps(vn, vn)));
+		const __m128 amp = _mm_add_ps(va, _mm_mul_ps(vda, vn));
+		_mm_store_ps(acc + n, _mm_add_ps(_mm_load_ps(acc + n), _mm_mul_ps(amp, cos4(x))));
+		vn = _mm_add_ps(vn, four);
+	}
+#else
+	for(int n = 0; n < N; ++n){
+		const float fn = (float)n;
+		acc[n] += (a + da * fn) * cos1(phi + w * fn + c * fn * fn);
+	}
+#endif
+}
+
+/** A phase in radians as a fraction of a turn in 32 bits */
+uint32_t MBESynth::toPhase(double x)
+{
+	x -= TwoPi * floor(x / TwoPi);
+	return (uint32_t)(int64_t)llrint(x * (4294967296.0 / TwoPi));
+}
+
+/** A phase brought within +-pi, so the float oscillators only see small arguments */
+float MBESynth::wrap(double x)
+{
+	return (float)(x - TwoPi * nearbyint(x / TwoPi));
+}
+
+/** acc[n] += a cos(phase) in Q14 for n0 <= n < n1, phase stepping by inc */
+void MBESynth::oscFixed(int32_t *acc, int n0, int n1, uint32_t phase, uint32_t inc, int32_t a)
+{
+	phase += inc * (uint32_t)n0;
+	for(int n = n0; n < n1; ++n){
+		acc[n] += (a * tables.cos[phase >> 20]) >> 14;
+		phase += inc;
+	}
+}
+
+void MBESynth::osc(Env env, float w, double phi, float a)
+{
+	if(a == 0.0f){
+		return;
+	}
+	if(m_mode == Fixed){
+		oscFixed(m_iacc[env], Start[env], End[env], toPhase(phi), toPhase(w), (int32_t)lrintf(a * m_scale));
+	}
+	else{
+		oscFloat(m_acc[env], Start[env], End[env], w, wrap(phi), a);
+	}
+}
+
+void MBESynth::chirp(float w, double phi, float c, float a, float da)
+{
+	if(m_mode == Fixed){
+		// second order phase accumulator, amplitude with 15 more fractional bits
+		uint32_t phase = toPhase(phi);
+		uint32_t inc = toPhase((double)w + c);
+		const uint32_t inc2 = toPhase(2.0 * c);
+		int32_t amp = (int32_t)lrintf(a * m_scale * 32768.0f);
+		const int32_t damp = (int32_t)lrintf(da * m_scale * 32768.0f);
+		int32_t *acc = m_iacc[Direct];
+
+		for(int n = 0; n < N; ++n){
+			acc[n] += ((amp >> 15) * tables.cos[phase >> 20]) >> 14;
+			phase += inc;
+			inc += inc2;
+			amp += damp;
+		}
+	}
+	else{
+		chirpFloat(m_acc[Direct], w, wrap(phi), c, a, da);
+	}
+}
+
+void MBESynth::addNoise(Env env, const float *sum, float a)
+{
+	if(m_mode == Fixed){
+		const float s = a * m_scale;
+		for(int n = Start[env]; n < End[env]; ++n){
+			m_iacc[env][n] += (int32_t)lrintf(sum[n] * s);
+		}
+	}
+	else{
+		for(int n = Start[env]; n < End[env]; ++n){
+			m_acc[env][n] += sum[n] * a;
+		}
+	}
+}
+
+/** Window the rising and falling sums and add the rest */
+void MBESynth::output(float *out)
+{
+	if(m_mode == Fixed){
+		const float s = 1.0f / m_scale;
+		for(int n = 0; n < N; ++n){
+			const int64_t v = ((int64_t)tables.wsq[n] * m_iacc[Rise][n] + (int64_t)tables.wsq[n + N] * m_iacc[Fall][n]) >> 14;
+			out[n] = (float)(v + m_iacc[Direct][n]) * s;
+		}
+	}
+	else{
+		for(int n = 0; n < N; ++n){
+			out[n] = tables.ws[n] * m_acc[Rise][n] + tables.ws[n + N] * m_acc[Fall][n] + m_acc[Direct][n];
+		}
+	}
+}
+
+void MBESynth::synthesize(float *out, mbe_parms *cur, mbe_parms *prev, int uvquality)
+{
+	// rounded from double as mbelib does, harmonics can fall exactly on it
+	const float uvthreshold = (float)((2700.0 * (TwoPi / 2.0)) / 4000.0);
+	const float uvsine = 1.3591409f * 2.71828183f;
+	const float uvrand = 2.0f;
+	int maxl;
+
+	if((uvquality < 1) || (uvquality > MaxQuality)){
+		uvquality = 3;
+	}
+	const float qfactor = (uvquality == 1) ? 1.0f / 2.71828183f : logf((float)uvquality) / (float)uvquality;
+	const float uvstep = 1.0f / (float)uvquality;
+	const float uvoffset = (uvstep * (float)(uvquality - 1)) / 2.0f;
+	const float uvgain = uvsine * qfactor;
+	float rphase[MaxQuality], rphase2[MaxQuality];
+
+	int numUv = 0;
+	for(int l = 1; l <= cur->L; ++l){
+		if(cur->Vl[l] == 0){
+			numUv++;
+		}
+	}
+
+	const float cw0 = cur->w0;
+	const float pw0 = prev->w0;
+
+	// eq 128 and 129, the shorter frame is padded with silent voiced bands
+	if(cur->L > prev->L){
+		maxl = cur->L;
+		for(int l = prev->L + 1; l <= maxl; ++l){
+			prev->Ml[l] = 0.0f;
+			prev->Vl[l] = 1;
+		}
+	}
+	else{
+		maxl = prev->L;
+		for(int l = cur->L + 1; l <= maxl; ++l){
+			cur->Ml[l] = 0.0f;
+			cur->Vl[l] = 1;
+		}
+	}
+
+	for(int l = 1; l <= 56; ++l){
+		cur->PSIl[l] = prev->PSIl[l] + ((pw0 + cw0) * ((float)(l * N) / 2.0f));
+		if(l <= (int)(cur->L / 4)){
+			cur->PHIl[l] = cur->PSIl[l];
+		}
+		else{
+			cur->PHIl[l] = cur->PSIl[l] + ((numUv * randomPhase()) / cur->L);
+		}
+	}
+
+	float mmax = 0.0f;
+	for(int l = 1; l <= maxl; ++l){
+		mmax = fmaxf(mmax, fmaxf(fabsf(cur->Ml[l]), fabsf(prev->Ml[l])));
+	}
+	// the loudest band is 2^15 in fixed point, with its multisine and noise each band stays below 2^19
+	m_scale = (mmax > 0.0f) ? 32768.0f / mmax : 1.0f;
+	memset(m_acc, 0, sizeof(m_acc));
+	memset(m_iacc, 0, sizeof(m_iacc));
+
+	for(int l = 1; l <= maxl; ++l){
+		const float cw0l = cw0 * (float)l;
+		const float pw0l = pw0 * (float)l;
+		const int cv = cur->Vl[l];
+		const int pv = prev->Vl[l];
+
+		if((cv == 0) && (pv == 1)){
+			// eq 131, the previous harmonic fades out under a multisine of the current band
+			for(int i = 0; i < uvquality; ++i){
+				rphase[i] = randomPhase();
+			}
+			if(cw0l > uvthreshold){
+				noise(m_noise[0], (cw0l - uvthreshold) * uvrand, uvquality);
+				addNoise(Rise, m_noise[0], uvgain * cur->Ml[l]);
+			}
+			osc(Fall, pw0l, prev->PHIl[l], prev->Ml[l]);
+			for(int i = 0; i < uvquality; ++i){
+				osc(Rise, cw0 * ((float)l + ((float)i * uvstep) - uvoffset), rphase[i], uvgain * cur->Ml[l]);
+			}
+		}
+		else if((cv == 1) && (pv == 0)){
+			// eq 132, the current harmonic fades in, over a multisine of the previous band
+			for(int i = 0; i < uvquality; ++i){
+				rphase[i] = randomPhase();
+			}
+			if(pw0l > uvthreshold){
+				noise(m_noise[0], (pw0l - uvthreshold) * uvrand, uvquality);
+				addNoise(Fall, m_noise[0], uvgain * prev->Ml[l]);
+			}
+			// cos(cw0l (n - N) + PHIl), with the constant part of the phase folded in
+			osc(Rise, cw0l, (double)cur->PHIl[l] - (double)cw0l * N, cur->Ml[l]);
+			for(int i = 0; i < uvquality; ++i){
+				osc(Fall, pw0 * ((float)l + ((float)i * uvstep) - uvoffset), rphase[i], uvgain * prev->Ml[l]);
+			}
+		}
+		else if((cv == 1) || (pv == 1)){
+			if((l >= 8) || (fabsf(cw0 - pw0) >= (0.1f * cw0))){
+				// eq 133, cross fade of the two harmonics
+				osc(Fall, pw0l, prev->PHIl[l], prev->Ml[l]);
+				osc(Rise, cw0l, (double)cur->PHIl[l] - (double)cw0l * N, cur->Ml[l]);
+			}
+			else{
+				// eq 134-138, one harmonic swept in frequency and amplitude across the frame
+				const float deltaphil = cur->PHIl[l] - prev->PHIl[l] - (((pw0 + cw0) * (float)(l * N)) / 2.0f);
+				const float deltawl = (1.0f / (float)N) * (deltaphil - (2.0f * Pi * (int)((deltaphil + Pi) / (Pi * 2.0f))));
+				chirp(pw0l + deltawl, prev->PHIl[l], ((cw0 - pw0) * (float)l) / (float)(2 * N),
+					  prev->Ml[l], (cur->Ml[l] - prev->Ml[l]) / (float)N);
+			}
+		}
+		else{
+			// both unvoiced, two multisines
+			for(int i = 0; i < uvquality; ++i){
+				rphase[i] = randomPhase();
+			}
+			for(int i = 0; i < uvquality; ++i){
+				rphase2[i] = randomPhase();
+			}
+			if((pw0l > uvthreshold) || (cw0l > uvthreshold)){
+				// drawn interleaved per sample, previous band first
+				for(int n = 0; n < N; ++n){
+					float s = 0.0f;
+					for(int i = 0; (i < uvquality) && (pw0l > uvthreshold); ++i){
+						s += random();
+					}
+					m_noise[0][n] = s * (pw0l - uvthreshold) * uvrand;
+					s = 0.0f;
+					for(int i = 0; (i < uvquality) && (cw0l > uvthreshold); ++i){
+						s += random();
+					}
+					m_noise[1][n] = s * (cw0l - uvthreshold) * uvrand;
+				}
+				addNoise(Fall, m_noise[0], uvgain * prev->Ml[l]);
+				addNoise(Rise, m_noise[1], uvgain * cur->Ml[l]);
+			}
+			for(int i = 0; i < uvquality; ++i){
+				osc(Fall, pw0 * ((float)l + ((float)i * uvstep) - uvoffset), rphase[i], uvgain * prev->Ml[l]);
+				osc(Rise, cw0 * ((float)l + ((float)i * uvstep) - uvoffset), rphase2[i], uvgain * cur->Ml[l]);
+			}
+		}
+	}
+
+	output(out);
+
+	// the next frame only needs PHIl - PSIl and the phases modulo one turn
+	for(int l = 1; l <= 56; ++l){
+		const double k = TwoPi * nearbyint(cur->PSIl[l] / TwoPi);
+		cur->PSIl[l] = (float)(cur->PSIl[l] - k);
+		cur->PHIl[l] = (float)(cur->PHIl[l] - k);
+	}
+}
+
+SynthCheck::SynthCheck() :
+	m_signal(0.0),
+	m_noise(0.0),
+	m_worst(1000.0),
+	m_frames(0),
+	m_seed(1)
+{
+}
+
+void SynthCheck::add(const float *ref, const float *out, int n)
+{
+	double signal = 0.0, noise = 0.0;
+
+	for(int i = 0; i < n; ++i){
+		const double e = (double)out[i] - ref[i];
+		signal += (double)ref[i] * ref[i];
+		noise += e * e;
+	}
+	m_signal += signal;
+	m_noise += noise;
+	++m_frames;
+	if((noise > 0.0) && (signal > 1e-6 * n)){
+		m_worst = fmin(m_worst, 10.0 * log10(signal / noise));
+	}
+}
+
+double SynthCheck::getSNR() const
+{
+	return (m_noise > 0.0) ? 10.0 * log10(m_signal / m_noise) : 1000.0;
+}
@@ -0,0 +1,125 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SYNTH_H_
+#define SYNTH_H_
+
+#include <stdint.h>
+
+struct mbe_parameters;
+
+/**
+ * Speech synthesis of AMBE and IMBE frames, in place of mbelib's
+ * mbe_synthesizeSpeechf() which calls cosf() once per harmonic per sample.
+ * mbelib still corrects and dequantizes each frame; only the harmonic
+ * oscillator bank that turns the model parameters into 160 samples is done
+ * here, with the same equations and the same order of random draws.
+ *
+ * Each harmonic is one or more oscillators whose amplitude follows the
+ * rising (current frame) or falling (previous frame) half of the synthesis
+ * window, so an oscillator is only run where its half is not zero and the
+ * window is applied once per sample to each sum.  Float runs four samples
+ * at a time through a polynomial cosine, Fixed steps 32 bit phase
+ * accumulators through a Q14 table; the noise, window and output of both
+ * are float.
+ *
+ * The harmonic phases are kept within one turn between frames, where
+ * mbelib lets them grow for the length of a stream and loses precision.
+ */
+class MBESynth
+{
+public:
+	enum Mode { Mbelib, Float, Fixed };
+
+	static const int N = 160;          //!< samples per frame
+	static const int MaxQuality = 8;   //!< highest uvquality, multisine oscillators per unvoiced band
+
+	explicit MBESynth(Mode mode = Float);
+
+	void setMode(Mode mode) { m_mode = mode; }
+	Mode getMode() const { return m_mode; }
+	/** Draw random phases and noise with rand() as mbelib does, so both give the same output after srand() */
+	void setLibcRandom(bool libc) { m_libc_random = libc; }
+
+	/** Same contract as mbe_synthesizeSpeechf(): N samples from prev to cur, phases of cur updated */
+	void synthesize(float *out, mbe_parameters *cur, mbe_parameters *prev, int uvquality);
+
+	static const char *modeName(Mode mode);
+	/** "mbelib", "float" or "fixed", false if none matches */
+	static bool parseMode(const char *name, Mode *mode);
+
+private:
+	enum Env { Rise, Fall, Direct };
+
+	float random();
+	float randomPhase();
+	void noise(float *sum, float level, int uvquality);
+
+	void osc(Env env, float w, double phi, float a);
+	void chirp(float w, double phi, float c, float a, float da);
+	void addNoise(Env env, const float *sum, float a);
+	void output(float *out);
+
+	static void oscFloat(float *acc, int n0, int n1, float w, float phi, float a);
+	static void chirpFloat(float *acc, float w, float phi, float c, float a, float da);
+	static void oscFixed(int32_t *acc, int n0, int n1, uint32_t phase, uint32_t inc, int32_t a);
+	static uint32_t toPhase(double x);
+	static float wrap(double x);
+
+	static const int Start[3];         //!< first and last sample where each envelope is not zero
+	static const int End[3];
+
+	Mode m_mode;
+	bool m_libc_random;
+	uint32_t m_seed;
+	float m_scale;                     //!< fixed point amplitude units per unit of Ml
+	alignas(16) float m_acc[3][N];     //!< sum per Env before the window
+	alignas(16) int32_t m_iacc[3][N];
+	float m_noise[2][N];
+};
+
+/**
+ * Compares frames of an in tree synthesis with mbelib's for the same
+ * parameters, and keeps the signal to noise ratio over all frames and the
+ * worst single frame.
+ */
+class SynthCheck
+{
+public:
+	SynthCheck();
+
+	/** ref from mbelib, out from MBESynth, n samples */
+	void add(const float *ref, const float *out, int n);
+	/** Seed for srand() before each of the two syntheses of one frame */
+	unsigned int nextSeed() { return ++m_seed; }
+
+	double getSNR() const;
+	double getWorstSNR() const { return m_worst; }
+	uint64_t getFrames() const { return m_frames; }
+	bool passed() const { return getSNR() >= MinSNR; }
+
+	static constexpr double MinSNR = 40.0;   //!< dB
+
+private:
+	double m_signal;
+	double m_noise;
+	double m_worst;
+	uint64_t m_frames;
+	unsigned int m_seed;
+};
+
+#endif /* SYNTH_H_ */
@@ -0,0 +1,352 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "voicestreams.h"
+#include "resampler.h"
+#include "latency.h"
+#include "metrics.h"
+
+VoiceStreams::VoiceStreams(Vocoder vocoder) :
+	m_vocoder(vocoder),
+	m_output(Priority),
+	m_latency(nullptr),
+	m_rate(8000),
+	m_stereo(false),
+	m_adaptive(false),
+	m_trim(0.0),
+	m_skip_repeats(false),
+	m_synth(MBESynth::Mbelib),
+	m_synth_check(nullptr),
+	m_active(0),
+	m_selected(-1),
+	m_seq(0),
+	m_nb_jobs(0)
+{
+	m_resampler[0] = nullptr;
+	m_resampler[1] = nullptr;
+	for(int i = 0; i < 256; ++i){
+		m_route[i] = Mixer::Both;
+		m_gain[i] = 1.0f;
+	}
+	for(int s = 0; s < MaxStreams; ++s){
+		Stream &st = m_streams[s];
+		st.active = false;
+		st.decoder = nullptr;
+		st.audio = nullptr;
+	}
+}
+
+VoiceStreams::~VoiceStreams()
+{
+	for(int s = 0; s < MaxStreams; ++s){
+		delete m_streams[s].decoder;
+		delete[] m_streams[s].audio;
+	}
+	delete m_resampler[0];
+	delete m_resampler[1];
+}
+
+void VoiceStreams::setFormat(int rate, bool stereo, bool adaptive)
+{
+	m_rate = rate;
+	m_stereo = stereo;
+	m_adaptive = adaptive;
+	m_mixer.setStereo(stereo);
+
+	for(int c = 0; c < 2; ++c){
+		delete m_resampler[c];
+		m_resampler[c] = nullptr;
+		if(((rate != 8000) || adaptive) && ((c == 0) || stereo)){
+			m_resampler[c] = new Resampler(rate, 8000, adaptive);
+			m_resampler[c]->setTrim(m_trim);
+		}
+	}
+}
+
+void VoiceStreams::setTrim(double ppm)
+{
+	m_trim = ppm;
+
+	for(int c = 0; c < 2; ++c){
+		if(m_resampler[c]){
+			m_resampler[c]->setTrim(ppm);
+		}
+	}
+}
+
+void VoiceStreams::setRoute(uint8_t slot, int route, float gain)
+{
+	m_route[slot] = route & Mixer::Both;
+	m_gain[slot] = gain;
+}
+
+void VoiceStreams::setSynthesis(MBESynth::Mode mode, SynthCheck *check)
+{
+	m_synth = mode;
+	m_synth_check = check;
+	for(int s = 0; s < MaxStreams; ++s){
+		if(m_streams[s].decoder){
+			m_streams[s].decoder->setSynthesis(mode, check);
+		}
+	}
+}
+
+void VoiceStreams::setSkipRepeats(bool skip)
+{
+	m_skip_repeats = skip;
+	for(int s = 0; s < MaxStreams; ++s){
+		if(m_streams[s].decoder){
+			m_streams[s].decoder->setSkipRepeats(skip);
+		}
+	}
+}
+
+int VoiceStreams::find(uint32_t id, uint8_t slot) const
+{
+	for(int s = 0; s < MaxStreams; ++s){
+		const Stream &st = m_streams[s];
+		if(st.active && (st.id == id) && (st.slot == slot)){
+			return s;
+		}
+	}
+
+	return -1;
+}
+
+int VoiceStreams::find(uint32_t id) const
+{
+	for(int s = 0; s < MaxStreams; ++s){
+		if(m_streams[s].active && (m_streams[s].id == id)){
+			return s;
+		}
+	}
+
+	return -1;
+}
+
+int VoiceStreams::open(uint32_t id, uint8_t slot, uint32_t src, uint32_t dst, int priority, bool *opened)
+{
+	int s = find(id, slot);
+	int free = -1;
+
+	if(opened){
+		*opened = false;
+	}
+	if(s >= 0){
+		return s;
+	}
+	for(int i = 0; i < MaxStreams; ++i){
+		if(!m_streams[i].active){
+			// prefer a slot that already has a decoder
+			if((free < 0) || (!m_streams[free].decoder && m_streams[i].decoder)){
+				free = i;
+			}
+			if(m_streams[i].decoder){
+				break;
+			}
+		}
+	}
+	if(free < 0){
+		return -1;
+	}
+
+	Stream &st = m_streams[free];
+
+	if(!st.decoder){
+		st.audio = new short[Mixer::FrameSamples];
+		st.decoder = new MBEDecoder();
+		st.decoder->setAudioBuffer(st.audio, Mixer::FrameSamples);
+		st.decoder->setSkipRepeats(m_skip_repeats);
+		st.decoder->setSynthesis(m_synth, m_synth_check);
+	}
+	else{
+		st.decoder->initMbeParms();
+	}
+
+	st.active = true;
+	st.ended = false;
+	st.id = id;
+	st.slot = slot;
+	st.src = src;
+	st.dst = dst;
+	st.priority = priority;
+	st.gain = m_gain[slot];
+	st.route = m_route[slot];
+	st.seq = m_seq++;
+	st.idle = 0;
+	st.queue.clear();
+	++m_active;
+	if(opened){
+		*opened = true;
+	}
+	return free;
+}
+
+void VoiceStreams::push(int s, const unsigned char *frame)
+{
+	Stream &st = m_streams[s];
+
+	if(!st.queue.push(frame)){
+		Metrics::inc(Metrics::FramesDropped);
+		if(m_latency){
+			m_latency->discarded(s);
+		}
+	}
+	st.idle = 0;
+
+	if(m_latency){
+		m_latency->enqueued(s);
+	}
+}
+
+void VoiceStreams::end(int s)
+{
+	m_streams[s].ended = true;
+}
+
+void VoiceStreams::close(int s)
+{
+	Stream &st = m_streams[s];
+
+	if(!st.queue.isEmpty()){
+		Metrics::add(Metrics::FramesDropped, st.queue.size());
+	}
+	if(m_latency){
+		m_latency->clear(s);
+	}
+
+	st.active = false;
+	st.queue.clear();
+	--m_active;
+}
+
+void VoiceStreams::clear()
+{
+	for(int s = 0; s < MaxStreams; ++s){
+		if(m_streams[s].active){
+			close(s);
+		}
+	}
+
+	m_selected = -1;
+}
+
+int VoiceStreams::getQueued() const
+{
+	int n = 0;
+
+	for(int s = 0; s < MaxStreams; ++s){
+		if(m_streams[s].active){
+			n += m_streams[s].queue.size();
+		}
+	}
+
+	return n;
+}
+
+void VoiceStreams::pop(Stream &st, int s, bool decodeIt)
+{
+	const unsigned char *frame = st.queue.pop();
+
+	if(!decodeIt){
+		if(m_latency){
+			m_latency->discarded(s);
+		}
+		return;
+	}
+	if(m_latency){
+		m_latency->decodeStart(s);
+	}
+
+	// the frame stays in the queue's slot until the next push
+	MBEDecoder::Job &job = m_jobs[m_nb_jobs];
+	job.decoder = st.decoder;
+	job.format = (m_vocoder == DMR) ? MBEDecoder::DMR : MBEDecoder::DStar;
+	job.frame = frame;
+	m_job_stream[m_nb_jobs++] = s;
+}
+
+int VoiceStreams::process(short *out)
+{
+	int best = -1;
+	int nbOut = 0;
+	int nb;
+	short *audio;
+
+	for(int s = 0; s < MaxStreams; ++s){
+		Stream &st = m_streams[s];
+		if(!st.active){
+			continue;
+		}
+		if(st.queue.isEmpty()){
+			if(st.ended || (++st.idle > IdleTicks)){
+				close(s);
+			}
+			continue;
+		}
+		if((best < 0) || (st.priority < m_streams[best].priority) ||
+			((st.priority == m_streams[best].priority) && (st.seq < m_streams[best].seq))){
+			best = s;
+		}
+	}
+
+	m_selected = best;
+
+	if(best < 0){
+		return 0;
+	}
+	m_mixer.clear();
+	m_nb_jobs = 0;
+
+	for(int s = 0; s < MaxStreams; ++s){
+		Stream &st = m_streams[s];
+		if(!st.active || st.queue.isEmpty()){
+			continue;
+		}
+		pop(st, s, (m_output == Mix) || (s == best));
+	}
+
+	MBEDecoder::processBatch(m_jobs, m_nb_jobs);
+	if(m_latency){
+		m_latency->decodeEnd();
+	}
+
+	for(int j = 0; j < m_nb_jobs; ++j){
+		const Stream &st = m_streams[m_job_stream[j]];
+		audio = st.decoder->getAudio(nb);
+		m_mixer.add(audio, nb, st.gain, st.route);
+	}
+
+	if(m_resampler[0]){
+		for(int c = 0; c < (m_stereo ? 2 : 1); ++c){
+			nbOut = m_resampler[c]->process(m_mixer.getChannel(c), Mixer::FrameSamples, m_resampled[c]);
+		}
+		Mixer::toS16(m_resampled[0], m_stereo ? m_resampled[1] : nullptr, nbOut, out);
+	}
+	else{
+		nbOut = Mixer::FrameSamples;
+		Mixer::toS16(m_mixer.getChannel(0), m_stereo ? m_mixer.getChannel(1) : nullptr, nbOut, out);
+	}
+
+	for(int s = 0; s < MaxStreams; ++s){
+		if(m_streams[s].active && m_streams[s].ended && m_streams[s].queue.isEmpty()){
+			close(s);
+		}
+	}
+
+	return nbOut;
+}
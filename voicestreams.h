@@ -0,0 +1,140 @@
+/*
+    Copyright (C) 2019 Doug McLain
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef VOICESTREAMS_H_
+#define VOICESTREAMS_H_
+
+#include <stdint.h>
+#include "mbe.h"
+#include "framequeue.h"
+#include "mixer.h"
+
+class LatencyTracker;
+class Resampler;
+
+/**
+ * Concurrent AMBE voice streams of one reflector connection.
+ *
+ * Streams are kept in a fixed table keyed by stream ID and slot (the DMR
+ * timeslot, or the D-STAR module), each with its own frame queue and its
+ * own MBEDecoder so interleaved streams never share vocoder state.  Every
+ * process() call decodes the next frame of the streams in one
+ * MBEDecoder::processBatch() and either mixes them, or plays only the one
+ * with the best priority and drops the frames of the others.  Decoders stay at 8 kHz mono: the Mixer applies the gain
+ * and channel route of each stream's slot, then one resampler per output
+ * channel brings the mix to the sound card rate.
+ *
+ * A stream closes once its terminator was seen and its queue drained, or
+ * after IdleTicks process() calls without a frame.
+ */
+class VoiceStreams
+{
+public:
+	enum Vocoder { DStar, DMR };
+	enum Output { Mix, Priority };
+
+	static const int MaxStreams = 64;
+	static const int MaxQueue = 50;            //!< frames held per stream, 1 s of speech
+	static const int IdleTicks = 25;
+	static const int FrameSize = 9;
+
+	struct Stream
+	{
+		bool active;
+		bool ended;                            //!< terminator seen, close when drained
+		uint32_t id;
+		uint8_t slot;
+		uint32_t src;
+		uint32_t dst;
+		int priority;                          //!< lowest is heard in Priority mode
+		float gain;
+		int route;                             //!< Mixer::Route
+		uint64_t seq;                          //!< open order, the older stream wins a tie
+		int idle;
+		FrameQueue<FrameSize, MaxQueue> queue;
+		MBEDecoder *decoder;                   //!< kept for reuse when the stream closes
+		short *audio;
+	};
+
+	explicit VoiceStreams(Vocoder vocoder);
+	~VoiceStreams();
+
+	/** Output rate and channels of every decoder, out of process() holds 2 * MBEDecoder::MaxFrameSamples */
+	void setFormat(int rate, bool stereo, bool adaptive = false);
+	/** Play ppm faster than the nominal rate, slower if negative, after setFormat(rate, stereo, true) */
+	void setTrim(double ppm);
+	/** Gain and Mixer::Route of the streams opened on a DMR slot or D-STAR module from now on */
+	void setRoute(uint8_t slot, int route, float gain = 1.0f);
+	void setOutput(Output output) { m_output = output; }
+	Output getOutput() const { return m_output; }
+	/** See MBEDecoder::setSkipRepeats() */
+	void setSkipRepeats(bool skip);
+	/** See MBEDecoder::setSynthesis() */
+	void setSynthesis(MBESynth::Mode mode, SynthCheck *check = nullptr);
+	/** Frames of stream s are stamped on queue s of the tracker */
+	void setLatencyTracker(LatencyTracker *latency) { m_latency = latency; }
+
+	/** Index of the stream, opened if new, or -1 when all MaxStreams are in use */
+	int open(uint32_t id, uint8_t slot, uint32_t src, uint32_t dst, int priority, bool *opened = nullptr);
+	/** Index of an open stream, -1 if there is none */
+	int find(uint32_t id, uint8_t slot) const;
+	/** Same on any slot, for voice frames that only carry the stream ID */
+	int find(uint32_t id) const;
+	/** Queue one frame, the oldest one is dropped when the queue is full */
+	void push(int s, const unsigned char *frame);
+	void end(int s);
+	void clear();
+
+	/** Decode one frame per stream into out, returns samples per channel */
+	int process(short *out);
+
+	const Stream &getStream(int s) const { return m_streams[s]; }
+	int getActive() const { return m_active; }
+	int getQueued() const;
+	/** Stream heard in the last process() call, -1 if none */
+	int getSelected() const { return m_selected; }
+
+private:
+	void close(int s);
+	/** Take the next frame of stream s off its queue, into the batch when decodeIt */
+	void pop(Stream &st, int s, bool decodeIt);
+
+	Vocoder m_vocoder;
+	Output m_output;
+	LatencyTracker *m_latency;
+	int m_rate;
+	bool m_stereo;
+	bool m_adaptive;
+	double m_trim;
+	bool m_skip_repeats;
+	MBESynth::Mode m_synth;
+	SynthCheck *m_synth_check;
+	int m_active;
+	int m_selected;
+	uint64_t m_seq;
+	Stream m_streams[MaxStreams];
+	MBEDecoder::Job m_jobs[MaxStreams];        //!< frames decoded in this process() call
+	int m_job_stream[MaxStreams];
+	int m_nb_jobs;
+	int m_route[256];
+	float m_gain[256];
+	Mixer m_mixer;
+	Resampler *m_resampler[2];                 //!< per output channel, nullptr at a plain 8 kHz
+	float m_resampled[2][MBEDecoder::MaxFrameSamples];
+};
+
+#endif /* VOICESTREAMS_H_ */
@@ -16,56 +16,57 @@
 
 #include "ysf.h"
 #include "mbefec.h"
+#include "metrics.h"
 
 #define DEBUG
 
-const int DSDYSF::m_fichInterleave[100] = {
-        0, 5, 10, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60, 65, 70, 75, 80, 85, 90, 95,
-        1, 6, 11, 16, 21, 26, 31, 36, 41, 46, 51, 56, 61, 66, 71, 76, 81, 86, 91, 96,
-        2, 7, 12, 17, 22, 27, 32, 37, 42, 47, 52, 57, 62, 67, 72, 77, 82, 87, 92, 97,
-        3, 8, 13, 18, 23, 28, 33, 38, 43, 48, 53, 58, 63, 68, 73, 78, 83, 88, 93, 98,
-        4, 9, 14, 19, 24, 29, 34, 39, 44, 49, 54, 59, 64, 69, 74, 79, 84, 89, 94, 99,
+/*
+ * Gather tables: entry i is the frame symbol (0..459, FICH first) that lands in
+ * position i of the de-interleaved raw buffer. They are the inverse of the FICH
+ * (5x20) and DCH (9x20) interleave matrices folded with the channel layout of
+ * each frame type so a whole frame is de-interleaved without per symbol branching.
+ */
+const unsigned short DSDYSF::m_fichGather[100] = {
+         0, 20, 40, 60, 80,  1, 21, 41, 61, 81,  2, 22, 42, 62, 82,  3, 23, 43, 63, 83,
+         4, 24, 44, 64, 84,  5, 25, 45, 65, 85,  6, 26, 46, 66, 86,  7, 27, 47, 67, 87,
+         8, 28, 48, 68, 88,  9, 29, 49, 69, 89, 10, 30, 50, 70, 90, 11, 31, 51, 71, 91,
+        12, 32, 52, 72, 92, 13, 33, 53, 73, 93, 14, 34, 54, 74, 94, 15, 35, 55, 75, 95,
+        16, 36, 56, 76, 96, 17, 37, 57, 77, 97, 18, 38, 58, 78, 98, 19, 39, 59, 79, 99
+};
+
+// Header and V/D type 1: DCH(n) interleaved with DCH2(n) or VCH(n) in blocks of 36 symbols. Add 36 for DCH2.
+const unsigned short DSDYSF::m_dchGather[180] = {
+        100, 120, 176, 196, 252, 272, 328, 348, 404, 101, 121, 177, 197, 253, 273, 329, 349, 405, 102, 122,
+        178, 198, 254, 274, 330, 350, 406, 103, 123, 179, 199, 255, 275, 331, 351, 407, 104, 124, 180, 200,
+        256, 276, 332, 388, 408, 105, 125, 181, 201, 257, 277, 333, 389, 409, 106, 126, 182, 202, 258, 278,
+        334, 390, 410, 107, 127, 183, 203, 259, 279, 335, 391, 411, 108, 128, 184, 204, 260, 316, 336, 392,
+        412, 109, 129, 185, 205, 261, 317, 337, 393, 413, 110, 130, 186, 206, 262, 318, 338, 394, 414, 111,
+        131, 187, 207, 263, 319, 339, 395, 415, 112, 132, 188, 244, 264, 320, 340, 396, 416, 113, 133, 189,
+        245, 265, 321, 341, 397, 417, 114, 134, 190, 246, 266, 322, 342, 398, 418, 115, 135, 191, 247, 267,
+        323, 343, 399, 419, 116, 172, 192, 248, 268, 324, 344, 400, 420, 117, 173, 193, 249, 269, 325, 345,
+        401, 421, 118, 174, 194, 250, 270, 326, 346, 402, 422, 119, 175, 195, 251, 271, 327, 347, 403, 423
 };
 
-const int DSDYSF::m_dchInterleave[180] = {
-        0,   9,  18,  27,  36,  45,  54,  63,  72,  81,  90,  99, 108, 117, 126, 135, 144, 153, 162, 171,
-        1,  10,  19,  28,  37,  46,  55,  64,  73,  82,  91, 100, 109, 118, 127, 136, 145, 154, 163, 172,
-        2,  11,  20,  29,  38,  47,  56,  65,  74,  83,  92, 101, 110, 119, 128, 137, 146, 155, 164, 173,
-        3,  12,  21,  30,  39,  48,  57,  66,  75,  84,  93, 102, 111, 120, 129, 138, 147, 156, 165, 174,
-        4,  13,  22,  31,  40,  49,  58,  67,  76,  85,  94, 103, 112, 121, 130, 139, 148, 157, 166, 175,
-        5,  14,  23,  32,  41,  50,  59,  68,  77,  86,  95, 104, 113, 122, 131, 140, 149, 158, 167, 176,
-        6,  15,  24,  33,  42,  51,  60,  69,  78,  87,  96, 105, 114, 123, 132, 141, 150, 159, 168, 177,
-        7,  16,  25,  34,  43,  52,  61,  70,  79,  88,  97, 106, 115, 124, 133, 142, 151, 160, 169, 178,
-        8,  17,  26,  35,  44,  53,  62,  71,  80,  89,  98, 107, 116, 125, 134, 143, 152, 161, 170, 179
+// V/D type 2: DCH(n) is the first 20 of each 72 symbols block, de-interleaved into the FICH buffer
+const unsigned short DSDYSF::m_vd2DchGather[100] = {
+        100, 172, 244, 316, 388, 101, 173, 245, 317, 389, 102, 174, 246, 318, 390, 103, 175, 247, 319, 391,
+        104, 176, 248, 320, 392, 105, 177, 249, 321, 393, 106, 178, 250, 322, 394, 107, 179, 251, 323, 395,
+        108, 180, 252, 324, 396, 109, 181, 253, 325, 397, 110, 182, 254, 326, 398, 111, 183, 255, 327, 399,
+        112, 184, 256, 328, 400, 113, 185, 257, 329, 401, 114, 186, 258, 330, 402, 115, 187, 259, 331, 403,
+        116, 188, 260, 332, 404, 117, 189, 261, 333, 405, 118, 190, 262, 334, 406, 119, 191, 263, 335, 407
 };
 
-const int DSDYSF::m_vd2Interleave[104] = {
-         0,  26,  52,  78,
-         1,  27,  53,  79,
-         2,  28,  54,  80,
-         3,  29,  55,  81,
-         4,  30,  56,  82,
-         5,  31,  57,  83,
-         6,  32,  58,  84,
-         7,  33,  59,  85,
-         8,  34,  60,  86,
-         9,  35,  61,  87,
-        10,  36,  62,  88,
-        11,  37,  63,  89,
-        12,  38,  64,  90,
-        13,  39,  65,  91,
-        14,  40,  66,  92,
-        15,  41,  67,  93,
-        16,  42,  68,  94,
-        17,  43,  69,  95,
-        18,  44,  70,  96,
-        19,  45,  71,  97,
-        20,  46,  72,  98,
-        21,  47,  73,  99,
-        22,  48,  74, 100,
-        23,  49,  75, 101,
-        24,  50,  76, 102,
-        25,  51,  77, 103
+// VFR sub header: CSD3 DCH is contiguous
+const unsigned short DSDYSF::m_vfrDchGather[180] = {
+        100, 120, 140, 160, 180, 200, 220, 240, 260, 101, 121, 141, 161, 181, 201, 221, 241, 261, 102, 122,
+        142, 162, 182, 202, 222, 242, 262, 103, 123, 143, 163, 183, 203, 223, 243, 263, 104, 124, 144, 164,
+        184, 204, 224, 244, 264, 105, 125, 145, 165, 185, 205, 225, 245, 265, 106, 126, 146, 166, 186, 206,
+        226, 246, 266, 107, 127, 147, 167, 187, 207, 227, 247, 267, 108, 128, 148, 168, 188, 208, 228, 248,
+        268, 109, 129, 149, 169, 189, 209, 229, 249, 269, 110, 130, 150, 170, 190, 210, 230, 250, 270, 111,
+        131, 151, 171, 191, 211, 231, 251, 271, 112, 132, 152, 172, 192, 212, 232, 252, 272, 113, 133, 153,
+        173, 193, 213, 233, 253, 273, 114, 134, 154, 174, 194, 214, 234, 254, 274, 115, 135, 155, 175, 195,
+        215, 235, 255, 275, 116, 136, 156, 176, 196, 216, 236, 256, 276, 117, 137, 157, 177, 197, 217, 237,
+        257, 277, 118, 138, 158, 178, 198, 218, 238, 258, 278, 119, 139, 159, 179, 199, 219, 239, 259, 279
 };
 
 /**
@@ -78,55 +79,21 @@ const int DSDYSF::m_vd2DVSIInterleave[49] = {
 };
 
 /*
- * AMBE 3600x2450 interleave schedule
+ * AMBE 3600x2450 interleave schedule: VCH bit i (dibit MSB first) goes to
+ * ambe_fr[0][0] + m_ambeScatter[i]. Formerly the rW/rX (bit 1) and rY/rZ (bit 0) walk.
  */
-// bit 1
-// frame index
-const int DSDYSF::rW[36] = {
-  0, 1, 0, 1, 0, 1,
-  0, 1, 0, 1, 0, 1,
-  0, 1, 0, 1, 0, 1,
-  0, 1, 0, 1, 0, 2,
-  0, 2, 0, 2, 0, 2,
-  0, 2, 0, 2, 0, 2
-};
-
-// bit index
-const int DSDYSF::rX[36] = {
-  23, 10, 22, 9, 21, 8,
-  20, 7, 19, 6, 18, 5,
-  17, 4, 16, 3, 15, 2,
-  14, 1, 13, 0, 12, 10,
-  11, 9, 10, 8, 9, 7,
-  8, 6, 7, 5, 6, 4
-};
-
-// bit 0
-// frame index
-const int DSDYSF::rY[36] = {
-  0, 2, 0, 2, 0, 2,
-  0, 2, 0, 3, 0, 3,
-  1, 3, 1, 3, 1, 3,
-  1, 3, 1, 3, 1, 3,
-  1, 3, 1, 3, 1, 3,
-  1, 3, 1, 3, 1, 3
-};
-
-// bit index
-const int DSDYSF::rZ[36] = {
-  5, 3, 4, 2, 3, 1,
-  2, 0, 1, 13, 0, 12,
-  22, 11, 21, 10, 20, 9,
-  19, 8, 18, 7, 17, 6,
-  16, 5, 15, 4, 14, 3,
-  13, 2, 12, 1, 11, 0
+const unsigned short DSDYSF::m_ambeScatter[72] = {
+        23,  5, 34, 51, 22,  4, 33, 50, 21,  3, 32, 49, 20,  2, 31, 48, 19,  1, 30, 85, 18,  0, 29, 84,
+        17, 46, 28, 83, 16, 45, 27, 82, 15, 44, 26, 81, 14, 43, 25, 80, 13, 42, 24, 79, 12, 41, 58, 78,
+        11, 40, 57, 77, 10, 39, 56, 76,  9, 38, 55, 75,  8, 37, 54, 74,  7, 36, 53, 73,  6, 35, 52, 72
 };
 
 /*
  * IMBE 7200x4400 interleave schedule
  *
- * this is the reverse of the original Sylvain Munaut's matrix because we are de-scrambling on the fly:
- *         const uint8_t permutation[144] = {
+ * entry i is the VCH bit (dibit MSB first) that lands in position i of the
+ * de-interleaved frame. This is Sylvain Munaut's permutation matrix:
+ *
  *            0,   7,  12,  19,  24,  31,  36,  43,  48,  55,  60,  67, // [  0 -  11] yellow message
  *           72,  79,  84,  91,  96, 103, 108, 115, 120, 127, 132,      // [ 12 -  22] yellow FEC
  *          139,   1,   6,  13,  18,  25,  30,  37,  42,  49,  54,  61, // [ 23 -  34] orange message
@@ -142,24 +109,14 @@ const int DSDYSF::rZ[36] = {
  *           17,  22,  29,  34,  41,  46,  53,  58,  65,  70,  77,      // [122 - 132] green message
  *           82,  89,  94, 101,                                         // [133 - 136] green FEC
  *          106, 113, 118, 125, 130, 137, 142,                          // [137 - 143] unprotected
- *      };
- *
- * the interleaving logic is more obvious on the reversed matrix:
- *
  */
-const int DSDYSF::m_vfrInterleave[144] = {
-         0,  24,  48,  72,  96, 120,  25,   1,  73,  49, 121,  97,
-         2,  26,  50,  74,  98, 122,  27,   3,  75,  51, 123,  99,
-         4,  28,  52,  76, 100, 124,  29,   5,  77,  53, 125, 101,
-         6,  30,  54,  78, 102, 126,  31,   7,  79,  55, 127, 103,
-         8,  32,  56,  80, 104, 128,  33,   9,  81,  57, 129, 105,
-        10,  34,  58,  82, 106, 130,  35,  11,  83,  59, 131, 107,
-        12,  36,  60,  84, 108, 132,  37,  13,  85,  61, 133, 109,
-        14,  38,  62,  86, 110, 134,  39,  15,  87,  63, 135, 111,
-        16,  40,  64,  88, 112, 136,  41,  17,  89,  65, 137, 113,
-        18,  42,  66,  90, 114, 138,  43,  19,  91,  67, 139, 115,
-        20,  44,  68,  92, 116, 140,  45,  21,  93,  69, 141, 117,
-        22,  46,  70,  94, 118, 142,  47,  23,  95,  71, 143, 119
+const unsigned short DSDYSF::m_vfrGather[144] = {
+          0,   7,  12,  19,  24,  31,  36,  43,  48,  55,  60,  67,  72,  79,  84,  91,  96, 103, 108, 115, 120, 127, 132, 139,
+          1,   6,  13,  18,  25,  30,  37,  42,  49,  54,  61,  66,  73,  78,  85,  90,  97, 102, 109, 114, 121, 126, 133, 138,
+          2,   9,  14,  21,  26,  33,  38,  45,  50,  57,  62,  69,  74,  81,  86,  93,  98, 105, 110, 117, 122, 129, 134, 141,
+          3,   8,  15,  20,  27,  32,  39,  44,  51,  56,  63,  68,  75,  80,  87,  92,  99, 104, 111, 116, 123, 128, 135, 140,
+          4,  11,  16,  23,  28,  35,  40,  47,  52,  59,  64,  71,  76,  83,  88,  95, 100, 107, 112, 119, 124, 131, 136, 143,
+          5,  10,  17,  22,  29,  34,  41,  46,  53,  58,  65,  70,  77,  82,  89,  94, 101, 106, 113, 118, 125, 130, 137, 142
 };
 
 const char * DSDYSF::ysfChannelTypeText[4] = {
@@ -184,9 +141,8 @@ const char * DSDYSF::ysfCallModeText[4] = {
 };
 
 
-DSDYSF::DSDYSF() :
-		//m_mbeDecoder(mbeDecoder),
-        m_symbolIndex(0),
+DSDYSF::DSDYSF(MBEDecoder *mbeDecoder) :
+		m_mbeDecoder(mbeDecoder),
         m_fichError(FICHNoError),
         m_viterbiFICH(2, Viterbi::Poly25y, true),
 		m_crc(CRC::PolyCCITT16, 16, 0x0, 0xffff),
@@ -199,7 +155,6 @@ DSDYSF::DSDYSF() :
     memset(m_dch1Bits, 0, 180);
     memset(m_dch2Raw, 0, 180);
     memset(m_dch2Bits, 0, 180);
-    memset(m_vd2BitsRaw, 0, 104);
     memset(m_vd2MBEBits, 0, 72);
     memset(m_vfrBitsRaw, 0, 144);
     memset(m_vfrBits, 0, 88);
@@ -214,13 +169,8 @@ DSDYSF::DSDYSF() :
     memset(m_rem4, 0, 5+1);
     memset(m_destId, 0, 5+1);
     memset(m_srcId, 0, 5+1);
+    memset(ambe_fr, 0, sizeof(ambe_fr));
 
-	m_mbeDecoder = new MBEDecoder();
-
-    w = 0;
-    x = 0;
-    y = 0;
-    z = 0;
     m_vfrStart = false;
 }
 
@@ -228,228 +178,133 @@ DSDYSF::~DSDYSF()
 {
 }
 
-void DSDYSF::init()
-{
-    m_symbolIndex = 0;
-}
-
-DSDYSF::FICH DSDYSF::process_ysf(unsigned char *d)
+DSDYSF::FICH DSDYSF::process_ysf(const unsigned char *d)
 {
-	unsigned char dibit;
-	for(int i = 0; i < 115; ++i){
-		for(int j = 0; j < 8; j+=2){
-			dibit = (3 & (d[i] >> (6 - j)));
-			process(dibit);
-		}
-	}
-	return m_fich;
-	//std::cerr << "process_ysf() finished" << std::endl;
-}
+    unsigned char dibits[460]; // 100 FICH + 5x72 payload symbols, sync already stripped
 
-void DSDYSF::process(unsigned char dibit) // just pass the frames for now
-{
-    if (m_symbolIndex < 100)
+    for (int i = 0; i < 115; i++)
     {
-        processFICH(m_symbolIndex, dibit);
-
-        if (m_symbolIndex == 100 -1)
-        {
-			//std::cerr << "m_fich.getFrameInformation() == << " << m_symbolIndex << ":" << m_fich.getFrameInformation() << std::endl;
-            if (m_fich.getFrameInformation() == FICommunication)
-            {
-                switch (m_fich.getDataType())
-                {
-                case DTVoiceData1:
-					//m_dsdDecoder->m_voice1On = true;
-                    break;
-                case DTVoiceData2:
-					//m_dsdDecoder->m_voice1On = true;
-                    break;
-                case DTVoiceFullRate:
-					//m_dsdDecoder->m_voice1On = true;
-                    break;
-                default:
-					//m_dsdDecoder->m_voice1On = false;
-                    break;
-                }
-            }
-            else
-            {
-				//m_dsdDecoder->m_voice1On = false;
-            }
-        }
+        dibits[4*i]   = (d[i] >> 6) & 3;
+        dibits[4*i+1] = (d[i] >> 4) & 3;
+        dibits[4*i+2] = (d[i] >> 2) & 3;
+        dibits[4*i+3] = d[i] & 3;
     }
-    else if (m_symbolIndex < 480 - 20) // frame is 480 dibits and sync is 20 dibits
+
+    processFICH(dibits);
+
+    switch (m_fich.getFrameInformation())
     {
-		//std::cerr << "m_fich.getFrameInformation() == << " << m_symbolIndex << ":" << m_fich.getFrameInformation() << std::endl;
-        switch (m_fich.getFrameInformation())
+    case FIHeader:
+    case FITerminator:
+        processHeader(dibits);
+        break;
+    case FICommunication:
+        switch (m_fich.getDataType())
         {
-        case FIHeader:
-        case FITerminator:
-            processHeader(m_symbolIndex - 100, dibit);
+        case DTVoiceData1:
+            processVD1(dibits);
+            break;
+        case DTVoiceData2:
+            processVD2(dibits);
             break;
-        case FICommunication:
-            {
-                switch (m_fich.getDataType())
-                {
-                case DTVoiceData1:
-					//m_dsdDecoder->m_mbeRate = DSDDecoder::DSDMBERate3600x2450;
-                    processVD1(m_symbolIndex - 100, dibit);
-                    break;
-                case DTVoiceData2:
-					//m_dsdDecoder->m_mbeRate = DSDDecoder::DSDMBERate2450;
-					processVD2(m_symbolIndex - 100, dibit);
-                    break;
-                case DTVoiceFullRate:
-					//m_dsdDecoder->m_mbeRate = DSDDecoder::DSDMBERate4400;
-                    processVFR(m_symbolIndex - 100, dibit);
-                    break;
-                default:
-                    break;
-                }
-            }
+        case DTVoiceFullRate:
+            processVFR(dibits);
             break;
         default:
             break;
         }
+        break;
+    default:
+        break;
     }
-    else
-    {
-		//m_dsdDecoder->m_voice1On = false;
-		//m_dsdDecoder->resetFrameSync(); // end
-		//std::cerr << "m_fich.getFrameInformation() == " << m_symbolIndex << ":" << m_fich.getFrameInformation() << std::endl;
 
-        return;
-    }
-	if(m_symbolIndex == 459){
-		m_symbolIndex = 0;
-		//std::cerr << "m_symbolIndex reset " << std::endl;
-	}
-	else{
-		m_symbolIndex++;
-	}
+    return m_fich;
 }
 
-void DSDYSF::processFICH(int symbolIndex, unsigned char dibit)
+void DSDYSF::processFICH(const unsigned char *dibits)
 {
-    m_fichRaw[m_fichInterleave[symbolIndex]] = dibit;
-
-    if (symbolIndex == 100-1)
+    for (int i = 0; i < 100; i++)
     {
-        m_viterbiFICH.decodeFromSymbols(m_fichGolay, m_fichRaw, 100, 0);
-        int i = 0;
+        m_fichRaw[i] = dibits[m_fichGather[i]];
+    }
 
-        for (; i < 4; i++)
+    m_viterbiFICH.decodeFromSymbols(m_fichGolay, m_fichRaw, 100, 0);
+    int i = 0;
+
+    for (; i < 4; i++)
+    {
+        if (m_golay_24_12.decode(&m_fichGolay[24*i]))
+        {
+            memcpy(&m_fichBits[12*i], &m_fichGolay[24*i], 12);
+        }
+        else
         {
-            if (m_golay_24_12.decode(&m_fichGolay[24*i]))
-            {
-                memcpy(&m_fichBits[12*i], &m_fichGolay[24*i], 12);
-            }
-            else
-            {
 #ifdef DEBUG
-                std::cerr << "DSDYSF::processFICH: Golay KO #" << i << std::endl;
+            std::cerr << "DSDYSF::processFICH: Golay KO #" << i << std::endl;
 #endif
-                m_fichError = FICHErrorGolay;
-                break;
-            }
+            m_fichError = FICHErrorGolay;
+            Metrics::inc(Metrics::FECFailedGolay2412);
+            break;
         }
+    }
 
-        if (i == 4) // decoding OK
+    if (i == 4) // decoding OK
+    {
+        if (checkCRC16(m_fichBits, 4))
         {
-            if (checkCRC16(m_fichBits, 4))
-            {
-                m_fich.setBytes(m_fichBits);
+            m_fich.setBytes(m_fichBits);
 #ifdef DEBUG
-				std::cerr << "DSDYSF::processFICH: CRC OK: " << m_fich << std::endl;
+            std::cerr << "DSDYSF::processFICH: CRC OK: " << m_fich << std::endl;
 #endif
-                m_fichError = FICHNoError;
-            }
-            else
-            {
+            m_fichError = FICHNoError;
+        }
+        else
+        {
 #ifdef DEBUG
-                std::cerr << "DSDYSF::processFICH: CRC KO" << std::endl;
+            std::cerr << "DSDYSF::processFICH: CRC KO" << std::endl;
 #endif
-                m_fichError = FICHErrorCRC;
-            }
+            m_fichError = FICHErrorCRC;
+            Metrics::inc(Metrics::CRCFailedYSFFICH);
         }
     }
 }
 
-void DSDYSF::processHeader(int symbolIndex, unsigned char dibit)
+void DSDYSF::processHeader(const unsigned char *dibits)
 {
-    if (symbolIndex < 36)         // DCH1(0)
-    {
-        m_dch1Raw[m_dchInterleave[symbolIndex]] = dibit;
-    }
-    else if (symbolIndex < 2*36)  // DCH2(0)
-    {
-        m_dch2Raw[m_dchInterleave[symbolIndex - 36]] = dibit;
-    }
-    else if (symbolIndex < 3*36)  // DCH1(1)
-    {
-        m_dch1Raw[m_dchInterleave[symbolIndex - 36]] = dibit;
-    }
-    else if (symbolIndex < 4*36)  // DCH2(1)
-    {
-        m_dch2Raw[m_dchInterleave[symbolIndex - 2*36]] = dibit;
-    }
-    else if (symbolIndex < 5*36)  // DCH1(2)
-    {
-        m_dch1Raw[m_dchInterleave[symbolIndex - 2*36]] = dibit;
-    }
-    else if (symbolIndex < 6*36)  // DCH2(2)
-    {
-        m_dch2Raw[m_dchInterleave[symbolIndex - 3*36]] = dibit;
-    }
-    else if (symbolIndex < 7*36)  // DCH1(3)
+    for (int i = 0; i < 180; i++)
     {
-        m_dch1Raw[m_dchInterleave[symbolIndex - 3*36]] = dibit;
+        m_dch1Raw[i] = dibits[m_dchGather[i]];
+        m_dch2Raw[i] = dibits[m_dchGather[i] + 36];
     }
-    else if (symbolIndex < 8*36)  // DCH2(3)
+
+    unsigned char bytes[22];
+
+    m_viterbiFICH.decodeFromSymbols(m_dch1Bits, m_dch1Raw, 180, 0);
+    m_viterbiFICH.decodeFromSymbols(m_dch2Bits, m_dch2Raw, 180, 0);
+
+    if (checkCRC16(m_dch1Bits, 20, bytes)) // CSD1
     {
-        m_dch2Raw[m_dchInterleave[symbolIndex - 4*36]] = dibit;
+        processCSD1(bytes);
     }
-    else if (symbolIndex < 9*36)  // DCH1(4)
+    else
     {
-        m_dch1Raw[m_dchInterleave[symbolIndex - 4*36]] = dibit;
+#ifdef DEBUG
+        std::cerr << "DSDYSF::processHeader: DCH1 CRC KO" << std::endl;
+#endif
     }
-    else if (symbolIndex < 10*36) // DCH2(4)
+
+    if (checkCRC16(m_dch2Bits, 20, bytes)) // CSD2
     {
-        m_dch2Raw[m_dchInterleave[symbolIndex - 5*36]] = dibit;
+        processCSD2(bytes);
     }
-
-    if (symbolIndex == 360 - 1) // final
+    else
     {
-        unsigned char bytes[22];
-
-        m_viterbiFICH.decodeFromSymbols(m_dch1Bits, m_dch1Raw, 180, 0);
-        m_viterbiFICH.decodeFromSymbols(m_dch2Bits, m_dch2Raw, 180, 0);
-
-        if (checkCRC16(m_dch1Bits, 20, bytes)) // CSD1
-        {
-            processCSD1(bytes);
-        }
-        else
-        {
-#ifdef DEBUG
-            std::cerr << "DSDYSF::processHeader: DCH1 CRC KO" << std::endl;
-#endif
-        }
-
-        if (checkCRC16(m_dch2Bits, 20, bytes)) // CSD2
-        {
-            processCSD2(bytes);
-        }
-        else
-        {
 #ifdef DEBUG
-            std::cerr << "DSDYSF::processHeader: DCH2 CRC KO" << std::endl;
+        std::cerr << "DSDYSF::processHeader: DCH2 CRC KO" << std::endl;
 #endif
-        }
-
-        m_vfrStart = m_fich.getFrameInformation() == FIHeader;
     }
+
+    m_vfrStart = m_fich.getFrameInformation() == FIHeader;
 }
 
 void DSDYSF::processCSD1(unsigned char *dchBytes)
@@ -511,385 +366,272 @@ void DSDYSF::processCSD3_2(unsigned char *dchBytes)
 #endif
 }
 
-void DSDYSF::processVD1(int symbolIndex, unsigned char dibit)
+void DSDYSF::processVD1(const unsigned char *dibits)
 {
-    if (symbolIndex < 36)         // DCH(0)
-    {
-        m_dch1Raw[m_dchInterleave[symbolIndex]] = dibit;
-    }
-    else if (symbolIndex < 2*36)  // VCH(0)
-    {
-        processAMBE(symbolIndex - 36, dibit);
-    }
-    else if (symbolIndex < 3*36)  // DCH(1)
-    {
-        m_dch1Raw[m_dchInterleave[symbolIndex - 36]] = dibit;
-    }
-    else if (symbolIndex < 4*36)  // VCH(1)
-    {
-        processAMBE(symbolIndex - 3*36, dibit);
-    }
-    else if (symbolIndex < 5*36)  // DCH(2)
-    {
-        m_dch1Raw[m_dchInterleave[symbolIndex - 2*36]] = dibit;
-    }
-    else if (symbolIndex < 6*36)  // VCH(2)
-    {
-        processAMBE(symbolIndex - 5*36, dibit);
-    }
-    else if (symbolIndex < 7*36)  // DCH(3)
+    for (int i = 0; i < 180; i++) // DCH(0..4)
     {
-        m_dch1Raw[m_dchInterleave[symbolIndex - 3*36]] = dibit;
+        m_dch1Raw[i] = dibits[m_dchGather[i]];
     }
-    else if (symbolIndex < 8*36)  // VCH(3)
-    {
-        processAMBE(symbolIndex - 7*36, dibit);
-    }
-    else if (symbolIndex < 9*36)  // DCH(4)
-    {
-        m_dch1Raw[m_dchInterleave[symbolIndex - 4*36]] = dibit;
 
-        if (symbolIndex == 9*36 - 1)
+    unsigned char bytes[22];
+
+    m_viterbiFICH.decodeFromSymbols(m_dch1Bits, m_dch1Raw, 180, 0);
+
+    if (checkCRC16(m_dch1Bits, 20, bytes)) // CSD
+    {
+        switch (m_fich.getFrameNumber())
         {
-            unsigned char bytes[22];
-
-            m_viterbiFICH.decodeFromSymbols(m_dch1Bits, m_dch1Raw, 180, 0);
-
-            if (checkCRC16(m_dch1Bits, 20, bytes)) // CSD
-            {
-                switch (m_fich.getFrameNumber())
-                {
-                case 0: // CSD1
-                    processCSD1(bytes);
-                    break;
-                case 1: // CSD2
-                    processCSD2(bytes);
-                    break;
-                case 2: // CSD3
-                    processCSD3_1(bytes);
-                    processCSD3_2(&bytes[10]);
-                    break;
-                default:
-                    break;
-                }
-            }
+        case 0: // CSD1
+            processCSD1(bytes);
+            break;
+        case 1: // CSD2
+            processCSD2(bytes);
+            break;
+        case 2: // CSD3
+            processCSD3_1(bytes);
+            processCSD3_2(&bytes[10]);
+            break;
+        default:
+            break;
         }
     }
-    else if (symbolIndex < 10*36) // VCH(4)
+
+    for (int i = 0; i < 5; i++) // VCH(0..4)
     {
-        processAMBE(symbolIndex - 9*36, dibit);
+        processAMBE(&dibits[100 + 72*i + 36]);
     }
 }
 
-void DSDYSF::processVD2(int symbolIndex, unsigned char dibit)
+void DSDYSF::processVD2(const unsigned char *dibits)
 {
-    if (symbolIndex < 20) // DCH(0) - reuse FICH buffer
-    {
-        m_fichRaw[m_fichInterleave[symbolIndex]] = dibit;
-    }
-    else if (symbolIndex < 20 + 52) // VCH(0) and VeCH(0)
-    {
-        processVD2Voice(symbolIndex - 20, dibit);
-    }
-    else if (symbolIndex < 2*20 + 52) // DCH(1)
-    {
-        m_fichRaw[m_fichInterleave[symbolIndex - 52]] = dibit;
-    }
-    else if (symbolIndex < 2*20 + 2*52) // VCH(1) and VeCH(1)
+    for (int i = 0; i < 100; i++) // DCH(0..4) - reuse FICH buffer
     {
-        processVD2Voice(symbolIndex - (2*20 + 52), dibit);
+        m_fichRaw[i] = dibits[m_vd2DchGather[i]];
     }
-    else if (symbolIndex < 3*20 + 2*52) // DCH(2)
-    {
-        m_fichRaw[m_fichInterleave[symbolIndex - 2*52]] = dibit;
-    }
-    else if (symbolIndex < 3*20 + 3*52) // VCH(2) and VeCH(2)
-    {
-        processVD2Voice(symbolIndex - (3*20 + 2*52), dibit);
-    }
-    else if (symbolIndex < 4*20 + 3*52) // DCH(3)
-    {
-        m_fichRaw[m_fichInterleave[symbolIndex - 3*52]] = dibit;
-    }
-    else if (symbolIndex < 4*20 + 4*52) // VCH(3) and VeCH(3)
-    {
-        processVD2Voice(symbolIndex - (4*20 + 3*52), dibit);
-    }
-    else if (symbolIndex < 5*20 + 4*52) // DCH(4)
-    {
-        m_fichRaw[m_fichInterleave[symbolIndex - 4*52]] = dibit;
 
-        if (symbolIndex == (5*20 + 4*52) - 1) // Final DCH
-        {
-            unsigned char bytes[12];
+    unsigned char bytes[12];
 
-            m_viterbiFICH.decodeFromSymbols(m_fichGolay, m_fichRaw, 100, 0); // reuse FICH
+    m_viterbiFICH.decodeFromSymbols(m_fichGolay, m_fichRaw, 100, 0); // reuse FICH
 
-            if (checkCRC16(m_fichGolay, 10, bytes))
-            {
-                switch (m_fich.getFrameNumber())
-                {
-                case 0:
-                    memcpy(m_dest, bytes, 10);
-                    m_dest[10] = '\0';
+    if (checkCRC16(m_fichGolay, 10, bytes))
+    {
+        switch (m_fich.getFrameNumber())
+        {
+        case 0:
+            memcpy(m_dest, bytes, 10);
+            m_dest[10] = '\0';
 #ifdef DEBUG
-					std::cerr << "DSDYSF::processVD2: Dest: " << m_dest << std::endl;
+			std::cerr << "DSDYSF::processVD2: Dest: " << m_dest << std::endl;
 #endif
-                    break;
-                case 1:
-                    memcpy(m_src, bytes, 10);
-                    m_src[10] = '\0';
+            break;
+        case 1:
+            memcpy(m_src, bytes, 10);
+            m_src[10] = '\0';
 #ifdef DEBUG
-					std::cerr << "DSDYSF::processVD2:  Src: " << m_src << std::endl;
+			std::cerr << "DSDYSF::processVD2:  Src: " << m_src << std::endl;
 #endif
-                    break;
-                case 2:
-                    memcpy(m_downlink, bytes, 10);
-                    m_downlink[10] = '\0';
+            break;
+        case 2:
+            memcpy(m_downlink, bytes, 10);
+            m_downlink[10] = '\0';
 #ifdef DEBUG
-					std::cerr << "DSDYSF::processVD2:  D/L: " << m_downlink << std::endl;
+			std::cerr << "DSDYSF::processVD2:  D/L: " << m_downlink << std::endl;
 #endif
-                    break;
-                case 3:
-                    memcpy(m_uplink, bytes, 10);
-                    m_uplink[10] = '\0';
+            break;
+        case 3:
+            memcpy(m_uplink, bytes, 10);
+            m_uplink[10] = '\0';
 #ifdef DEBUG
-					std::cerr << "DSDYSF::processVD2:  U/L: " << m_uplink << std::endl;
+			std::cerr << "DSDYSF::processVD2:  U/L: " << m_uplink << std::endl;
 #endif
-                    break;
-                case 4:
-                    processCSD3_1(bytes);
-                    break;
-                case 5:
-                    processCSD3_2(bytes);
-                    break;
-				case 6:
-				case 7:
-					char mystery[11];
-					memcpy(mystery, bytes, 10);
-					mystery[10] = '\0';
+            break;
+        case 4:
+            processCSD3_1(bytes);
+            break;
+        case 5:
+            processCSD3_2(bytes);
+            break;
+		case 6:
+		case 7:
+			char mystery[11];
+			memcpy(mystery, bytes, 10);
+			mystery[10] = '\0';
 #ifdef DEBUG
-					std::cerr << "Mystery frame " << (int)m_fich.getFrameNumber()<< ":";
-					for(int i = 0; i < 10; ++i){
-						fprintf(stderr, "%02x ", (unsigned char)bytes[i]);
-					}
-					fprintf(stderr, "\n");
-					fflush(stderr);
+			std::cerr << "Mystery frame " << (int)m_fich.getFrameNumber()<< ":";
+			for(int i = 0; i < 10; ++i){
+				fprintf(stderr, "%02x ", (unsigned char)bytes[i]);
+			}
+			fprintf(stderr, "\n");
+			fflush(stderr);
 #endif
-					break;
-                default:
-                    break;
-                }
-            }
+			break;
+        default:
+            break;
         }
     }
-    else if (symbolIndex < 5*20 + 5*52) // DCH(4)
+
+    for (int i = 0; i < 5; i++) // VCH(0..4) and VeCH(0..4)
     {
-        processVD2Voice(symbolIndex - (5*20 + 4*52), dibit);
+        processVD2Voice(&dibits[100 + 72*i + 20]);
     }
 }
 
-void DSDYSF::processVD2Voice(int mbeIndex, unsigned char dibit)
+void DSDYSF::processVD2Voice(const unsigned char *vch)
 {
-    if (mbeIndex == 0) // init
-    {
-        w = rW;
-        x = rX;
-        y = rY;
-        z = rZ;
+    // de-interleave: the 26x4 matrix puts VCH bit 4i+j at raw bit 26j+i
+    uint64_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
 
-        memset(m_vd2BitsRaw, 0, 104);
-        memset(m_vd2MBEBits, 0, 72);
+    for (int i = 0; i < 26; i++)
+    {
+        r0 |= (uint64_t) (vch[2*i] >> 1) << i;
+        r1 |= (uint64_t) (vch[2*i] & 1) << i;
+        r2 |= (uint64_t) (vch[2*i+1] >> 1) << i;
+        r3 |= (uint64_t) (vch[2*i+1] & 1) << i;
     }
 
-    // de-interleave and de-whiten in one shot
-    unsigned int msbI = m_vd2Interleave[2*mbeIndex];
-    unsigned int lsbI = m_vd2Interleave[2*mbeIndex+1];
-    m_vd2BitsRaw[msbI] = ((dibit>>1) & 1) ^ m_pn.getBit(msbI);
-    m_vd2BitsRaw[lsbI] = (dibit & 1) ^ m_pn.getBit(lsbI);
+    // raw bits 0..63 and 64..103, de-whitened a word at a time
+    uint64_t lo = (r0 | (r1 << 26) | (r2 << 52)) ^ m_pn.getWord(0);
+    uint64_t hi = ((r2 >> 12) | (r3 << 14)) ^ m_pn.getWord(1);
 
-    if (mbeIndex == 52 - 1) // final
-    {
-        int nbOnes;
-        unsigned int bit;
-
-        if (m_vd2BitsRaw[103] != 0) {
+    if ((hi >> (103-64)) & 1) {
 #ifdef DEBUG
-            std::cerr << "DSDYSF::processVD2Voice: error bit 103" << std::endl;
+        std::cerr << "DSDYSF::processVD2Voice: error bit 103" << std::endl;
 #endif
-        }
+    }
 
-        for (int i = 0; i < 103; i++)
-        {
-            if (i < 81)
-            {
-                if (i%3 == 2)
-                {
-                    nbOnes = m_vd2BitsRaw[i-2] + m_vd2BitsRaw[i-1] + m_vd2BitsRaw[i];
-                    bit = nbOnes > 1 ? 1 : 0;
-                    m_vd2MBEBits[i/3] = bit;
-                    mbeIndex = m_vd2DVSIInterleave[i/3];
-                }
-            }
-            else if (i < 103)
-            {
-                m_vd2MBEBits[i-81+27] = m_vd2BitsRaw[i];
-                mbeIndex = m_vd2DVSIInterleave[i-81+27];
-            }
-        }
+    // majority vote on the 3 times repeated bits, lands on raw bits 3i
+    uint64_t lo1 = (lo >> 1) | (hi << 63), hi1 = hi >> 1;
+    uint64_t lo2 = (lo >> 2) | (hi << 62), hi2 = hi >> 2;
+    uint64_t voteLo = (lo & lo1) | (lo & lo2) | (lo1 & lo2);
+    uint64_t voteHi = (hi & hi1) | (hi & hi2) | (hi1 & hi2);
+
+    for (int i = 0; i < 22; i++)
+    {
+        m_vd2MBEBits[i] = (voteLo >> (3*i)) & 1;
+    }
+
+    for (int i = 22; i < 27; i++)
+    {
+        m_vd2MBEBits[i] = (voteHi >> (3*i - 64)) & 1;
+    }
 
-		m_mbeDecoder->processData((char *) m_vd2MBEBits);
+    for (int i = 0; i < 22; i++) // raw bits 81..102 are not repeated
+    {
+        m_vd2MBEBits[27+i] = (hi >> (81-64+i)) & 1;
     }
+
+	m_mbeDecoder->processData((char *) m_vd2MBEBits);
 }
 
-void DSDYSF::processVFR(int symbolIndex, unsigned char dibit)
+void DSDYSF::processVFR(const unsigned char *dibits)
 {
     if (m_vfrStart)
     {
-        processVFRSubHeader(symbolIndex, dibit);
+        processVFRSubHeader(dibits);
     }
     else
     {
-        processVFRFullIMBE(symbolIndex, dibit);
+        processVFRFullIMBE(dibits);
     }
 }
 
-void DSDYSF::processVFRSubHeader(int symbolIndex, unsigned char dibit)
+void DSDYSF::processVFRSubHeader(const unsigned char *dibits)
 {
-    if (symbolIndex < 5*36)
+    for (int i = 0; i < 180; i++)
     {
-        m_dch1Raw[m_dchInterleave[symbolIndex]] = dibit;
-
-        if (symbolIndex == 5*36 - 1)
-        {
-//            std::cerr << "DSDYSF::processVFRSubHeader: CSD3" << std::endl;
+        m_dch1Raw[i] = dibits[m_vfrDchGather[i]];
+    }
 
-            unsigned char bytes[22];
+    unsigned char bytes[22];
 
-            m_viterbiFICH.decodeFromSymbols(m_dch1Bits, m_dch1Raw, 180, 0);
+    m_viterbiFICH.decodeFromSymbols(m_dch1Bits, m_dch1Raw, 180, 0);
 
-            if (checkCRC16(m_dch1Bits, 20, bytes)) // CSD3
-            {
-                processCSD3_1(bytes);
-                processCSD3_2(&bytes[10]);
-            }
-        }
-    }
-    else if (symbolIndex < 6*36)
-    {
-        // reserved
-    }
-    else if (symbolIndex < 6*36 + 72) // VCH-3
+    if (checkCRC16(m_dch1Bits, 20, bytes)) // CSD3
     {
-        procesVFRFrame(symbolIndex - 6*36, dibit);
+        processCSD3_1(bytes);
+        processCSD3_2(&bytes[10]);
     }
-    else if (symbolIndex < 6*36 + 2*72) // VCH-4
-    {
-        procesVFRFrame(symbolIndex - (6*36 + 72), dibit);
 
-        if (symbolIndex == 6*36 + 2*72 - 1)
-        {
-            m_vfrStart = false;
-        }
-    }
+    // 36 reserved symbols
+    procesVFRFrame(&dibits[100 + 6*36]);      // VCH-3
+    procesVFRFrame(&dibits[100 + 6*36 + 72]); // VCH-4
+    m_vfrStart = false;
 }
 
-void DSDYSF::processVFRFullIMBE(int symbolIndex, unsigned char dibit)
+void DSDYSF::processVFRFullIMBE(const unsigned char *dibits)
 {
-    if (symbolIndex < 72) // VCH-0
-    {
-        procesVFRFrame(symbolIndex, dibit);
-    }
-    else if (symbolIndex < 2*72) // VCH-1
-    {
-        procesVFRFrame(symbolIndex - 72, dibit);
-    }
-    else if (symbolIndex < 3*72) // VCH-2
-    {
-        procesVFRFrame(symbolIndex - 2*72, dibit);
-    }
-    else if (symbolIndex < 4*72) // VCH-3
+    for (int i = 0; i < 5; i++) // VCH-0..4
     {
-        procesVFRFrame(symbolIndex - 3*72, dibit);
-    }
-    else if (symbolIndex < 5*72) // VCH-4
-    {
-        procesVFRFrame(symbolIndex - 4*72, dibit);
+        procesVFRFrame(&dibits[100 + 72*i]);
     }
 }
 
-void DSDYSF::processAMBE(int mbeIndex, unsigned char dibit)
+void DSDYSF::processAMBE(const unsigned char *vch)
 {
-	if (mbeIndex == 0) // init
+	char *fr = &ambe_fr[0][0];
+
+	for (int i = 0; i < 72; i++)
 	{
-	    w = rW;
-	    x = rX;
-	    y = rY;
-	    z = rZ;
+		fr[m_ambeScatter[i]] = getVCHBit(vch, i);
 	}
 
-	ambe_fr[*w][*x] = (1 & (dibit >> 1)); // bit 1
-	ambe_fr[*y][*z] = (1 & dibit);        // bit 0
-	w++;
-	x++;
-	y++;
-	z++;
+	m_mbeDecoder->process_frame(ambe_fr);
+}
 
-	if (mbeIndex == 36-1) // finalize
+void DSDYSF::procesVFRFrame(const unsigned char *vch)
+{
+	for (int i = 0; i < 144; i++)
 	{
-		m_mbeDecoder->process_frame(ambe_fr);
+		m_vfrBitsRaw[i] = getVCHBit(vch, m_vfrGather[i]);
 	}
-}
 
-void DSDYSF::procesVFRFrame(int mbeIndex, unsigned char dibit)
-{
-	m_vfrBitsRaw[m_vfrInterleave[2*mbeIndex]]     = (1 & (dibit >> 1)); // bit 1
-	m_vfrBitsRaw[m_vfrInterleave[2*mbeIndex + 1]] = (1 & dibit);        // bit 0
+    uint16_t seed = 0;
 
-	if (mbeIndex == 72-1) // finalize
-	{
-        uint16_t seed = 0;
+    for (uint16_t i = 0; i < 12; i++)
+    {
+        seed = (seed << 1) | m_vfrBitsRaw[i];
+    }
 
-        for (uint16_t i = 0; i < 12; i++)
-        {
-            seed = (seed << 1) | m_vfrBitsRaw[i];
-        }
+    scrambleVFR(m_vfrBitsRaw+23, m_vfrBitsRaw+23, 144-23-7, seed, 4);
 
-        scrambleVFR(m_vfrBitsRaw+23, m_vfrBitsRaw+23, 144-23-7, seed, 4);
+    int golayErrs = 0;
+    int hammingErrs = 0;
 
-        // u0
-        GolayMBE::mbe_golay2312(m_vfrBitsRaw, m_vfrBits);
+    // u0
+    golayErrs += GolayMBE::mbe_golay2312(m_vfrBitsRaw, m_vfrBits);
 //        memcpy(m_vfrBits, m_vfrBitsRaw, 12);
 
-        // u1
-        GolayMBE::mbe_golay2312(&m_vfrBitsRaw[23], &m_vfrBits[12]);
+    // u1
+    golayErrs += GolayMBE::mbe_golay2312(&m_vfrBitsRaw[23], &m_vfrBits[12]);
 //        memcpy(&m_vfrBits[12], &m_vfrBitsRaw[23], 12);
 
-        // u2
-        GolayMBE::mbe_golay2312(&m_vfrBitsRaw[46], &m_vfrBits[24]);
+    // u2
+    golayErrs += GolayMBE::mbe_golay2312(&m_vfrBitsRaw[46], &m_vfrBits[24]);
 //        memcpy(&m_vfrBits[24], &m_vfrBitsRaw[46], 12);
 
-        // u3
-        GolayMBE::mbe_golay2312(&m_vfrBitsRaw[69], &m_vfrBits[36]);
+    // u3
+    golayErrs += GolayMBE::mbe_golay2312(&m_vfrBitsRaw[69], &m_vfrBits[36]);
 //        memcpy(&m_vfrBits[36], &m_vfrBitsRaw[69], 12);
 
-        // u4
-        HammingMBE::mbe_hamming1511(&m_vfrBitsRaw[92], &m_vfrBits[48]);
+    // u4
+    hammingErrs += HammingMBE::mbe_hamming1511(&m_vfrBitsRaw[92], &m_vfrBits[48]);
 //        memcpy(&m_vfrBits[48], &m_vfrBitsRaw[92], 11);
 
-        // u5
-        HammingMBE::mbe_hamming1511(&m_vfrBitsRaw[107], &m_vfrBits[59]);
+    // u5
+    hammingErrs += HammingMBE::mbe_hamming1511(&m_vfrBitsRaw[107], &m_vfrBits[59]);
 //        memcpy(&m_vfrBits[59], &m_vfrBitsRaw[107], 11);
 
-        // u6
-        HammingMBE::mbe_hamming1511(&m_vfrBitsRaw[122], &m_vfrBits[70]);
+    // u6
+    hammingErrs += HammingMBE::mbe_hamming1511(&m_vfrBitsRaw[122], &m_vfrBits[70]);
 //        memcpy(&m_vfrBits[70], &m_vfrBitsRaw[122], 11);
 
-        // u7
-        memcpy(&m_vfrBits[81], &m_vfrBitsRaw[137], 7);
+    // u7
+    memcpy(&m_vfrBits[81], &m_vfrBitsRaw[137], 7);
 
-		m_mbeDecoder->processData4400((char *) m_vfrBits);
-	}
+    Metrics::add(Metrics::FECCorrectedGolay2312, golayErrs);
+    Metrics::add(Metrics::FECCorrectedHamming1511, hammingErrs);
+
+	m_mbeDecoder->processData4400((char *) m_vfrBits);
 }
 
 bool DSDYSF::checkCRC16(unsigned char *bits,  unsigned long nbBytes, unsigned char *xoredBytes)
@@ -182,12 +182,10 @@ public:
     };
 #pragma pack(pop)
 
-	explicit DSDYSF();
+	explicit DSDYSF(MBEDecoder *mbeDecoder);
     ~DSDYSF();
 
-    void init();
-	void process(unsigned char);
-	FICH process_ysf(unsigned char *d);
+	FICH process_ysf(const unsigned char *d);
 	short *getAudio(int& nbSamples);
 	void resetAudio();
 
@@ -208,26 +206,31 @@ public:
 
 private:
 
-    void processFICH(int symbolIndex, unsigned char dibit);
-    void processHeader(int symbolIndex, unsigned char dibit);
-    void processVD1(int symbolIndex, unsigned char dibit);
-    void processVD2(int symbolIndex, unsigned char dibit);
-    void processVD2Voice(int mbeIndex, unsigned char dibit);
-    void processVFR(int symbolIndex, unsigned char dibit);
-    void processVFRSubHeader(int symbolIndex, unsigned char dibit);
-    void processVFRFullIMBE(int symbolIndex, unsigned char dibit);
+    void processFICH(const unsigned char *dibits);
+    void processHeader(const unsigned char *dibits);
+    void processVD1(const unsigned char *dibits);
+    void processVD2(const unsigned char *dibits);
+    void processVD2Voice(const unsigned char *vch);
+    void processVFR(const unsigned char *dibits);
+    void processVFRSubHeader(const unsigned char *dibits);
+    void processVFRFullIMBE(const unsigned char *dibits);
     void processCSD1(unsigned char *dchBytes);
     void processCSD2(unsigned char *dchBytes);
     void processCSD3_1(unsigned char *dchBytes);
     void processCSD3_2(unsigned char *dchBytes);
-    void processAMBE(int mbeIndex, unsigned char dibit);
-    void procesVFRFrame(int mbeIndex, unsigned char dibit);
+    void processAMBE(const unsigned char *vch);
+    void procesVFRFrame(const unsigned char *vch);
+
+    /** bit i of a VCH given as dibits, MSB first */
+    static unsigned char getVCHBit(const unsigned char *vch, int i)
+    {
+        return (vch[i>>1] >> (~i & 1)) & 1;
+    }
 
     bool checkCRC16(unsigned char *bits, unsigned long nbBytes, unsigned char *xoredBytes = 0);
     void scrambleVFR(uint8_t out[], uint8_t in[], uint16_t n, uint32_t seed, uint8_t shift);
 
 	MBEDecoder *m_mbeDecoder;
-    int m_symbolIndex;                //!< Current symbol index
 
     unsigned char m_fichRaw[100];     //!< FICH dibits after de-interleave + Viterbi stuff symbols
     unsigned char m_fichGolay[100];   //!< FICH Golay encoded bits + 4 stuff bits + Viterbi stuff bits
@@ -241,7 +244,6 @@ private:
     unsigned char m_dch2Raw[180];     //!< DCH2 dibits after de-interleave
     unsigned char m_dch2Bits[180];    //!< DCH2 bits after de-convolution
 
-    unsigned char m_vd2BitsRaw[104];  //!< V/D type 2 VCH+VeCH after de-interleave and de-whitening
     unsigned char m_vd2MBEBits[72];
 
     unsigned char m_vfrBitsRaw[144];  //!< VFR bits after de-interleave and de-scarambling
@@ -265,19 +267,15 @@ private:
     char m_destId[5+1];    //!< Destination radio ID
     char m_srcId[5+1];     //!< Source radio ID
 
-    // AMBE interleave
-    const int *w, *x, *y, *z;
-    static const int rW[36];
-    static const int rX[36];
-    static const int rY[36];
-    static const int rZ[36];
 	char ambe_fr[4][24];
 
-    static const int m_fichInterleave[100];   //!< FICH symbols interleaving matrix
-    static const int m_dchInterleave[180];    //!< DCH symbols interleaving matrix
-    static const int m_vd2Interleave[104];    //!< V/D type 2 interleaving matrix
-    static const int m_vd2DVSIInterleave[49]; //!< V/D type 2 interleaving matrix for DVSI AMBE3000 chip use
-    static const int m_vfrInterleave[144];    //!< VFR interleaving matrix
+    static const unsigned short m_fichGather[100];    //!< FICH symbols de-interleaving
+    static const unsigned short m_dchGather[180];     //!< Header and V/D type 1 DCH symbols de-interleaving
+    static const unsigned short m_vd2DchGather[100];  //!< V/D type 2 DCH symbols de-interleaving
+    static const unsigned short m_vfrDchGather[180];  //!< VFR sub header DCH symbols de-interleaving
+    static const int m_vd2DVSIInterleave[49];         //!< V/D type 2 interleaving matrix for DVSI AMBE3000 chip use
+    static const unsigned short m_ambeScatter[72];    //!< AMBE 3600x2450 VCH bits to ambe_fr offsets
+    static const unsigned short m_vfrGather[144];     //!< VFR VCH bits de-interleaving
 };
 
 #endif /* YSF_H_ */